@@ -18,11 +18,20 @@ static std::string logFilter;
 static std::string logType = "async";
 static std::string userName = "shadPS4";
 static bool isDebugDump = false;
+static bool perfStatsEnable = false; // Log subsystem performance counters on shutdown
 static bool isShowSplash = false;
+static bool useHugePages = false;
+static bool shouldPrefaultDmem = false;
 static bool isNullGpu = false;
 static bool shouldDumpShaders = false;
 static bool shouldDumpPM4 = false;
+static u32 pm4CaptureFrames = 0; // Frames written to a replayable capture when dumping PM4
 static u32 vblankDivider = 1;
+static std::string presentMode = "Mailbox"; // Fifo, FifoRelaxed, Mailbox or Immediate
+static u32 framesInFlight = 2;
+static bool lowLatencyMode = false;
+static float resolutionScale = 1.0f; // Render target size factor, from 0.5 to 2
+static bool fsrEnable = false;
 static bool vkValidation = false;
 static bool vkValidationSync = false;
 static bool vkValidationGpu = false;
@@ -84,10 +93,22 @@ bool debugDump() {
     return isDebugDump;
 }
 
+bool perfStats() {
+    return perfStatsEnable;
+}
+
 bool showSplash() {
     return isShowSplash;
 }
 
+bool hugePages() {
+    return useHugePages;
+}
+
+bool prefaultDmem() {
+    return shouldPrefaultDmem;
+}
+
 bool nullGpu() {
     return isNullGpu;
 }
@@ -100,6 +121,10 @@ bool dumpPM4() {
     return shouldDumpPM4;
 }
 
+u32 getPm4CaptureFrames() {
+    return pm4CaptureFrames;
+}
+
 bool isRdocEnabled() {
     return rdocEnable;
 }
@@ -112,6 +137,26 @@ u32 vblankDiv() {
     return vblankDivider;
 }
 
+std::string getPresentMode() {
+    return presentMode;
+}
+
+u32 getFramesInFlight() {
+    return framesInFlight;
+}
+
+bool isLowLatencyMode() {
+    return lowLatencyMode;
+}
+
+float getResolutionScale() {
+    return resolutionScale;
+}
+
+bool isFsrEnabled() {
+    return fsrEnable;
+}
+
 bool vkValidationEnabled() {
     return vkValidation;
 }
@@ -156,6 +201,10 @@ void setDumpPM4(bool enable) {
     shouldDumpPM4 = enable;
 }
 
+void setPm4CaptureFrames(u32 count) {
+    pm4CaptureFrames = count;
+}
+
 void setVkValidation(bool enable) {
     vkValidation = enable;
 }
@@ -172,6 +221,26 @@ void setVblankDiv(u32 value) {
     vblankDivider = value;
 }
 
+void setPresentMode(const std::string& mode) {
+    presentMode = mode;
+}
+
+void setFramesInFlight(u32 count) {
+    framesInFlight = count;
+}
+
+void setLowLatencyMode(bool enable) {
+    lowLatencyMode = enable;
+}
+
+void setResolutionScale(float scale) {
+    resolutionScale = scale;
+}
+
+void setFsrEnabled(bool enable) {
+    fsrEnable = enable;
+}
+
 void setFullscreenMode(bool enable) {
     isFullscreen = enable;
 }
@@ -319,6 +388,8 @@ void load(const std::filesystem::path& path) {
         logType = toml::find_or<std::string>(general, "logType", "sync");
         userName = toml::find_or<std::string>(general, "userName", "shadPS4");
         isShowSplash = toml::find_or<bool>(general, "showSplash", true);
+        useHugePages = toml::find_or<bool>(general, "hugePages", false);
+        shouldPrefaultDmem = toml::find_or<bool>(general, "prefaultDmem", false);
     }
 
     if (data.contains("GPU")) {
@@ -329,7 +400,13 @@ void load(const std::filesystem::path& path) {
         isNullGpu = toml::find_or<bool>(gpu, "nullGpu", false);
         shouldDumpShaders = toml::find_or<bool>(gpu, "dumpShaders", false);
         shouldDumpPM4 = toml::find_or<bool>(gpu, "dumpPM4", false);
+        pm4CaptureFrames = toml::find_or<int>(gpu, "pm4CaptureFrames", 0);
         vblankDivider = toml::find_or<int>(gpu, "vblankDivider", 1);
+        presentMode = toml::find_or<std::string>(gpu, "presentMode", "Mailbox");
+        framesInFlight = toml::find_or<int>(gpu, "framesInFlight", 2);
+        lowLatencyMode = toml::find_or<bool>(gpu, "lowLatencyMode", false);
+        resolutionScale = toml::find_or<double>(gpu, "resolutionScale", 1.0);
+        fsrEnable = toml::find_or<bool>(gpu, "fsrEnable", false);
     }
 
     if (data.contains("Vulkan")) {
@@ -347,6 +424,7 @@ void load(const std::filesystem::path& path) {
         const toml::value& debug = data.at("Debug");
 
         isDebugDump = toml::find_or<bool>(debug, "DebugDump", false);
+        perfStatsEnable = toml::find_or<bool>(debug, "PerfStats", false);
     }
 
     if (data.contains("GUI")) {
@@ -401,12 +479,20 @@ void save(const std::filesystem::path& path) {
     data["General"]["logType"] = logType;
     data["General"]["userName"] = userName;
     data["General"]["showSplash"] = isShowSplash;
+    data["General"]["hugePages"] = useHugePages;
+    data["General"]["prefaultDmem"] = shouldPrefaultDmem;
     data["GPU"]["screenWidth"] = screenWidth;
     data["GPU"]["screenHeight"] = screenHeight;
     data["GPU"]["nullGpu"] = isNullGpu;
     data["GPU"]["dumpShaders"] = shouldDumpShaders;
     data["GPU"]["dumpPM4"] = shouldDumpPM4;
+    data["GPU"]["pm4CaptureFrames"] = pm4CaptureFrames;
     data["GPU"]["vblankDivider"] = vblankDivider;
+    data["GPU"]["presentMode"] = presentMode;
+    data["GPU"]["framesInFlight"] = framesInFlight;
+    data["GPU"]["lowLatencyMode"] = lowLatencyMode;
+    data["GPU"]["resolutionScale"] = resolutionScale;
+    data["GPU"]["fsrEnable"] = fsrEnable;
     data["Vulkan"]["gpuId"] = gpuId;
     data["Vulkan"]["validation"] = vkValidation;
     data["Vulkan"]["validation_sync"] = vkValidationSync;
@@ -414,6 +500,7 @@ void save(const std::filesystem::path& path) {
     data["Vulkan"]["rdocEnable"] = rdocEnable;
     data["Vulkan"]["rdocMarkersEnable"] = rdocMarkersEnable;
     data["Debug"]["DebugDump"] = isDebugDump;
+    data["Debug"]["PerfStats"] = perfStatsEnable;
     data["GUI"]["theme"] = mw_themes;
     data["GUI"]["iconSize"] = m_icon_size;
     data["GUI"]["sliderPos"] = m_slider_pos;
@@ -447,11 +534,20 @@ void setDefaultValues() {
     logType = "async";
     userName = "shadPS4";
     isDebugDump = false;
+    perfStatsEnable = false;
     isShowSplash = false;
+    useHugePages = false;
+    shouldPrefaultDmem = false;
     isNullGpu = false;
     shouldDumpShaders = false;
     shouldDumpPM4 = false;
+    pm4CaptureFrames = 0;
     vblankDivider = 1;
+    presentMode = "Mailbox";
+    framesInFlight = 2;
+    lowLatencyMode = false;
+    resolutionScale = 1.0f;
+    fsrEnable = false;
     vkValidation = false;
     rdocEnable = false;
     m_language = 1;
@@ -22,20 +22,35 @@ u32 getScreenHeight();
 s32 getGpuId();
 
 bool debugDump();
+bool perfStats();
 bool showSplash();
+bool hugePages();
+bool prefaultDmem();
 bool nullGpu();
 bool dumpShaders();
 bool dumpPM4();
+u32 getPm4CaptureFrames();
 bool isRdocEnabled();
 bool isMarkersEnabled();
 u32 vblankDiv();
+std::string getPresentMode();
+u32 getFramesInFlight();
+bool isLowLatencyMode();
+float getResolutionScale();
+bool isFsrEnabled();
 
 void setDebugDump(bool enable);
 void setShowSplash(bool enable);
 void setNullGpu(bool enable);
 void setDumpShaders(bool enable);
 void setDumpPM4(bool enable);
+void setPm4CaptureFrames(u32 count);
 void setVblankDiv(u32 value);
+void setPresentMode(const std::string& mode);
+void setFramesInFlight(u32 count);
+void setLowLatencyMode(bool enable);
+void setResolutionScale(float scale);
+void setFsrEnabled(bool enable);
 void setGpuId(s32 selectedGpuId);
 void setScreenWidth(u32 width);
 void setScreenHeight(u32 height);
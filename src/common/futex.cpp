@@ -0,0 +1,101 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "common/futex.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#else
+#include <array>
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace Common {
+
+#ifdef __linux__
+
+bool FutexWait(std::atomic<u32>& word, u32 expected, const std::chrono::nanoseconds* timeout) {
+    timespec ts{};
+    if (timeout) {
+        ts.tv_sec = timeout->count() / 1'000'000'000;
+        ts.tv_nsec = timeout->count() % 1'000'000'000;
+    }
+    const long ret = syscall(SYS_futex, reinterpret_cast<u32*>(&word), FUTEX_WAIT_PRIVATE,
+                             expected, timeout ? &ts : nullptr, nullptr, 0);
+    return ret == 0 || errno != ETIMEDOUT;
+}
+
+void FutexWake(const std::atomic<u32>* word, s32 count) {
+    syscall(SYS_futex, reinterpret_cast<const u32*>(word), FUTEX_WAKE_PRIVATE, count, nullptr,
+            nullptr, 0);
+}
+
+#elif defined(_WIN32)
+
+bool FutexWait(std::atomic<u32>& word, u32 expected, const std::chrono::nanoseconds* timeout) {
+    const DWORD millis =
+        timeout ? static_cast<DWORD>(std::chrono::ceil<std::chrono::milliseconds>(*timeout).count())
+                : INFINITE;
+    return WaitOnAddress(&word, &expected, sizeof(u32), millis) ||
+           GetLastError() != ERROR_TIMEOUT;
+}
+
+void FutexWake(const std::atomic<u32>* word, s32 count) {
+    void* address = const_cast<std::atomic<u32>*>(word);
+    if (count == 1) {
+        WakeByAddressSingle(address);
+    } else {
+        WakeByAddressAll(address);
+    }
+}
+
+#else
+
+namespace {
+
+// Portable fallback: words hash onto a fixed set of condition variables.
+struct ParkingBucket {
+    std::mutex mutex;
+    std::condition_variable cv;
+};
+
+std::array<ParkingBucket, 64> parking_buckets;
+
+ParkingBucket& GetBucket(const std::atomic<u32>* word) {
+    const auto addr = reinterpret_cast<uintptr_t>(word);
+    return parking_buckets[(addr >> 2) % parking_buckets.size()];
+}
+
+} // Anonymous namespace
+
+bool FutexWait(std::atomic<u32>& word, u32 expected, const std::chrono::nanoseconds* timeout) {
+    auto& bucket = GetBucket(&word);
+    std::unique_lock lk{bucket.mutex};
+    if (word.load(std::memory_order_acquire) != expected) {
+        return true;
+    }
+    if (!timeout) {
+        bucket.cv.wait(lk);
+        return true;
+    }
+    return bucket.cv.wait_for(lk, *timeout) == std::cv_status::no_timeout;
+}
+
+void FutexWake(const std::atomic<u32>* word, s32 count) {
+    auto& bucket = GetBucket(word);
+    // Taking the lock orders the wake after any waiter that has checked the word.
+    std::scoped_lock lk{bucket.mutex};
+    // Other words may share the bucket, so every waiter has to re-check its own word.
+    bucket.cv.notify_all();
+}
+
+#endif
+
+} // namespace Common
@@ -0,0 +1,31 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include "common/types.h"
+
+namespace Common {
+
+/**
+ * Blocks the calling thread while word still holds expected, until woken by FutexWake or until
+ * the optional timeout expires. May return spuriously, callers must re-check their condition.
+ * Returns false if the timeout expired.
+ */
+bool FutexWait(std::atomic<u32>& word, u32 expected,
+               const std::chrono::nanoseconds* timeout = nullptr);
+
+/**
+ * Wakes up to count threads blocked in FutexWait on word. Only the address is used, so it is
+ * safe to call after the object holding the word may have been destroyed by a woken waiter.
+ */
+void FutexWake(const std::atomic<u32>* word, s32 count);
+
+inline void FutexWakeAll(const std::atomic<u32>* word) {
+    FutexWake(word, std::numeric_limits<s32>::max());
+}
+
+} // namespace Common
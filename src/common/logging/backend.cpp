@@ -166,6 +166,10 @@ public:
         color_console_backend.SetEnabled(enabled);
     }
 
+    bool IsLogged(Class log_class, Level log_level) const {
+        return filter.CheckMessage(log_class, log_level);
+    }
+
     void PushEntry(Class log_class, Level log_level, const char* filename, unsigned int line_num,
                    const char* function, std::string message) {
         // Propagate important log messages to the profiler
@@ -291,9 +295,19 @@ void SetColorConsoleBackendEnabled(bool enabled) {
     Impl::Instance().SetColorConsoleBackendEnabled(enabled);
 }
 
+bool IsLogged(Class log_class, Level log_level) {
+    return !initialization_in_progress_suppress_logging &&
+           Impl::Instance().IsLogged(log_class, log_level);
+}
+
 void FmtLogMessageImpl(Class log_class, Level log_level, const char* filename,
                        unsigned int line_num, const char* function, const char* format,
                        const fmt::format_args& args) {
+    // Warnings and above are still forwarded to the profiler when filtered out, anything
+    // below is dropped before paying for formatting.
+    if (log_level < Level::Warning && !IsLogged(log_class, log_level)) {
+        return;
+    }
     if (!initialization_in_progress_suppress_logging) [[likely]] {
         Impl::Instance().PushEntry(log_class, log_level, filename, line_num, function,
                                    fmt::vformat(format, args));
@@ -24,4 +24,8 @@ void SetGlobalFilter(const Filter& filter);
 
 void SetColorConsoleBackendEnabled(bool enabled);
 
+/// Returns true if a message of the given class and level passes the global filter. Useful to
+/// skip building expensive log arguments that would be discarded.
+bool IsLogged(Class log_class, Level log_level);
+
 } // namespace Common::Log
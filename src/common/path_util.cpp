@@ -104,6 +104,8 @@ static auto UserPaths = [] {
     create_path(PathType::SysModuleDir, user_dir / SYSMODULES_DIR);
     create_path(PathType::DownloadDir, user_dir / DOWNLOAD_DIR);
     create_path(PathType::CapturesDir, user_dir / CAPTURES_DIR);
+    create_path(PathType::PatchCacheDir, user_dir / PATCH_CACHE_DIR);
+    create_path(PathType::PkgCacheDir, user_dir / PKG_CACHE_DIR);
 
     return paths;
 }();
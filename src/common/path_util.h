@@ -20,6 +20,8 @@ enum class PathType {
     SysModuleDir,   // Where system modules are stored.
     DownloadDir,    // Where downloads/temp files are stored.
     CapturesDir,    // Where rdoc captures are stored.
+    PatchCacheDir,  // Where discovered CPU patch sites are stored.
+    PkgCacheDir,    // Where boot files of games run from a package are stored.
 };
 
 constexpr auto PORTABLE_DIR = "user";
@@ -35,6 +37,8 @@ constexpr auto TEMPDATA_DIR = "temp";
 constexpr auto SYSMODULES_DIR = "sys_modules";
 constexpr auto DOWNLOAD_DIR = "download";
 constexpr auto CAPTURES_DIR = "captures";
+constexpr auto PATCH_CACHE_DIR = "patch_cache";
+constexpr auto PKG_CACHE_DIR = "pkg_cache";
 
 // Filenames
 constexpr auto LOG_FILE = "shad_log.txt";
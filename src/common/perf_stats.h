@@ -0,0 +1,100 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <fmt/format.h>
+#include <magic_enum.hpp>
+#include "common/config.h"
+#include "common/logging/log.h"
+#include "common/types.h"
+
+namespace Common {
+
+/**
+ * Performance counters of a subsystem, one per enumerator of Counter. The enumerators must be
+ * contiguous from zero, their names label the values in the report.
+ * Counting is opt-in through the PerfStats debug option. When it is off updates return after a
+ * single branch and nothing is reported. Counters are relaxed atomics so any thread may update
+ * them, the totals are logged once when the owner is destroyed. The title is not copied.
+ */
+template <typename Counter>
+class PerfStats {
+    static constexpr size_t NumCounters = magic_enum::enum_count<Counter>();
+    static_assert([] {
+        size_t index = 0;
+        for (const auto counter : magic_enum::enum_values<Counter>()) {
+            if (static_cast<size_t>(counter) != index++) {
+                return false;
+            }
+        }
+        return true;
+    }());
+
+public:
+    explicit PerfStats(Log::Class log_class_, std::string_view title_)
+        : log_class{log_class_}, title{title_}, enabled{Config::perfStats()} {}
+
+    ~PerfStats() {
+        Report();
+    }
+
+    PerfStats(const PerfStats&) = delete;
+    PerfStats& operator=(const PerfStats&) = delete;
+
+    /// Returns true when counters are being collected, for callers that measure the value.
+    [[nodiscard]] bool IsEnabled() const noexcept {
+        return enabled;
+    }
+
+    void Add(Counter counter, u64 value = 1) noexcept {
+        if (enabled) {
+            Slot(counter).fetch_add(value, std::memory_order_relaxed);
+        }
+    }
+
+    /// Raises the counter to value, for counters holding a maximum.
+    void Max(Counter counter, u64 value) noexcept {
+        if (!enabled) {
+            return;
+        }
+        auto& slot = Slot(counter);
+        u64 current = slot.load(std::memory_order_relaxed);
+        while (value > current &&
+               !slot.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    [[nodiscard]] u64 Get(Counter counter) const noexcept {
+        return values[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<u64>& Slot(Counter counter) noexcept {
+        return values[static_cast<size_t>(counter)];
+    }
+
+    void Report() const {
+        if (!enabled) {
+            return;
+        }
+        std::string report;
+        for (const auto counter : magic_enum::enum_values<Counter>()) {
+            fmt::format_to(std::back_inserter(report), "{}{}={}", report.empty() ? "" : ", ",
+                           magic_enum::enum_name(counter), Get(counter));
+        }
+        LOG_GENERIC(log_class, Log::Level::Info, "{}: {}", title, report);
+    }
+
+    Log::Class log_class;
+    std::string_view title;
+    bool enabled;
+    std::array<std::atomic<u64>, NumCounters> values{};
+};
+
+} // namespace Common
@@ -4,7 +4,9 @@
 #include <boost/icl/separate_interval_set.hpp>
 #include "common/alignment.h"
 #include "common/assert.h"
+#include "common/config.h"
 #include "common/error.h"
+#include "common/perf_stats.h"
 #include "core/address_space.h"
 #include "core/libraries/kernel/memory_management.h"
 #include "core/memory.h"
@@ -16,6 +18,17 @@
 #include <sys/mman.h>
 #endif
 
+#ifdef __linux__
+#include <fstream>
+#include <string>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+#endif
+
 #ifdef __APPLE__
 // Reserve space for the system address space using a zerofill section.
 asm(".zerofill GUEST_SYSTEM,GUEST_SYSTEM,__guest_system,0xFBFC00000");
@@ -277,6 +290,58 @@ enum PosixPageProtection {
     PAGE_EXECUTE_READWRITE = PROT_EXEC | PROT_READ | PROT_WRITE
 };
 
+#ifdef __linux__
+// Direct memory mappings at least this large are prefaulted when enabled.
+static constexpr size_t PrefaultThreshold = 64_MB;
+
+struct MemoryUsage {
+    long minor_faults;
+    long major_faults;
+    u64 resident_mb;
+    u64 shmem_huge_mb;
+};
+
+enum class MemoryCounter : u32 {
+    Prefaults,
+    PrefaultBytes,
+    PrefaultFaults,
+    MinorFaults,
+    MajorFaults,
+    MaxResidentMb,
+    MaxShmemHugeMb,
+};
+
+/// Samples page fault counts and resident memory, to measure the effect of huge pages. Parses
+/// smaps, so only sampled when perf stats are enabled.
+static MemoryUsage GetMemoryUsage() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    MemoryUsage result{usage.ru_minflt, usage.ru_majflt, 0, 0};
+
+    std::ifstream smaps{"/proc/self/smaps_rollup"};
+    std::string key;
+    u64 value_kb;
+    std::string unit;
+    while (smaps >> key >> value_kb >> unit) {
+        if (key == "Rss:") {
+            result.resident_mb = value_kb >> 10;
+        } else if (key == "ShmemPmdMapped:") {
+            result.shmem_huge_mb = value_kb >> 10;
+        }
+    }
+    return result;
+}
+
+/// Returns true when the kernel allocates huge pages for shmem mappings that ask for them.
+static bool IsShmemHugePageEnabled() {
+    std::ifstream file{"/sys/kernel/mm/transparent_hugepage/shmem_enabled"};
+    std::string policy;
+    std::getline(file, policy);
+    return !policy.empty() && policy.find("[never]") == std::string::npos &&
+           policy.find("[deny]") == std::string::npos;
+}
+#endif
+
 [[nodiscard]] constexpr PosixPageProtection ToPosixProt(Core::MemoryProt prot) {
     switch (prot) {
     case Core::MemoryProt::NoAccess:
@@ -360,6 +425,14 @@ struct AddressSpace::Impl {
             LOG_CRITICAL(Kernel_Vmm, "memfd_create failed: {}", strerror(errno));
             throw std::bad_alloc{};
         }
+
+        use_huge_pages = Config::hugePages();
+        if (use_huge_pages && !IsShmemHugePageEnabled()) {
+            LOG_WARNING(Kernel_Vmm, "Huge pages requested but shmem transparent huge pages are "
+                                    "disabled, direct memory uses regular pages");
+            use_huge_pages = false;
+        }
+        prefault_dmem = Config::prefaultDmem();
 #endif
 
         // Defined to extend the file with zeros
@@ -377,20 +450,82 @@ struct AddressSpace::Impl {
             LOG_CRITICAL(Kernel_Vmm, "mmap failed: {}", strerror(errno));
             throw std::bad_alloc{};
         }
+#ifdef __linux__
+        if (use_huge_pages && madvise(backing_base, BackingSize, MADV_HUGEPAGE) != 0) {
+            LOG_WARNING(Kernel_Vmm, "madvise(MADV_HUGEPAGE) failed: {}, direct memory uses "
+                                    "regular pages", strerror(errno));
+            use_huge_pages = false;
+        }
+        LOG_INFO(Kernel_Vmm, "Direct memory backing: huge pages {}, prefault {}", use_huge_pages,
+                 prefault_dmem);
+#endif
     }
 
+#ifdef __linux__
+    ~Impl() {
+        if (!memory_stats.IsEnabled()) {
+            return;
+        }
+        const auto usage = GetMemoryUsage();
+        memory_stats.Add(MemoryCounter::MinorFaults, usage.minor_faults);
+        memory_stats.Add(MemoryCounter::MajorFaults, usage.major_faults);
+        memory_stats.Max(MemoryCounter::MaxResidentMb, usage.resident_mb);
+        memory_stats.Max(MemoryCounter::MaxShmemHugeMb, usage.shmem_huge_mb);
+    }
+#endif
+
     void* Map(VAddr virtual_addr, PAddr phys_addr, size_t size, PosixPageProtection prot,
               int fd = -1) {
         m_free_regions.subtract({virtual_addr, virtual_addr + size});
         const int handle = phys_addr != -1 ? (fd == -1 ? backing_fd : fd) : -1;
         const off_t host_offset = phys_addr != -1 ? phys_addr : 0;
         const int flag = phys_addr != -1 ? MAP_SHARED : (MAP_ANONYMOUS | MAP_PRIVATE);
-        void* ret = mmap(reinterpret_cast<void*>(virtual_addr), size, prot, MAP_FIXED | flag,
-                         handle, host_offset);
+#ifdef __linux__
+        const bool is_dmem = handle == backing_fd;
+        const bool prefault = is_dmem && prefault_dmem && size >= PrefaultThreshold;
+        // Kernels without MADV_POPULATE_WRITE populate at map time, before the huge page advice.
+        const int populate = prefault && !has_populate_write ? MAP_POPULATE : 0;
+#else
+        const int populate = 0;
+#endif
+        void* ret = mmap(reinterpret_cast<void*>(virtual_addr), size, prot,
+                         MAP_FIXED | flag | populate, handle, host_offset);
         ASSERT_MSG(ret != MAP_FAILED, "mmap failed: {}", strerror(errno));
+#ifdef __linux__
+        if (is_dmem && use_huge_pages) {
+            madvise(ret, size, MADV_HUGEPAGE);
+        }
+        if (prefault && has_populate_write) {
+            Prefault(ret, size);
+        }
+#endif
         return ret;
     }
 
+#ifdef __linux__
+    void Prefault(void* addr, size_t size) {
+        const bool is_sampled = memory_stats.IsEnabled();
+        const auto before = is_sampled ? GetMemoryUsage() : MemoryUsage{};
+        if (madvise(addr, size, MADV_POPULATE_WRITE) != 0) {
+            if (errno == EINVAL) {
+                LOG_WARNING(Kernel_Vmm, "MADV_POPULATE_WRITE is not supported, falling back to "
+                                        "MAP_POPULATE");
+                has_populate_write = false;
+            }
+            return;
+        }
+        if (!is_sampled) {
+            return;
+        }
+        const auto after = GetMemoryUsage();
+        memory_stats.Add(MemoryCounter::Prefaults);
+        memory_stats.Add(MemoryCounter::PrefaultBytes, size);
+        memory_stats.Add(MemoryCounter::PrefaultFaults, after.minor_faults - before.minor_faults);
+        memory_stats.Max(MemoryCounter::MaxResidentMb, after.resident_mb);
+        memory_stats.Max(MemoryCounter::MaxShmemHugeMb, after.shmem_huge_mb);
+    }
+#endif
+
     void Unmap(VAddr virtual_addr, size_t size, bool) {
         // Check to see if we are adjacent to any regions.
         auto start_address = virtual_addr;
@@ -429,6 +564,12 @@ struct AddressSpace::Impl {
 
     int backing_fd;
     u8* backing_base{};
+#ifdef __linux__
+    bool use_huge_pages{};
+    bool prefault_dmem{};
+    bool has_populate_write{true};
+    Common::PerfStats<MemoryCounter> memory_stats{Common::Log::Class::Kernel_Vmm, "Memory usage"};
+#endif
     u8* system_managed_base{};
     size_t system_managed_size{};
     u8* system_reserved_base{};
@@ -1,11 +1,26 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
 #include <Zydis/Zydis.h>
 #include <xbyak/xbyak.h>
+#include <xxhash.h>
+#include "common/alignment.h"
 #include "common/assert.h"
+#include "common/div_ceil.h"
+#include "common/io_file.h"
+#include "common/path_util.h"
+#include "common/scm_rev.h"
+#include "common/polyfill_thread.h"
 #include "common/types.h"
 #include "core/tls.h"
 #include "cpu_patches.h"
@@ -348,64 +363,290 @@ static const std::unordered_map<ZydisMnemonic, PatchInfo> Patches = {
 #endif
 };
 
-void PatchInstructions(u64 segment_addr, u64 segment_size, Xbyak::CodeGenerator& c) {
-    if (Patches.empty()) {
-        // Nothing to patch on this platform.
-        return;
-    }
+static bool ShouldPatch(const ZydisDecodedInstruction& instruction,
+                        const ZydisDecodedOperand* operands) {
+    const auto it = Patches.find(instruction.mnemonic);
+    return it != Patches.end() && it->second.filter(operands);
+}
 
+/// Decodes code from begin until an instruction ends at or past end, collecting the offsets of
+/// instructions to patch. When given, every offset the decoder starts at is marked in the
+/// boundaries bitmap. Returns the offset decoding stopped at.
+static u64 ScanCode(const u8* code, u64 size, u64 begin, u64 end, std::vector<u64>& sites,
+                    u64* boundaries) {
     ZydisDecoder instr_decoder;
     ZydisDecodedInstruction instruction;
     ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
     ZydisDecoderInit(&instr_decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
 
-    u8* code = reinterpret_cast<u8*>(segment_addr);
-    u8* end = code + segment_size;
-    while (code < end) {
-        ZyanStatus status =
-            ZydisDecoderDecodeFull(&instr_decoder, code, end - code, &instruction, operands);
+    u64 offset = begin;
+    while (offset < end) {
+        if (boundaries) {
+            boundaries[offset / 64] |= 1ULL << (offset % 64);
+        }
+        const ZyanStatus status = ZydisDecoderDecodeFull(&instr_decoder, code + offset,
+                                                         size - offset, &instruction, operands);
         if (!ZYAN_SUCCESS(status)) {
-            code++;
+            offset++;
             continue;
         }
+        if (ShouldPatch(instruction, operands)) {
+            sites.push_back(offset);
+        }
+        offset += instruction.length;
+    }
+    return offset;
+}
 
-        if (Patches.contains(instruction.mnemonic)) {
-            auto patch_info = Patches.at(instruction.mnemonic);
-            if (patch_info.filter(operands)) {
-                auto patch_gen = Xbyak::CodeGenerator(instruction.length, code);
+/// Finds the instructions to patch in a code segment, splitting the decode across threads.
+static std::vector<u64> ScanSegment(const u8* code, u64 size, u32& num_threads) {
+    static constexpr u64 MinChunkSize = 1_MB;
+    const u64 max_chunks = std::max(std::thread::hardware_concurrency(), 1U);
+    const u64 chunk_size =
+        Common::AlignUp(std::max<u64>(Common::DivCeil(size, max_chunks), MinChunkSize), 64);
+    const u64 num_chunks = Common::DivCeil(size, chunk_size);
+    num_threads = static_cast<u32>(num_chunks);
+
+    std::vector<u64> sites;
+    if (num_chunks <= 1) {
+        ScanCode(code, size, 0, size, sites, nullptr);
+        return sites;
+    }
+
+    // Chunks are 64 byte aligned so every worker owns whole words of the bitmap.
+    struct Chunk {
+        u64 begin;
+        u64 end;
+        u64 stop;
+        std::vector<u64> sites;
+    };
+    std::vector<Chunk> chunks(num_chunks);
+    std::vector<u64> boundaries(Common::DivCeil(size, 64));
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(num_chunks);
+        for (u64 i = 0; i < num_chunks; i++) {
+            chunks[i].begin = i * chunk_size;
+            chunks[i].end = std::min(chunks[i].begin + chunk_size, size);
+            workers.emplace_back([&chunks, &boundaries, code, size, i] {
+                auto& chunk = chunks[i];
+                chunk.stop =
+                    ScanCode(code, size, chunk.begin, chunk.end, chunk.sites, boundaries.data());
+            });
+        }
+    }
+
+    // A chunk was decoded from an arbitrary byte, its results only match a sequential decode
+    // from the first instruction boundary both agree on. Decode up to that point here.
+    const auto is_boundary = [&](u64 offset) {
+        return (boundaries[offset / 64] >> (offset % 64)) & 1;
+    };
+    sites = std::move(chunks[0].sites);
+    u64 offset = chunks[0].stop;
+    for (u64 i = 1; i < num_chunks; i++) {
+        auto& chunk = chunks[i];
+        while (offset < chunk.end && !is_boundary(offset)) {
+            offset = ScanCode(code, size, offset, offset + 1, sites, nullptr);
+        }
+        if (offset >= chunk.end) {
+            continue;
+        }
+        const auto first = std::ranges::lower_bound(chunk.sites, offset);
+        sites.insert(sites.end(), first, chunk.sites.end());
+        offset = chunk.stop;
+    }
+    return sites;
+}
 
-                if (patch_info.trampoline) {
-                    const auto trampoline_ptr = c.getCurr();
+static constexpr u32 PatchCacheMagic = 0x48435450; // PTCH
+static constexpr u32 PatchCacheVersion = 2;
+static constexpr size_t MaxPatchCacheEntries = 256;
 
-                    patch_info.generator(operands, c);
+struct PatchCacheHeader {
+    u32 magic;
+    u32 version;
+    u64 config_hash;
+    u64 segment_size;
+    u64 num_sites;
+};
 
-                    // Return to the following instruction at the end of the trampoline.
-                    c.jmp(code + instruction.length);
+/// Hashes everything besides the segment contents that decides where the patch sites are: the
+/// patch table, its filters on this host and the build, whose filters may differ from others.
+static u64 PatchConfigHash() {
+    static const u64 hash = [] {
+        std::vector<std::pair<u32, bool>> patches;
+        for (const auto& [mnemonic, info] : Patches) {
+            patches.emplace_back(static_cast<u32>(mnemonic), info.trampoline);
+        }
+        std::ranges::sort(patches);
+        std::string key = Common::g_scm_rev;
+        for (const auto& [mnemonic, trampoline] : patches) {
+            key += fmt::format(";{}:{}", mnemonic, trampoline);
+        }
+#ifdef __APPLE__
+        key += fmt::format(";rosetta:{}", FilterRosetta2Only(nullptr));
+#endif
+        return XXH3_64bits(key.data(), key.size());
+    }();
+    return hash;
+}
 
-                    // Replace instruction with near jump to the trampoline.
-                    patch_gen.jmp(trampoline_ptr, Xbyak::CodeGenerator::LabelType::T_NEAR);
-                } else {
-                    patch_info.generator(operands, patch_gen);
-                }
+static std::filesystem::path PatchCachePath(u64 hash) {
+    return Common::FS::GetUserPath(Common::FS::PathType::PatchCacheDir) /
+           fmt::format("{:016x}.bin", hash);
+}
 
-                const auto patch_size = patch_gen.getCurr() - code;
-                if (patch_size > 0) {
-                    ASSERT_MSG(instruction.length >= patch_size,
-                               "Instruction {} with length {} is too short to replace at: {}",
-                               ZydisMnemonicGetString(instruction.mnemonic), instruction.length,
-                               fmt::ptr(code));
+static std::optional<std::vector<u64>> LoadPatchCache(const std::filesystem::path& path,
+                                                      u64 segment_size) {
+    std::vector<u64> sites;
+    {
+        const Common::FS::IOFile file(path, Common::FS::FileAccessMode::Read);
+        if (!file.IsOpen()) {
+            return std::nullopt;
+        }
+        PatchCacheHeader header{};
+        if (!file.ReadObject(header) || header.magic != PatchCacheMagic ||
+            header.version != PatchCacheVersion || header.config_hash != PatchConfigHash() ||
+            header.segment_size != segment_size) {
+            return std::nullopt;
+        }
+        sites.resize(header.num_sites);
+        if (file.ReadSpan<u64>(sites) != sites.size()) {
+            return std::nullopt;
+        }
+    }
+    // Entries are evicted least recently used first.
+    std::error_code ec;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+    return sites;
+}
 
-                    // Fill remaining space with nops.
-                    patch_gen.nop(instruction.length - patch_size);
+/// Removes the least recently used entries once the cache holds more than its limit.
+static void EvictPatchCache() {
+    const auto cache_dir = Common::FS::GetUserPath(Common::FS::PathType::PatchCacheDir);
+    std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> entries;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it{cache_dir, ec}, end; !ec && it != end;
+         it.increment(ec)) {
+        if (it->path().extension() == ".bin") {
+            entries.emplace_back(it->last_write_time(ec), it->path());
+        }
+    }
+    if (entries.size() <= MaxPatchCacheEntries) {
+        return;
+    }
+    const auto num_evicted = entries.size() - MaxPatchCacheEntries;
+    std::ranges::nth_element(entries, entries.begin() + num_evicted);
+    for (size_t i = 0; i < num_evicted; i++) {
+        std::filesystem::remove(entries[i].second, ec);
+    }
+    LOG_INFO(Core, "Evicted {} patch cache entries", num_evicted);
+}
 
-                    LOG_DEBUG(Core, "Patched instruction '{}' at: {}",
-                              ZydisMnemonicGetString(instruction.mnemonic), fmt::ptr(code));
-                }
-            }
+static void SavePatchCache(const std::filesystem::path& path, u64 segment_size,
+                           std::span<const u64> sites) {
+    {
+        const Common::FS::IOFile file(path, Common::FS::FileAccessMode::Write);
+        const PatchCacheHeader header = {
+            .magic = PatchCacheMagic,
+            .version = PatchCacheVersion,
+            .config_hash = PatchConfigHash(),
+            .segment_size = segment_size,
+            .num_sites = sites.size(),
+        };
+        if (!file.IsOpen() || !file.WriteObject(header) ||
+            file.WriteSpan(sites) != sites.size()) {
+            LOG_WARNING(Core, "Failed to write patch cache {}", path.string());
+            return;
         }
+    }
+    EvictPatchCache();
+}
+
+static void PatchInstruction(u8* code, u64 size, Xbyak::CodeGenerator& c) {
+    ZydisDecoder instr_decoder;
+    ZydisDecodedInstruction instruction;
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+    ZydisDecoderInit(&instr_decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
+
+    const ZyanStatus status =
+        ZydisDecoderDecodeFull(&instr_decoder, code, size, &instruction, operands);
+    if (!ZYAN_SUCCESS(status) || !ShouldPatch(instruction, operands)) {
+        LOG_WARNING(Core, "Stale patch site at: {}", fmt::ptr(code));
+        return;
+    }
+
+    const auto& patch_info = Patches.at(instruction.mnemonic);
+    auto patch_gen = Xbyak::CodeGenerator(instruction.length, code);
+
+    if (patch_info.trampoline) {
+        const auto trampoline_ptr = c.getCurr();
+
+        patch_info.generator(operands, c);
+
+        // Return to the following instruction at the end of the trampoline.
+        c.jmp(code + instruction.length);
+
+        // Replace instruction with near jump to the trampoline.
+        patch_gen.jmp(trampoline_ptr, Xbyak::CodeGenerator::LabelType::T_NEAR);
+    } else {
+        patch_info.generator(operands, patch_gen);
+    }
+
+    const auto patch_size = patch_gen.getCurr() - code;
+    if (patch_size > 0) {
+        ASSERT_MSG(instruction.length >= patch_size,
+                   "Instruction {} with length {} is too short to replace at: {}",
+                   ZydisMnemonicGetString(instruction.mnemonic), instruction.length,
+                   fmt::ptr(code));
+
+        // Fill remaining space with nops.
+        patch_gen.nop(instruction.length - patch_size);
+
+        LOG_DEBUG(Core, "Patched instruction '{}' at: {}",
+                  ZydisMnemonicGetString(instruction.mnemonic), fmt::ptr(code));
+    }
+}
+
+void PatchInstructions(u64 segment_addr, u64 segment_size, Xbyak::CodeGenerator& c) {
+    if (Patches.empty()) {
+        // Nothing to patch on this platform.
+        return;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    const auto to_us = [](Clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    };
 
-        code += instruction.length;
+    u8* code = reinterpret_cast<u8*>(segment_addr);
+    const auto hash_start = Clock::now();
+    const auto cache_path = PatchCachePath(XXH3_64bits(code, segment_size));
+    const auto scan_start = Clock::now();
+
+    // Patch sites only depend on the segment contents, which the cache is keyed by, and on the
+    // patch configuration stored in its header.
+    u32 num_threads = 0;
+    auto cached_sites = LoadPatchCache(cache_path, segment_size);
+    const bool is_cached = cached_sites.has_value();
+    const auto sites =
+        is_cached ? std::move(*cached_sites) : ScanSegment(code, segment_size, num_threads);
+    const auto apply_start = Clock::now();
+
+    for (const u64 offset : sites) {
+        PatchInstruction(code + offset, segment_size - offset, c);
+    }
+    const auto apply_end = Clock::now();
+
+    if (!is_cached) {
+        SavePatchCache(cache_path, segment_size, sites);
     }
+
+    LOG_INFO(Core,
+             "Patched {} instructions in {:#x} byte segment: hash {} us, {} {} us, apply {} us",
+             sites.size(), segment_size, to_us(scan_start - hash_start),
+             is_cached ? std::string{"cache load"} : fmt::format("scan on {} threads", num_threads),
+             to_us(apply_start - scan_start), to_us(apply_end - apply_start));
 }
 
 } // namespace Core
@@ -2,6 +2,8 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 
 #include <algorithm>
+#include "common/assert.h"
+#include "common/logging/log.h"
 #include "common/string_util.h"
 #include "core/file_sys/fs.h"
 
@@ -14,7 +16,14 @@ void MntPoints::Mount(const std::filesystem::path& host_folder, const std::strin
     m_mnt_pairs.emplace_back(host_folder, guest_folder);
 }
 
+void MntPoints::Mount(std::shared_ptr<PackageFs> package, const std::string& guest_folder,
+                      const std::filesystem::path& extract_folder) {
+    std::scoped_lock lock{m_mutex};
+    m_mnt_pairs.push_back({extract_folder, guest_folder, std::move(package)});
+}
+
 void MntPoints::Unmount(const std::filesystem::path& host_folder, const std::string& guest_folder) {
+    std::scoped_lock lock{m_mutex};
     auto it = std::remove_if(m_mnt_pairs.begin(), m_mnt_pairs.end(),
                              [&](const MntPair& pair) { return pair.mount == guest_folder; });
     m_mnt_pairs.erase(it, m_mnt_pairs.end());
@@ -25,19 +34,31 @@ void MntPoints::UnmountAll() {
     m_mnt_pairs.clear();
 }
 
-std::filesystem::path MntPoints::GetHostPath(std::string_view guest_directory) {
+static std::string CorrectGuestPath(std::string_view guest_path) {
     // Evil games like Turok2 pass double slashes e.g /app0//game.kpf
-    std::string corrected_path(guest_directory);
+    std::string corrected_path(guest_path);
     size_t pos = corrected_path.find("//");
     while (pos != std::string::npos) {
         corrected_path.replace(pos, 2, "/");
         pos = corrected_path.find("//", pos + 1);
     }
+    return corrected_path;
+}
 
+std::filesystem::path MntPoints::GetHostPath(std::string_view guest_directory) {
+    const std::string corrected_path = CorrectGuestPath(guest_directory);
+    std::shared_lock lk{m_mutex};
     const MntPair* mount = GetMount(corrected_path);
     if (!mount) {
         return "";
     }
+    if (mount->package) {
+        const auto package = mount->package;
+        const auto extract_folder = mount->host_path;
+        const auto rel_path = corrected_path.substr(mount->mount.size());
+        lk.unlock();
+        return ExtractFromPackage(*package, extract_folder, rel_path);
+    }
 
     // Nothing to do if getting the mount itself.
     if (corrected_path == mount->mount) {
@@ -45,108 +66,239 @@ std::filesystem::path MntPoints::GetHostPath(std::string_view guest_directory) {
     }
 
     // Remove device (e.g /app0) from path to retrieve relative path.
-    pos = mount->mount.size() + 1;
+    const size_t pos = mount->mount.size() + 1;
     const auto rel_path = std::string_view(corrected_path).substr(pos);
-    const auto host_path = mount->host_path / rel_path;
-    if (!NeedsCaseInsensiveSearch) {
+    const auto mount_path = mount->host_path;
+    lk.unlock();
+
+    const auto host_path = mount_path / rel_path;
+    if (!NeedsCaseInsensiveSearch || std::filesystem::exists(host_path)) {
         return host_path;
     }
 
-    // If the path does not exist attempt to verify this.
-    // Retrieve parent path until we find one that exists.
-    std::scoped_lock lk{m_mutex};
-    path_parts.clear();
-    auto current_path = host_path;
-    while (!std::filesystem::exists(current_path)) {
-        // We have probably cached this if it's a folder.
-        if (auto it = path_cache.find(current_path); it != path_cache.end()) {
-            current_path = it->second;
-            break;
-        }
-        path_parts.emplace_back(current_path.filename());
-        current_path = current_path.parent_path();
-    }
-
-    // We have found an anchor. Traverse parts we recoded and see if they
-    // exist in filesystem but in different case.
-    auto guest_path = current_path;
-    while (!path_parts.empty()) {
-        const auto part = path_parts.back();
-        const auto add_match = [&](const auto& host_part) {
-            current_path /= host_part;
-            guest_path /= part;
-            path_cache[guest_path] = current_path;
-            path_parts.pop_back();
-        };
-
-        // Can happen when the mismatch is in upper folder.
-        if (std::filesystem::exists(current_path / part)) {
-            add_match(part);
+    // The path does not exist as given, resolve it one component at a time
+    // through the case insensitive index of each directory.
+    auto current_path = mount_path;
+    for (const auto& part : std::filesystem::path(rel_path)) {
+        if (part.empty() || part == "." || part == "..") {
+            current_path /= part;
             continue;
         }
-        const auto part_low = Common::ToLower(part.string());
-        bool found_match = false;
-        for (const auto& path : std::filesystem::directory_iterator(current_path)) {
-            const auto candidate = path.path().filename();
-            const auto filename = Common::ToLower(candidate.string());
-            // Check if a filename matches in case insensitive manner.
-            if (filename != part_low) {
-                continue;
-            }
-            // We found a match, record the actual path in the cache.
-            add_match(candidate);
-            found_match = true;
-            break;
-        }
-        if (!found_match) {
+        const auto entry = FindEntry(current_path, Common::ToLower(part.string()));
+        if (!entry) {
             // Opening the guest path will surely fail but at least gives
             // a better error message than the empty path.
             return host_path;
         }
+        current_path /= *entry;
     }
 
     // The path was found.
     return current_path;
 }
 
+std::optional<std::string> MntPoints::FindEntry(const std::filesystem::path& dir,
+                                                const std::string& name_lower) {
+    std::error_code ec;
+    {
+        std::shared_lock lk{dir_index_mutex};
+        if (const auto it = dir_index.find(dir); it != dir_index.end()) {
+            const auto& index = it->second;
+            if (const auto entry = index.entries.find(name_lower); entry != index.entries.end()) {
+                return entry->second;
+            }
+            // A miss is only trusted while the directory is unchanged since it was indexed.
+            if (std::filesystem::last_write_time(dir, ec) == index.last_write) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    DirIndex index;
+    index.last_write = std::filesystem::last_write_time(dir, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        const auto filename = entry.path().filename().string();
+        index.entries.emplace(Common::ToLower(filename), filename);
+    }
+    std::optional<std::string> result;
+    if (const auto entry = index.entries.find(name_lower); entry != index.entries.end()) {
+        result = entry->second;
+    }
+
+    std::scoped_lock lk{dir_index_mutex};
+    dir_index.insert_or_assign(dir, std::move(index));
+    return result;
+}
+
+std::filesystem::path MntPoints::ExtractFromPackage(PackageFs& package,
+                                                   const std::filesystem::path& extract_folder,
+                                                   std::string_view rel_path) {
+    const auto* node = package.Find(rel_path);
+    if (!node) {
+        // Not in the package, hand out a path that does not exist either.
+        return extract_folder / std::filesystem::path(rel_path).relative_path();
+    }
+
+    // Rebuild the path from the names stored in the package to keep their case.
+    std::vector<const std::string*> names;
+    for (const auto* it = node; it != &package.GetRoot(); it = &package.GetNode(it->parent)) {
+        names.push_back(&it->name);
+    }
+    auto host_path = extract_folder;
+    for (auto it = names.rbegin(); it != names.rend(); ++it) {
+        host_path /= **it;
+    }
+
+    std::scoped_lock lk{extract_mutex};
+    std::error_code ec;
+    if (node->is_dir) {
+        std::filesystem::create_directories(host_path, ec);
+        return host_path;
+    }
+    if (std::filesystem::file_size(host_path, ec) == node->size) {
+        return host_path;
+    }
+    std::filesystem::create_directories(host_path.parent_path(), ec);
+    if (!package.Extract(*node, host_path)) {
+        LOG_ERROR(Kernel_Fs, "Unable to extract {} from package", host_path.string());
+    } else {
+        LOG_INFO(Kernel_Fs, "Extracted {} ({} bytes) from package", host_path.string(),
+                 node->size);
+    }
+    return host_path;
+}
+
+MntPoints::PackagePath MntPoints::GetPackagePath(std::string_view guest_path) {
+    const std::string corrected_path = CorrectGuestPath(guest_path);
+    std::shared_lock lk{m_mutex};
+    const MntPair* mount = GetMount(corrected_path);
+    if (!mount || !mount->package) {
+        return {};
+    }
+    const auto rel_path = std::string_view(corrected_path).substr(mount->mount.size());
+    return {mount->package, mount->package->Find(rel_path)};
+}
+
+HandleTable::~HandleTable() {
+    for (auto& chunk : m_chunks) {
+        delete chunk.load(std::memory_order_relaxed);
+    }
+}
+
 int HandleTable::CreateHandle() {
     std::scoped_lock lock{m_mutex};
 
-    auto* file = new File{};
+    auto* file = AllocateFile();
     file->is_directory = false;
     file->is_opened = false;
 
-    int existingFilesNum = m_files.size();
+    int index;
+    if (!m_free_indices.empty()) {
+        index = m_free_indices.back();
+        m_free_indices.pop_back();
+    } else {
+        index = m_next_index++;
+        ASSERT_MSG(static_cast<size_t>(index) < ChunkSize * MaxChunks, "Out of file handles");
+        auto& chunk = m_chunks[index / ChunkSize];
+        if (index % ChunkSize == 0) {
+            chunk.store(new Chunk{}, std::memory_order_release);
+        }
+    }
+    GetSlot(index + RESERVED_HANDLES)->store(file);
+    return index + RESERVED_HANDLES;
+}
 
-    for (int index = 0; index < existingFilesNum; index++) {
-        if (m_files.at(index) == nullptr) {
-            m_files[index] = file;
-            return index + RESERVED_HANDLES;
+void HandleTable::DeleteHandle(int d) {
+    std::scoped_lock lock{m_mutex};
+    auto* slot = GetSlot(d);
+    File* file = slot ? slot->load(std::memory_order_relaxed) : nullptr;
+    if (file == nullptr) {
+        return;
+    }
+    slot->store(nullptr);
+    if (!file->m_host_name.empty()) {
+        const auto [begin, end] = m_host_names.equal_range(file->m_host_name);
+        const auto it =
+            std::find_if(begin, end, [&](const auto& pair) { return pair.second == file; });
+        if (it != end) {
+            m_host_names.erase(it);
         }
     }
+    m_free_indices.push_back(d - RESERVED_HANDLES);
+    m_retired_files.push_back(file);
+}
 
-    m_files.push_back(file);
-    return m_files.size() + RESERVED_HANDLES - 1;
+FileRef HandleTable::GetFile(int d) {
+    auto* slot = GetSlot(d);
+    if (slot == nullptr) {
+        return {};
+    }
+    // Files are never freed while the table exists, so taking a reference on a file that was
+    // deleted in the meantime is harmless. It is dropped again once the slot no longer matches.
+    // Both the increment and the reload are sequentially consistent to pair with the slot store
+    // in DeleteHandle and the reference count check in AllocateFile.
+    File* file = slot->load(std::memory_order_acquire);
+    while (file != nullptr) {
+        file->refs.fetch_add(1);
+        File* current = slot->load();
+        if (current == file) {
+            return FileRef{file};
+        }
+        file->refs.fetch_sub(1);
+        file = current;
+    }
+    return {};
 }
 
-void HandleTable::DeleteHandle(int d) {
+FileRef HandleTable::GetFile(const std::filesystem::path& host_name) {
     std::scoped_lock lock{m_mutex};
-    delete m_files.at(d - RESERVED_HANDLES);
-    m_files[d - RESERVED_HANDLES] = nullptr;
+    const auto it = m_host_names.find(host_name);
+    if (it == m_host_names.end()) {
+        return {};
+    }
+    it->second->refs.fetch_add(1);
+    return FileRef{it->second};
 }
 
-File* HandleTable::GetFile(int d) {
+void HandleTable::RegisterHostName(int d) {
     std::scoped_lock lock{m_mutex};
-    return m_files.at(d - RESERVED_HANDLES);
+    File* file = GetSlot(d)->load(std::memory_order_relaxed);
+    m_host_names.emplace(file->m_host_name, file);
 }
 
-File* HandleTable::GetFile(const std::filesystem::path& host_name) {
-    for (auto* file : m_files) {
-        if (file != nullptr && file->m_host_name == host_name) {
-            return file;
-        }
+std::atomic<File*>* HandleTable::GetSlot(int d) {
+    const int index = d - RESERVED_HANDLES;
+    if (index < 0 || index >= static_cast<int>(ChunkSize * MaxChunks)) {
+        return nullptr;
     }
-    return nullptr;
+    auto* chunk = m_chunks[index / ChunkSize].load(std::memory_order_acquire);
+    return chunk ? &(*chunk)[index % ChunkSize] : nullptr;
+}
+
+File* HandleTable::AllocateFile() {
+    const auto it = std::ranges::find_if(m_retired_files,
+                                         [](const File* file) { return file->refs.load() == 0; });
+    if (it == m_retired_files.end()) {
+        return m_files.emplace_back(std::make_unique<File>()).get();
+    }
+    File* file = *it;
+    *it = m_retired_files.back();
+    m_retired_files.pop_back();
+
+    // A lookup racing with the reuse may still bump refs, but it backs off without touching the
+    // other members, so they can be reset in place.
+    file->m_host_name.clear();
+    file->m_guest_name.clear();
+    file->f.Close();
+    file->dirents.clear();
+    file->dirents_index = 0;
+    file->package.reset();
+    file->package_node = nullptr;
+    file->package_pos = 0;
+    return file;
 }
 
 } // namespace Core::FileSys
@@ -3,12 +3,19 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include <tsl/robin_map.h>
 #include "common/io_file.h"
+#include "core/file_sys/pkg_fs.h"
 
 namespace Core::FileSys {
 
@@ -20,19 +27,33 @@ class MntPoints {
 #endif
 public:
     struct MntPair {
-        std::filesystem::path host_path;
-        std::string mount; // e.g /app0/
+        std::filesystem::path host_path; // For packages, where files are extracted on demand.
+        std::string mount;               // e.g /app0/
+        std::shared_ptr<PackageFs> package;
+    };
+
+    struct PackagePath {
+        std::shared_ptr<PackageFs> package;
+        const PackageFs::Node* node{};
     };
 
     explicit MntPoints() = default;
     ~MntPoints() = default;
 
     void Mount(const std::filesystem::path& host_folder, const std::string& guest_folder);
+    void Mount(std::shared_ptr<PackageFs> package, const std::string& guest_folder,
+               const std::filesystem::path& extract_folder);
     void Unmount(const std::filesystem::path& host_folder, const std::string& guest_folder);
     void UnmountAll();
 
+    /// Returns the host path of a guest path. Files on a package mount are extracted to the
+    /// mount's extract folder first, for callers that need a real file on the host.
     std::filesystem::path GetHostPath(std::string_view guest_directory);
 
+    /// Resolves a path on a package mount. package is null when the path is on a host folder
+    /// mount, node is null when the path does not exist in the package.
+    PackagePath GetPackagePath(std::string_view guest_path);
+
     const MntPair* GetMount(const std::string& guest_path) {
         const auto it = std::ranges::find_if(
             m_mnt_pairs, [&](const auto& mount) { return guest_path.starts_with(mount.mount); });
@@ -40,10 +61,23 @@ public:
     }
 
 private:
+    /// Lowercase names of the entries of a host directory, mapped to their actual names.
+    struct DirIndex {
+        std::filesystem::file_time_type last_write;
+        tsl::robin_map<std::string, std::string> entries;
+    };
+
+    std::optional<std::string> FindEntry(const std::filesystem::path& dir,
+                                         const std::string& name_lower);
+    std::filesystem::path ExtractFromPackage(PackageFs& package,
+                                             const std::filesystem::path& extract_folder,
+                                             std::string_view rel_path);
+
     std::vector<MntPair> m_mnt_pairs;
-    std::vector<std::filesystem::path> path_parts;
-    tsl::robin_map<std::filesystem::path, std::filesystem::path> path_cache;
-    std::mutex m_mutex;
+    tsl::robin_map<std::filesystem::path, DirIndex> dir_index;
+    std::shared_mutex dir_index_mutex;
+    std::mutex extract_mutex;
+    std::shared_mutex m_mutex;
 };
 
 struct DirEntry {
@@ -60,20 +94,92 @@ struct File {
     std::vector<DirEntry> dirents;
     u32 dirents_index;
     std::mutex m_mutex;
+    std::shared_ptr<PackageFs> package;
+    const PackageFs::Node* package_node{};
+    u64 package_pos{};
+    std::atomic<u32> refs{}; ///< Number of FileRefs currently using the file.
+};
+
+/// Reference to an open file, keeps it from being recycled while a call is still using it.
+class FileRef {
+public:
+    FileRef() = default;
+    explicit FileRef(File* file_) : file{file_} {}
+    ~FileRef() {
+        Release();
+    }
+
+    FileRef(const FileRef&) = delete;
+    FileRef& operator=(const FileRef&) = delete;
+
+    FileRef(FileRef&& other) noexcept : file{std::exchange(other.file, nullptr)} {}
+    FileRef& operator=(FileRef&& other) noexcept {
+        Release();
+        file = std::exchange(other.file, nullptr);
+        return *this;
+    }
+
+    File* get() const {
+        return file;
+    }
+    File* operator->() const {
+        return file;
+    }
+    File& operator*() const {
+        return *file;
+    }
+    explicit operator bool() const {
+        return file != nullptr;
+    }
+    bool operator==(std::nullptr_t) const {
+        return file == nullptr;
+    }
+
+private:
+    void Release() {
+        if (file) {
+            file->refs.fetch_sub(1);
+        }
+    }
+
+    File* file{};
 };
 
+/**
+ * Descriptor table. Slots live in fixed size chunks that are never moved or freed while the
+ * table exists, so looking up a descriptor is a lock-free pair of atomic loads and a reference
+ * count increment. Creating and deleting handles takes the table lock and recycles descriptors
+ * through a free list. Deleted files are retired rather than freed, and only reused once no
+ * FileRef points at them anymore.
+ */
 class HandleTable {
+    static constexpr size_t ChunkSize = 256;
+    static constexpr size_t MaxChunks = 1024;
+
 public:
     HandleTable() = default;
-    virtual ~HandleTable() = default;
+    virtual ~HandleTable();
 
     int CreateHandle();
     void DeleteHandle(int d);
-    File* GetFile(int d);
-    File* GetFile(const std::filesystem::path& host_name);
+    FileRef GetFile(int d);
+    FileRef GetFile(const std::filesystem::path& host_name);
+
+    /// Makes an open file findable by its host path, once its m_host_name is set.
+    void RegisterHostName(int d);
 
 private:
-    std::vector<File*> m_files;
+    using Chunk = std::array<std::atomic<File*>, ChunkSize>;
+
+    std::atomic<File*>* GetSlot(int d);
+    File* AllocateFile();
+
+    std::array<std::atomic<Chunk*>, MaxChunks> m_chunks{};
+    std::vector<std::unique_ptr<File>> m_files; ///< Every file ever allocated, live or retired.
+    std::vector<File*> m_retired_files;
+    std::vector<int> m_free_indices;
+    int m_next_index{};
+    std::unordered_multimap<std::filesystem::path, File*> m_host_names;
     std::mutex m_mutex;
 };
 
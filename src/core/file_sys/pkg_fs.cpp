@@ -0,0 +1,493 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <cstring>
+#include <zlib-ng.h>
+#include "common/alignment.h"
+#include "common/io_file.h"
+#include "common/logging/log.h"
+#include "common/string_util.h"
+#include "core/file_format/pkg.h"
+#include "core/file_format/pkg_type.h"
+#include "core/file_sys/pkg_fs.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Core::FileSys {
+
+static constexpr u32 PkgMagic = 0x7F434E54;
+static constexpr u32 PfscMagic = 0x43534650;
+static constexpr u64 XtsSectorSize = 0x1000;
+static constexpr u64 DinodeSize = 0xA8;
+static constexpr u64 BlockCacheSize = 64_MB;
+
+static bool InflateBlock(std::span<const u8> compressed, std::span<u8> decompressed) {
+    zng_stream stream{};
+    if (zng_inflateInit(&stream) != Z_OK) {
+        return false;
+    }
+    stream.avail_in = static_cast<u32>(compressed.size());
+    stream.next_in = compressed.data();
+    stream.avail_out = static_cast<u32>(decompressed.size());
+    stream.next_out = decompressed.data();
+    const int result = zng_inflate(&stream, Z_FINISH);
+    zng_inflateEnd(&stream);
+    return result == Z_STREAM_END;
+}
+
+PackageFs::PackageFs() = default;
+
+PackageFs::~PackageFs() {
+    UnmapPackage();
+}
+
+bool PackageFs::Open(const std::filesystem::path& pkg_path) {
+    if (!MapPackage(pkg_path)) {
+        return false;
+    }
+    PKGHeader header;
+    if (pkg_size < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, pkg_data, sizeof(header));
+    if (header.magic != PkgMagic || header.pkg_size > pkg_size ||
+        header.pfs_image_offset + header.pfs_image_size > pkg_size) {
+        LOG_ERROR(Kernel_Fs, "{} is not a valid package", pkg_path.string());
+        return false;
+    }
+    // Title id is part of the content id, after the 7 character publisher prefix.
+    title_id.assign(reinterpret_cast<const char*>(header.pkg_content_id) + 7, 9);
+    pfs_offset = header.pfs_image_offset;
+    pfs_size = header.pfs_image_size;
+
+    nodes.clear();
+    path_index.clear();
+    AddNode(0, "", true);
+    if (!DeriveKeys() || !ParsePfs()) {
+        LOG_ERROR(Kernel_Fs, "Unable to read the filesystem of package {}", pkg_path.string());
+        return false;
+    }
+    AddEntryFiles();
+    max_cached_blocks = std::max<size_t>(BlockCacheSize / block_size, 1);
+    LOG_INFO(Kernel_Fs, "Mounted package {} ({} files and directories, {} blocks)", title_id,
+             nodes.size(), block_offsets.size() - 1);
+    return true;
+}
+
+const PackageFs::Node* PackageFs::Find(std::string_view path) const {
+    while (path.starts_with('/')) {
+        path.remove_prefix(1);
+    }
+    while (path.ends_with('/')) {
+        path.remove_suffix(1);
+    }
+    const auto it = path_index.find(Common::ToLower(std::string{path}));
+    return it != path_index.end() ? &nodes[it->second] : nullptr;
+}
+
+size_t PackageFs::Read(const Node& node, u64 offset, std::span<u8> out) {
+    if (node.is_dir || offset >= node.size) {
+        return 0;
+    }
+    const size_t size = std::min<u64>(out.size(), node.size - offset);
+    // Files from the package entry table are stored in the clear (or decrypted on open).
+    if (node.data.data() != nullptr) {
+        std::memcpy(out.data(), node.data.data() + offset, size);
+        stats.Add(Counter::BytesRead, size);
+        return size;
+    }
+    size_t copied = 0;
+    while (copied < size) {
+        const u64 pos = offset + copied;
+        const u32 block = node.first_block + static_cast<u32>(pos / block_size);
+        const u64 block_offset = pos % block_size;
+        const size_t chunk = std::min<u64>(block_size - block_offset, size - copied);
+        copied += ReadBlock(block, block_offset, out.subspan(copied, chunk));
+    }
+    return copied;
+}
+
+bool PackageFs::Extract(const Node& node, const std::filesystem::path& dest) {
+    Common::FS::IOFile file(dest, Common::FS::FileAccessMode::Write);
+    if (!file.IsOpen()) {
+        return false;
+    }
+    std::vector<u8> buffer(block_size);
+    for (u64 offset = 0; offset < node.size;) {
+        const size_t read = Read(node, offset, buffer);
+        if (file.WriteRaw<u8>(buffer.data(), read) != read) {
+            return false;
+        }
+        offset += read;
+    }
+    return true;
+}
+
+bool PackageFs::MapPackage(const std::filesystem::path& pkg_path) {
+#ifdef _WIN32
+    file_handle = CreateFileW(pkg_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        file_handle = nullptr;
+        return false;
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(file_handle, &size);
+    pkg_size = size.QuadPart;
+    mapping_handle = CreateFileMappingW(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_handle) {
+        return false;
+    }
+    pkg_data = static_cast<const u8*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+#else
+    const int fd = open(pkg_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    pkg_size = st.st_size;
+    void* data = mmap(nullptr, pkg_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    pkg_data = data != MAP_FAILED ? static_cast<const u8*>(data) : nullptr;
+#endif
+    if (!pkg_data) {
+        LOG_ERROR(Kernel_Fs, "Unable to map package {}", pkg_path.string());
+        return false;
+    }
+    return true;
+}
+
+void PackageFs::UnmapPackage() {
+#ifdef _WIN32
+    if (pkg_data) {
+        UnmapViewOfFile(pkg_data);
+    }
+    if (mapping_handle) {
+        CloseHandle(mapping_handle);
+    }
+    if (file_handle) {
+        CloseHandle(file_handle);
+    }
+    file_handle = nullptr;
+    mapping_handle = nullptr;
+#else
+    if (pkg_data) {
+        munmap(const_cast<u8*>(pkg_data), pkg_size);
+    }
+#endif
+    pkg_data = nullptr;
+}
+
+bool PackageFs::DeriveKeys() {
+    PKGHeader header;
+    std::memcpy(&header, pkg_data, sizeof(header));
+    const u64 table_offset = header.pkg_table_entry_offset;
+    const u32 num_entries = header.pkg_table_entry_count;
+    if (table_offset + num_entries * sizeof(PKGEntry) > pkg_size) {
+        return false;
+    }
+
+    const auto* raw_entries = pkg_data + table_offset;
+    std::array<u8, 32> dk3{};
+    std::array<u8, 32> ekpfs{};
+    bool has_dk3 = false;
+    bool has_ekpfs = false;
+    for (u32 i = 0; i < num_entries; i++) {
+        PKGEntry entry;
+        std::memcpy(&entry, raw_entries + i * sizeof(PKGEntry), sizeof(entry));
+        if (u64{entry.offset} + entry.size > pkg_size) {
+            return false;
+        }
+        if (entry.id == 0x10) {
+            // ENTRY_KEYS: seed digest, 7 digests and 7 keys, of which the 4th holds dk3.
+            static constexpr u64 Dk3Offset = 32 + 7 * 32 + 3 * 256;
+            const std::span<const u8, 256> key{pkg_data + entry.offset + Dk3Offset, 256};
+            crypto.RSA2048Decrypt(dk3, key, true);
+            has_dk3 = true;
+        } else if (entry.id == 0x20 && has_dk3) {
+            // IMAGE_KEY: decrypted with the hash of the entry itself and dk3.
+            std::array<u8, 64> concatenated_ivkey_dk3;
+            std::memcpy(concatenated_ivkey_dk3.data(), raw_entries + i * sizeof(PKGEntry),
+                        sizeof(PKGEntry));
+            std::memcpy(concatenated_ivkey_dk3.data() + sizeof(PKGEntry), dk3.data(), dk3.size());
+            std::array<u8, 32> iv_key;
+            std::array<u8, 256> img_key;
+            crypto.ivKeyHASH256(concatenated_ivkey_dk3, iv_key);
+            const std::span<const u8, 256> img_key_data{pkg_data + entry.offset, 256};
+            crypto.aesCbcCfb128Decrypt(iv_key, img_key_data, img_key);
+            crypto.RSA2048Decrypt(ekpfs, img_key, false);
+            has_ekpfs = true;
+        } else if (entry.id >= 0x400 && entry.id <= 0x403 && has_dk3) {
+            // NP files are encrypted with a key derived the same way as the image key.
+            std::array<u8, 64> concatenated_ivkey_dk3;
+            std::memcpy(concatenated_ivkey_dk3.data(), raw_entries + i * sizeof(PKGEntry),
+                        sizeof(PKGEntry));
+            std::memcpy(concatenated_ivkey_dk3.data() + sizeof(PKGEntry), dk3.data(), dk3.size());
+            std::array<u8, 32> iv_key;
+            crypto.ivKeyHASH256(concatenated_ivkey_dk3, iv_key);
+            std::vector<u8> cipher(pkg_data + entry.offset, pkg_data + entry.offset + entry.size);
+            auto& decrypted = decrypted_entries[entry.id];
+            decrypted.resize(entry.size);
+            crypto.aesCbcCfb128DecryptEntry(iv_key, cipher, decrypted);
+        }
+    }
+    if (!has_ekpfs) {
+        return false;
+    }
+
+    const std::span<const u8, 16> seed{pkg_data + pfs_offset + 0x370, 16};
+    crypto.PfsGenCryptoKey(ekpfs, seed, data_key, tweak_key);
+    return true;
+}
+
+void PackageFs::DecryptRange(u64 offset, std::span<u8> out) {
+    const u64 start = Common::AlignDown(offset, XtsSectorSize);
+    const u64 end = std::min(Common::AlignUp(offset + out.size(), XtsSectorSize), pfs_size);
+    if (end <= start) {
+        std::ranges::fill(out, 0);
+        return;
+    }
+    std::vector<u8> decrypted(end - start);
+    const std::span<const u8> encrypted{pkg_data + pfs_offset + start, end - start};
+    crypto.decryptPFS(data_key, tweak_key, encrypted, decrypted, start / XtsSectorSize);
+    const size_t available = std::min<u64>(out.size(), end - offset);
+    std::memcpy(out.data(), decrypted.data() + (offset - start), available);
+    std::fill(out.begin() + available, out.end(), 0);
+}
+
+bool PackageFs::ParsePfs() {
+    // The inner PFSC image starts on a 64KB boundary past the outer PFS header.
+    pfsc_offset = 0;
+    for (u64 offset = 0x20000; offset + XtsSectorSize <= pfs_size; offset += 0x10000) {
+        u32 magic;
+        DecryptRange(offset, {reinterpret_cast<u8*>(&magic), sizeof(magic)});
+        if (magic == PfscMagic) {
+            pfsc_offset = offset;
+            break;
+        }
+    }
+    if (pfsc_offset == 0) {
+        return false;
+    }
+
+    PFSCHdr pfsc_header;
+    DecryptRange(pfsc_offset, {reinterpret_cast<u8*>(&pfsc_header), sizeof(pfsc_header)});
+    block_size = static_cast<u32>(pfsc_header.block_sz2);
+    if (block_size == 0 || block_size % XtsSectorSize != 0) {
+        return false;
+    }
+    const u64 num_blocks = pfsc_header.data_length / block_size;
+    block_offsets.resize(num_blocks + 1);
+    DecryptRange(pfsc_offset + pfsc_header.block_offsets,
+                 {reinterpret_cast<u8*>(block_offsets.data()), block_offsets.size() * sizeof(u64)});
+
+    // Block 0 holds the superblock of the inner PFS, followed by the inode table.
+    std::vector<u8> block;
+    if (!DecodeBlock(0, block)) {
+        return false;
+    }
+    PSFHeader_ superblock;
+    std::memcpy(&superblock, block.data(), sizeof(superblock));
+    const u64 inodes_per_block = block_size / DinodeSize;
+    inodes.resize(superblock.dinode_count);
+    for (u64 i = 0; i < inodes.size(); i++) {
+        const u32 inode_block = static_cast<u32>(1 + i / inodes_per_block);
+        if (i % inodes_per_block == 0 && !DecodeBlock(inode_block, block)) {
+            return false;
+        }
+        std::memcpy(&inodes[i], block.data() + (i % inodes_per_block) * DinodeSize,
+                    sizeof(Inode));
+    }
+
+    // The super root holds the flat path table and uroot, the user visible root directory.
+    s32 uroot = -1;
+    ForEachDirent(static_cast<u32>(superblock.superroot_ino), [&](const Dirent& dirent) {
+        if (dirent.type == PFS_DIR && std::string_view{dirent.name} == "uroot") {
+            uroot = dirent.ino;
+        }
+        return true;
+    });
+    return uroot >= 0 && ParseDirectory(0, uroot);
+}
+
+bool PackageFs::ForEachDirent(u32 inode_index, const std::function<bool(const Dirent&)>& func) {
+    if (inode_index >= inodes.size()) {
+        return false;
+    }
+    const Inode inode = inodes[inode_index];
+    std::vector<u8> block;
+    for (u32 i = 0; i < inode.Blocks; i++) {
+        if (!DecodeBlock(inode.loc + i, block)) {
+            return false;
+        }
+        for (u64 pos = 0; pos + offsetof(Dirent, name) <= block_size;) {
+            Dirent dirent;
+            std::memcpy(&dirent, block.data() + pos, offsetof(Dirent, name));
+            const auto namelen = static_cast<u64>(dirent.namelen);
+            if (dirent.ino == 0 || dirent.entsize <= 0 || namelen >= sizeof(dirent.name) ||
+                pos + offsetof(Dirent, name) + namelen > block_size) {
+                break;
+            }
+            std::memcpy(dirent.name, block.data() + pos + offsetof(Dirent, name), namelen);
+            dirent.name[namelen] = '\0';
+            pos += dirent.entsize;
+            if (dirent.type != PFS_CURRENT_DIR && dirent.type != PFS_PARENT_DIR && !func(dirent)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool PackageFs::ParseDirectory(u32 node_index, u32 inode_index) {
+    return ForEachDirent(inode_index, [&](const Dirent& dirent) {
+        const bool is_dir = dirent.type == PFS_DIR;
+        if (!is_dir && dirent.type != PFS_FILE) {
+            return true;
+        }
+        const u32 child = AddNode(node_index, std::string(dirent.name, dirent.namelen), is_dir);
+        if (is_dir) {
+            return ParseDirectory(child, dirent.ino);
+        }
+        if (static_cast<u32>(dirent.ino) < inodes.size()) {
+            nodes[child].size = inodes[dirent.ino].Size;
+            nodes[child].first_block = inodes[dirent.ino].loc;
+        }
+        return true;
+    });
+}
+
+void PackageFs::AddEntryFiles() {
+    // Files like param.sfo live in the package entry table rather than the PFS image.
+    u32 sce_sys = 0;
+    if (const Node* node = Find("sce_sys")) {
+        sce_sys = static_cast<u32>(node - nodes.data());
+    } else {
+        sce_sys = AddNode(0, "sce_sys", true);
+    }
+
+    PKGHeader header;
+    std::memcpy(&header, pkg_data, sizeof(header));
+    for (u32 i = 0; i < header.pkg_table_entry_count; i++) {
+        PKGEntry entry;
+        std::memcpy(&entry, pkg_data + header.pkg_table_entry_offset + i * sizeof(PKGEntry),
+                    sizeof(entry));
+        const auto name = GetEntryNameByType(entry.id);
+        if (name.empty() || entry.id < 0x400) {
+            continue;
+        }
+        std::span<const u8> data{pkg_data + entry.offset, entry.size};
+        if (const auto it = decrypted_entries.find(entry.id); it != decrypted_entries.end()) {
+            data = it->second;
+        }
+
+        // Names may contain a subdirectory, e.g trophy/trophy00.trp
+        u32 parent = sce_sys;
+        std::string_view remaining = name;
+        for (auto slash = remaining.find('/'); slash != std::string_view::npos;
+             slash = remaining.find('/')) {
+            const auto dir_name = remaining.substr(0, slash);
+            const Node* dir = Find(nodes[parent].path + '/' + std::string{dir_name});
+            parent = dir ? static_cast<u32>(dir - nodes.data())
+                         : AddNode(parent, std::string{dir_name}, true);
+            remaining.remove_prefix(slash + 1);
+        }
+        if (Find(nodes[parent].path + '/' + std::string{remaining})) {
+            continue;
+        }
+        const u32 node = AddNode(parent, std::string{remaining}, false);
+        nodes[node].size = data.size();
+        nodes[node].data = data;
+    }
+}
+
+u32 PackageFs::AddNode(u32 parent, std::string name, bool is_dir) {
+    const u32 index = static_cast<u32>(nodes.size());
+    std::string path;
+    if (index != 0) {
+        path = nodes[parent].path.empty() ? "" : nodes[parent].path + '/';
+        path += Common::ToLower(name);
+        nodes[parent].children.push_back(index);
+    }
+    path_index.emplace(path, index);
+    auto& node = nodes.emplace_back();
+    node.name = std::move(name);
+    node.path = std::move(path);
+    node.parent = parent;
+    node.is_dir = is_dir;
+    return index;
+}
+
+bool PackageFs::DecodeBlock(u32 block, std::vector<u8>& out) {
+    if (block + 1 >= block_offsets.size()) {
+        LOG_ERROR(Kernel_Fs, "Package block {} is out of range", block);
+        return false;
+    }
+    const u64 start = block_offsets[block];
+    const u64 size = block_offsets[block + 1] - start;
+    std::vector<u8> raw(size);
+    DecryptRange(pfsc_offset + start, raw);
+    out.resize(block_size);
+    if (size >= block_size) {
+        std::memcpy(out.data(), raw.data(), block_size);
+        return true;
+    }
+    if (size == 0) {
+        // Sparse block.
+        std::ranges::fill(out, 0);
+        return true;
+    }
+    if (!InflateBlock(raw, out)) {
+        LOG_ERROR(Kernel_Fs, "Unable to inflate package block {}", block);
+        return false;
+    }
+    return true;
+}
+
+size_t PackageFs::ReadBlock(u32 block, u64 offset, std::span<u8> out) {
+    {
+        std::scoped_lock lk{cache_mutex};
+        if (auto it = block_cache.find(block); it != block_cache.end()) {
+            lru.splice(lru.begin(), lru, it->second.lru_it);
+            std::memcpy(out.data(), it->second.data.data() + offset, out.size());
+            stats.Add(Counter::BlockHits);
+            stats.Add(Counter::BytesRead, out.size());
+            return out.size();
+        }
+    }
+
+    // Decode without holding the lock so other handles can keep hitting the cache.
+    std::vector<u8> data;
+    if (!DecodeBlock(block, data)) {
+        std::ranges::fill(out, 0);
+        return out.size();
+    }
+    std::memcpy(out.data(), data.data() + offset, out.size());
+
+    stats.Add(Counter::BlockMisses);
+    stats.Add(Counter::BytesRead, out.size());
+    stats.Add(Counter::BytesInflated, block_size);
+
+    std::scoped_lock lk{cache_mutex};
+    if (block_cache.contains(block)) {
+        return out.size();
+    }
+    lru.push_front(block);
+    block_cache.emplace(block, CachedBlock{std::move(data), lru.begin()});
+    while (block_cache.size() > max_cached_blocks) {
+        block_cache.erase(lru.back());
+        lru.pop_back();
+    }
+    return out.size();
+}
+
+} // namespace Core::FileSys
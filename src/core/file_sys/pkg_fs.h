@@ -0,0 +1,125 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <array>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tsl/robin_map.h>
+#include "common/perf_stats.h"
+#include "common/types.h"
+#include "core/crypto/crypto.h"
+#include "core/file_format/pfs.h"
+
+namespace Core::FileSys {
+
+/**
+ * Read-only view of the filesystem inside a .pkg, served without extracting it.
+ * The package is memory mapped and its PFS directory tables are parsed once on open.
+ * File contents are decrypted and inflated a PFSC block at a time on demand, and decoded
+ * blocks are kept in an LRU cache shared by every handle to the package.
+ */
+class PackageFs {
+public:
+    struct Node {
+        std::string name;
+        std::string path; ///< Lowercase path from the package root, used for lookups.
+        u32 parent{};
+        bool is_dir{};
+        u64 size{};
+        u32 first_block{};        ///< First PFSC block of a PFS file.
+        std::span<const u8> data; ///< Contents of a file stored in the package entry table.
+        std::vector<u32> children;
+    };
+
+    PackageFs();
+    ~PackageFs();
+
+    PackageFs(const PackageFs&) = delete;
+    PackageFs& operator=(const PackageFs&) = delete;
+
+    bool Open(const std::filesystem::path& pkg_path);
+
+    /// Looks up a path relative to the package root, ignoring case. Returns null if missing.
+    [[nodiscard]] const Node* Find(std::string_view path) const;
+
+    [[nodiscard]] const Node& GetNode(u32 index) const {
+        return nodes[index];
+    }
+
+    [[nodiscard]] const Node& GetRoot() const {
+        return nodes[0];
+    }
+
+    [[nodiscard]] std::string_view GetTitleID() const {
+        return title_id;
+    }
+
+    /// Copies up to out.size() bytes of a file starting at offset. Returns the bytes read.
+    size_t Read(const Node& node, u64 offset, std::span<u8> out);
+
+    /// Writes a file of the package to a host path.
+    bool Extract(const Node& node, const std::filesystem::path& dest);
+
+private:
+    struct CachedBlock {
+        std::vector<u8> data;
+        std::list<u32>::iterator lru_it;
+    };
+
+    enum class Counter : u32 {
+        BlockHits,
+        BlockMisses,
+        BytesRead,
+        BytesInflated,
+    };
+
+    bool MapPackage(const std::filesystem::path& pkg_path);
+    void UnmapPackage();
+    bool DeriveKeys();
+    bool ParsePfs();
+    bool ForEachDirent(u32 inode, const std::function<bool(const Dirent&)>& func);
+    bool ParseDirectory(u32 node_index, u32 inode);
+    void AddEntryFiles();
+    u32 AddNode(u32 parent, std::string name, bool is_dir);
+    void DecryptRange(u64 pfs_offset, std::span<u8> out);
+    bool DecodeBlock(u32 block, std::vector<u8>& out);
+    size_t ReadBlock(u32 block, u64 offset, std::span<u8> out);
+
+    Crypto crypto;
+    const u8* pkg_data{};
+    u64 pkg_size{};
+#ifdef _WIN32
+    void* file_handle{};
+    void* mapping_handle{};
+#endif
+    std::string title_id;
+    u64 pfs_offset{};
+    u64 pfs_size{};
+    u64 pfsc_offset{};
+    u32 block_size{};
+    std::array<u8, 16> data_key{};
+    std::array<u8, 16> tweak_key{};
+    std::vector<u64> block_offsets;
+    std::vector<Inode> inodes;
+    std::map<u32, std::vector<u8>> decrypted_entries;
+
+    std::vector<Node> nodes;
+    tsl::robin_map<std::string, u32> path_index;
+
+    std::mutex cache_mutex;
+    tsl::robin_map<u32, CachedBlock> block_cache;
+    std::list<u32> lru;
+    size_t max_cached_blocks{};
+    Common::PerfStats<Counter> stats{Common::Log::Class::Kernel_Fs, "Package reads"};
+};
+
+} // namespace Core::FileSys
@@ -15,11 +15,14 @@
 #include "core/libraries/videoout/video_out.h"
 #include "core/platform.h"
 #include "video_core/amdgpu/liverpool.h"
+#include "video_core/amdgpu/pm4_capture.h"
 #include "video_core/amdgpu/pm4_cmds.h"
 #include "video_core/renderer_vulkan/renderer_vulkan.h"
+#include "video_core/renderer_vulkan/vk_null_rasterizer.h"
 
 extern Frontend::WindowSDL* g_window;
 std::unique_ptr<Vulkan::RendererVulkan> renderer;
+std::unique_ptr<Vulkan::NullRasterizer> null_rasterizer;
 std::unique_ptr<AmdGpu::Liverpool> liverpool;
 
 namespace Libraries::GnmDriver {
@@ -281,6 +284,7 @@ static std::mutex m_submission{};
 static u64 frames_submitted{};      // frame counter
 static bool send_init_packet{true}; // initialize HW state before first game's submit in a frame
 static int sdk_version{0};
+static std::unique_ptr<AmdGpu::CaptureWriter> capture; // replayable capture of the submissions
 
 struct AscQueueInfo {
     VAddr map_addr;
@@ -302,6 +306,13 @@ static void WaitGpuIdle() {
     cv_lock.wait(lock, [] { return submission_lock == 0; });
 }
 
+static void SubmitGfx(std::span<const u32> dcb, std::span<const u32> ccb) {
+    if (capture) {
+        capture->SubmitGfx(dcb, ccb);
+    }
+    liverpool->SubmitGfx(dcb, ccb);
+}
+
 static void DumpCommandList(std::span<const u32> cmd_list, const std::string& postfix) {
     using namespace Common::FS;
     const auto dump_dir = GetUserPath(PathType::PM4Dir);
@@ -469,7 +480,7 @@ s32 PS4_SYSV_ABI sceGnmDeleteEqEvent(SceKernelEqueue eq, u64 id) {
         return ORBIS_KERNEL_ERROR_EBADF;
     }
 
-    eq->RemoveEvent(id);
+    eq->RemoveEvent(id, SceKernelEvent::Filter::GraphicsCore);
 
     Platform::IrqC::Instance()->Unregister(Platform::InterruptId::GfxEop, eq);
     return ORBIS_OK;
@@ -522,6 +533,9 @@ void PS4_SYSV_ABI sceGnmDingDong(u32 gnm_vqid, u32 next_offs_dw) {
         DumpCommandList(acb, fmt::format("acb_{}_{}", gnm_vqid, seq_num));
     }
 
+    if (capture) {
+        capture->SubmitAsc(vqid, acb_span);
+    }
     liverpool->SubmitAsc(vqid, acb_span);
 
     *asc_queue.read_addr += acb_size;
@@ -2090,11 +2104,11 @@ s32 PS4_SYSV_ABI sceGnmSubmitCommandBuffers(u32 count, const u32* dcb_gpu_addrs[
 
     if (send_init_packet) {
         if (sdk_version <= 0x1ffffffu) {
-            liverpool->SubmitGfx(InitSequence, {});
+            SubmitGfx(InitSequence, {});
         } else if (sdk_version <= 0x3ffffffu) {
-            liverpool->SubmitGfx(InitSequence200, {});
+            SubmitGfx(InitSequence200, {});
         } else {
-            liverpool->SubmitGfx(InitSequence350, {});
+            SubmitGfx(InitSequence350, {});
         }
         send_init_packet = false;
     }
@@ -2124,7 +2138,7 @@ s32 PS4_SYSV_ABI sceGnmSubmitCommandBuffers(u32 count, const u32* dcb_gpu_addrs[
             DumpCommandList(ccb_span, fmt::format("ccb_{}_{}", seq_num, cbpair));
         }
 
-        liverpool->SubmitGfx(dcb_span, ccb_span);
+        SubmitGfx(dcb_span, ccb_span);
     }
 
     return ORBIS_OK;
@@ -2143,6 +2157,9 @@ int PS4_SYSV_ABI sceGnmSubmitDone() {
     liverpool->SubmitDone();
     send_init_packet = true;
     ++frames_submitted;
+    if (capture) {
+        capture->EndFrame();
+    }
     return ORBIS_OK;
 }
 
@@ -2641,7 +2658,22 @@ int PS4_SYSV_ABI Func_F916890425496553() {
 void RegisterlibSceGnmDriver(Core::Loader::SymbolsResolver* sym) {
     LOG_INFO(Lib_GnmDriver, "Initializing renderer");
     liverpool = std::make_unique<AmdGpu::Liverpool>();
-    renderer = std::make_unique<Vulkan::RendererVulkan>(*g_window, liverpool.get());
+    if (Config::nullGpu()) {
+        // Headless mode, command buffers are fully processed and shaders translated but
+        // nothing is recorded or presented, so no Vulkan device is needed.
+        LOG_INFO(Lib_GnmDriver, "Null GPU enabled, skipping renderer creation");
+        null_rasterizer = std::make_unique<Vulkan::NullRasterizer>(liverpool.get());
+    } else {
+        renderer = std::make_unique<Vulkan::RendererVulkan>(*g_window, liverpool.get());
+    }
+
+    if (Config::dumpPM4() && Config::getPm4CaptureFrames() > 0) {
+        const auto dump_dir = Common::FS::GetUserPath(Common::FS::PathType::PM4Dir);
+        std::filesystem::create_directories(dump_dir);
+        capture = std::make_unique<AmdGpu::CaptureWriter>(
+            dump_dir / "capture.pm4cap", Config::getPm4CaptureFrames(), liverpool.get(),
+            renderer ? &renderer->GetPageManager() : nullptr);
+    }
 
     const int result = sceKernelGetCompiledSdkVersion(&sdk_version);
     if (result != ORBIS_OK) {
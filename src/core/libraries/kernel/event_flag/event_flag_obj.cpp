@@ -1,75 +1,155 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
-#include <thread>
+#include <chrono>
+#include <pthread.h>
+#include "common/futex.h"
 #include "core/libraries/error_codes.h"
 #include "event_flag_obj.h"
 
 namespace Libraries::Kernel {
+
+EventFlagInternal::~EventFlagInternal() {
+    std::scoped_lock lock{m_mutex};
+    while (!m_wait_list.empty()) {
+        auto& waiter = m_wait_list.front();
+        m_wait_list.pop_front();
+        waiter.Wake(Status::Deleted);
+    }
+}
+
+void EventFlagInternal::WaitingThread::Wake(Status new_status) {
+    // The waiter may return as soon as it sees the new status, only its address is used after.
+    const auto* word = &status;
+    status.store(static_cast<u32>(new_status), std::memory_order_release);
+    Common::FutexWake(word, 1);
+}
+
+bool EventFlagInternal::TryAcquire(u64 bits, WaitMode wait_mode, ClearMode clear_mode,
+                                   u64* result) {
+    u64 cur = m_bits.load(std::memory_order_seq_cst);
+    while (true) {
+        const bool satisfied = wait_mode == WaitMode::And ? (cur & bits) == bits : (cur & bits) != 0;
+        if (!satisfied) {
+            return false;
+        }
+        u64 desired = cur;
+        if (clear_mode == ClearMode::All) {
+            desired = 0;
+        } else if (clear_mode == ClearMode::Bits) {
+            desired &= ~bits;
+        }
+        if (desired == cur || m_bits.compare_exchange_weak(cur, desired)) {
+            if (result != nullptr) {
+                *result = cur;
+            }
+            return true;
+        }
+    }
+}
+
+void EventFlagInternal::AddWaiter(WaitingThread& waiter) {
+    if (m_queue_mode == QueueMode::Fifo) {
+        m_wait_list.push_back(waiter);
+        return;
+    }
+    s32 policy;
+    sched_param param;
+    pthread_getschedparam(pthread_self(), &policy, &param);
+    waiter.priority = param.sched_priority;
+
+    // Find the first with priority less then us and insert right before it.
+    auto it = m_wait_list.begin();
+    while (it != m_wait_list.end() && it->priority > waiter.priority) {
+        it++;
+    }
+    m_wait_list.insert(it, waiter);
+}
+
 int EventFlagInternal::Wait(u64 bits, WaitMode wait_mode, ClearMode clear_mode, u64* result,
                             u32* ptr_micros) {
-    std::unique_lock lock{m_mutex};
-
-    uint32_t micros = 0;
-    bool infinitely = true;
-    if (ptr_micros != nullptr) {
-        micros = *ptr_micros;
-        infinitely = false;
+    // Uncontended fast path, the pattern is already set.
+    if (m_waiting_threads.load(std::memory_order_relaxed) == 0 &&
+        TryAcquire(bits, wait_mode, clear_mode, result)) {
+        return ORBIS_OK;
     }
 
+    std::unique_lock lock{m_mutex};
+
     if (m_thread_mode == ThreadMode::Single && m_waiting_threads > 0) {
         return ORBIS_KERNEL_ERROR_EPERM;
     }
 
-    auto const start = std::chrono::system_clock::now();
-    m_waiting_threads++;
-    auto waitFunc = [this, wait_mode, bits] {
-        return (m_status == Status::Canceled || m_status == Status::Deleted ||
-                (wait_mode == WaitMode::And && (m_bits & bits) == bits) ||
-                (wait_mode == WaitMode::Or && (m_bits & bits) != 0));
-    };
+    // Announce ourselves before re-checking, a Set that misses the waiter count has already
+    // published its bits to us.
+    m_waiting_threads.fetch_add(1, std::memory_order_seq_cst);
+    if (TryAcquire(bits, wait_mode, clear_mode, result)) {
+        m_waiting_threads.fetch_sub(1, std::memory_order_relaxed);
+        return ORBIS_OK;
+    }
+    if (ptr_micros != nullptr && *ptr_micros == 0) {
+        m_waiting_threads.fetch_sub(1, std::memory_order_relaxed);
+        if (result != nullptr) {
+            *result = m_bits;
+        }
+        return ORBIS_KERNEL_ERROR_ETIMEDOUT;
+    }
 
-    if (infinitely) {
-        m_cond_var.wait(lock, waitFunc);
+    WaitingThread waiter;
+    waiter.bits = bits;
+    waiter.wait_mode = wait_mode;
+    waiter.clear_mode = clear_mode;
+    AddWaiter(waiter);
+    lock.unlock();
+
+    constexpr u32 Waiting = static_cast<u32>(Status::Waiting);
+    const auto start = std::chrono::steady_clock::now();
+    if (ptr_micros == nullptr) {
+        while (waiter.IsWaiting()) {
+            Common::FutexWait(waiter.status, Waiting);
+        }
     } else {
-        if (!m_cond_var.wait_for(lock, std::chrono::microseconds(micros), waitFunc)) {
-            if (result != nullptr) {
-                *result = m_bits;
+        const auto end = start + std::chrono::microseconds(*ptr_micros);
+        while (waiter.IsWaiting()) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= end) {
+                break;
             }
-            *ptr_micros = 0;
-            --m_waiting_threads;
-            return ORBIS_KERNEL_ERROR_ETIMEDOUT;
+            const std::chrono::nanoseconds remaining = end - now;
+            Common::FutexWait(waiter.status, Waiting, &remaining);
         }
-    }
-    --m_waiting_threads;
-    if (result != nullptr) {
-        *result = m_bits;
+        if (waiter.IsWaiting()) {
+            // Timed out, unless a Set satisfied us before we got the lock back.
+            lock.lock();
+            if (waiter.IsWaiting()) {
+                m_wait_list.erase(m_wait_list.iterator_to(waiter));
+                m_waiting_threads.fetch_sub(1, std::memory_order_relaxed);
+                if (result != nullptr) {
+                    *result = m_bits;
+                }
+                *ptr_micros = 0;
+                return ORBIS_KERNEL_ERROR_ETIMEDOUT;
+            }
+            lock.unlock();
+        }
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+        *ptr_micros = (elapsed >= *ptr_micros ? 0 : *ptr_micros - elapsed);
     }
 
-    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
-                       std::chrono::system_clock::now() - start)
-                       .count();
     if (result != nullptr) {
-        *result = m_bits;
-    }
-
-    if (ptr_micros != nullptr) {
-        *ptr_micros = (elapsed >= micros ? 0 : micros - elapsed);
+        *result = waiter.result;
     }
 
-    if (m_status == Status::Canceled) {
+    switch (static_cast<Status>(waiter.status.load(std::memory_order_acquire))) {
+    case Status::Canceled:
         return ORBIS_KERNEL_ERROR_ECANCELED;
-    } else if (m_status == Status::Deleted) {
+    case Status::Deleted:
         return ORBIS_KERNEL_ERROR_EACCES;
+    default:
+        return ORBIS_OK;
     }
-
-    if (clear_mode == ClearMode::All) {
-        m_bits = 0;
-    } else if (clear_mode == ClearMode::Bits) {
-        m_bits &= ~bits;
-    }
-
-    return ORBIS_OK;
 }
 
 int EventFlagInternal::Poll(u64 bits, WaitMode wait_mode, ClearMode clear_mode, u64* result) {
@@ -83,28 +163,43 @@ int EventFlagInternal::Poll(u64 bits, WaitMode wait_mode, ClearMode clear_mode,
 }
 
 void EventFlagInternal::Set(u64 bits) {
-    std::unique_lock lock{m_mutex};
-
-    while (m_status != Status::Set) {
-        m_mutex.unlock();
-        std::this_thread::sleep_for(std::chrono::microseconds(10));
-        m_mutex.lock();
+    m_bits.fetch_or(bits, std::memory_order_seq_cst);
+    if (m_waiting_threads.load(std::memory_order_seq_cst) == 0) {
+        return;
     }
 
-    m_bits |= bits;
-
-    m_cond_var.notify_all();
+    // Wake exactly the waiters whose pattern is now satisfied, in queue order. Clearing
+    // waiters consume their bits before the ones behind them are checked.
+    std::scoped_lock lock{m_mutex};
+    for (auto it = m_wait_list.begin(); it != m_wait_list.end();) {
+        auto& waiter = *it;
+        if (!TryAcquire(waiter.bits, waiter.wait_mode, waiter.clear_mode, &waiter.result)) {
+            it++;
+            continue;
+        }
+        it = m_wait_list.erase(it);
+        m_waiting_threads.fetch_sub(1, std::memory_order_relaxed);
+        waiter.Wake(Status::Set);
+    }
 }
 
 void EventFlagInternal::Clear(u64 bits) {
-    std::unique_lock lock{m_mutex};
-    while (m_status != Status::Set) {
-        m_mutex.unlock();
-        std::this_thread::sleep_for(std::chrono::microseconds(10));
-        m_mutex.lock();
-    }
+    m_bits.fetch_and(bits);
+}
 
-    m_bits &= bits;
+void EventFlagInternal::Cancel(u64 set_pattern, int* num_waiters) {
+    std::scoped_lock lock{m_mutex};
+    if (num_waiters != nullptr) {
+        *num_waiters = m_waiting_threads.load(std::memory_order_relaxed);
+    }
+    m_bits = set_pattern;
+    while (!m_wait_list.empty()) {
+        auto& waiter = m_wait_list.front();
+        m_wait_list.pop_front();
+        waiter.result = set_pattern;
+        m_waiting_threads.fetch_sub(1, std::memory_order_relaxed);
+        waiter.Wake(Status::Canceled);
+    }
 }
 
 } // namespace Libraries::Kernel
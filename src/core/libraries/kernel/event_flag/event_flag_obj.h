@@ -2,8 +2,10 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 
 #pragma once
-#include <condition_variable>
+#include <atomic>
 #include <mutex>
+#include <string>
+#include <boost/intrusive/list.hpp>
 #include "common/types.h"
 
 namespace Libraries::Kernel {
@@ -21,22 +23,48 @@ public:
     EventFlagInternal(const std::string& name, ThreadMode thread_mode, QueueMode queue_mode,
                       uint64_t bits)
         : m_name(name), m_thread_mode(thread_mode), m_queue_mode(queue_mode), m_bits(bits){};
+    ~EventFlagInternal();
 
     int Wait(u64 bits, WaitMode wait_mode, ClearMode clear_mode, u64* result, u32* ptr_micros);
     int Poll(u64 bits, WaitMode wait_mode, ClearMode clear_mode, u64* result);
     void Set(u64 bits);
     void Clear(u64 bits);
+    void Cancel(u64 set_pattern, int* num_waiters);
 
 private:
-    enum class Status { Set, Canceled, Deleted };
+    enum class Status : u32 { Waiting, Set, Canceled, Deleted };
+
+    using ListBaseHook =
+        boost::intrusive::list_base_hook<boost::intrusive::link_mode<boost::intrusive::normal_link>>;
+
+    struct WaitingThread : public ListBaseHook {
+        std::atomic<u32> status{static_cast<u32>(Status::Waiting)};
+        u64 bits;
+        WaitMode wait_mode;
+        ClearMode clear_mode;
+        u64 result{};
+        u32 priority{};
+
+        bool IsWaiting() const {
+            return static_cast<Status>(status.load(std::memory_order_acquire)) == Status::Waiting;
+        }
+        void Wake(Status new_status);
+    };
+
+    using WaitingThreads =
+        boost::intrusive::list<WaitingThread, boost::intrusive::base_hook<ListBaseHook>,
+                               boost::intrusive::constant_time_size<false>>;
+
+    /// Atomically consumes the pattern if the current bits satisfy the wait condition.
+    bool TryAcquire(u64 bits, WaitMode wait_mode, ClearMode clear_mode, u64* result);
+    void AddWaiter(WaitingThread& waiter);
 
     std::mutex m_mutex;
-    std::condition_variable m_cond_var;
-    Status m_status = Status::Set;
-    int m_waiting_threads = 0;
+    WaitingThreads m_wait_list;
+    std::atomic<u32> m_waiting_threads = 0;
     std::string m_name;
     ThreadMode m_thread_mode = ThreadMode::Single;
     QueueMode m_queue_mode = QueueMode::Fifo;
-    u64 m_bits = 0;
+    std::atomic<u64> m_bits = 0;
 };
 } // namespace Libraries::Kernel
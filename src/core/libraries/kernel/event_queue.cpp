@@ -3,6 +3,7 @@
 
 #include <thread>
 #include "common/assert.h"
+#include "common/logging/log.h"
 #include "core/libraries/kernel/event_queue.h"
 
 namespace Libraries::Kernel {
@@ -14,96 +15,140 @@ bool EqueueInternal::AddEvent(EqueueEvent& event) {
 
     event.time_added = std::chrono::steady_clock::now();
 
-    const auto& it = std::ranges::find(m_events, event);
-    if (it != m_events.cend()) {
-        *it = std::move(event);
+    const EventKey key{event.event.ident, event.event.filter};
+    const auto it = m_events.find(key);
+    if (it != m_events.end()) {
+        UnlinkTriggered(&it->second);
+        it->second = std::move(event);
     } else {
-        m_events.emplace_back(std::move(event));
+        m_events.emplace(key, std::move(event));
     }
 
     return true;
 }
 
-bool EqueueInternal::RemoveEvent(u64 id) {
-    bool has_found = false;
+bool EqueueInternal::RemoveEvent(u64 id, s16 filter) {
     std::scoped_lock lock{m_mutex};
 
-    const auto& it =
-        std::ranges::find_if(m_events, [id](auto& ev) { return ev.event.ident == id; });
-    if (it != m_events.cend()) {
-        m_events.erase(it);
-        has_found = true;
+    const auto it = m_events.find({id, filter});
+    if (it == m_events.end()) {
+        return false;
+    }
+    UnlinkTriggered(&it->second);
+    m_events.erase(it);
+    return true;
+}
+
+void EqueueInternal::UnlinkTriggered(const EqueueEvent* event) {
+    if (event->IsTriggered()) {
+        std::erase(m_triggered, event);
     }
-    return has_found;
 }
 
 int EqueueInternal::WaitForEvents(SceKernelEvent* ev, int num, u32 micros) {
     int count = 0;
+    const auto wait_start = std::chrono::steady_clock::now();
 
-    const auto predicate = [&] {
-        count = GetTriggeredEvents(ev, num);
-        return count > 0;
-    };
+    {
+        const auto predicate = [&] {
+            count = GetTriggeredEventsLocked(ev, num);
+            return count > 0;
+        };
 
-    if (micros == 0) {
-        std::unique_lock lock{m_mutex};
-        m_cond.wait(lock, predicate);
-    } else {
         std::unique_lock lock{m_mutex};
-        m_cond.wait_for(lock, std::chrono::microseconds(micros), predicate);
+        ++m_waiters;
+        if (micros == 0) {
+            m_cond.wait(lock, predicate);
+        } else {
+            m_cond.wait_for(lock, std::chrono::microseconds(micros), predicate);
+        }
+        --m_waiters;
+
+        // Pass the wakeup on if there is still something pending for other waiters.
+        if (!m_triggered.empty() && m_waiters > 0) {
+            m_cond.notify_one();
+        }
     }
 
     if (HasSmallTimer()) {
         if (count > 0) {
             const auto time_waited = std::chrono::duration_cast<std::chrono::microseconds>(
-                                         std::chrono::steady_clock::now() - m_events[0].time_added)
+                                         std::chrono::steady_clock::now() - wait_start)
                                          .count();
             count = WaitForSmallTimer(ev, num, std::max(0l, long(micros - time_waited)));
         }
         small_timer_event.event.data = 0;
     }
 
-    if (ev->flags & SceKernelEvent::Flags::OneShot) {
-        for (auto ev_id = 0u; ev_id < count; ++ev_id) {
-            RemoveEvent(ev->ident);
-        }
-    }
-
     return count;
 }
 
 bool EqueueInternal::TriggerEvent(u64 ident, s16 filter, void* trigger_data) {
-    bool has_found = false;
+    bool should_wake = false;
     {
         std::scoped_lock lock{m_mutex};
 
-        for (auto& event : m_events) {
-            if ((event.event.ident == ident) && (event.event.filter == filter)) {
-                event.Trigger(trigger_data);
-                has_found = true;
+        const auto it = m_events.find({ident, filter});
+        if (it == m_events.end()) {
+            return false;
+        }
+        auto& event = it->second;
+        if (event.Trigger(trigger_data)) {
+            if (m_wake_stats.IsEnabled()) {
+                event.time_triggered = std::chrono::steady_clock::now();
             }
+            m_triggered.push_back(&event);
+            should_wake = m_waiters > 0;
         }
     }
-    m_cond.notify_one();
-    return has_found;
+    // An event that was already pending has woken a waiter, or nobody is waiting for it.
+    if (should_wake) {
+        m_cond.notify_one();
+    }
+    return true;
 }
 
 int EqueueInternal::GetTriggeredEvents(SceKernelEvent* ev, int num) {
+    std::scoped_lock lock{m_mutex};
+    return GetTriggeredEventsLocked(ev, num);
+}
+
+int EqueueInternal::GetTriggeredEventsLocked(SceKernelEvent* ev, int num) {
     int count = 0;
+    size_t num_kept = 0;
+    const bool is_timed = m_wake_stats.IsEnabled();
+    const auto now = is_timed ? std::chrono::steady_clock::now()
+                              : std::chrono::steady_clock::time_point{};
+
+    for (EqueueEvent* event : m_triggered) {
+        if (count == num) {
+            m_triggered[num_kept++] = event;
+            continue;
+        }
 
-    for (auto& event : m_events) {
-        if (event.IsTriggered()) {
-            if (event.event.flags & SceKernelEvent::Flags::Clear) {
-                event.Reset();
-            }
+        if (is_timed) {
+            const u64 latency_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                                       now - event->time_triggered)
+                                       .count();
+            m_wake_stats.Add(WakeCounter::Wakeups);
+            m_wake_stats.Add(WakeCounter::TotalLatencyUs, latency_us);
+            m_wake_stats.Max(WakeCounter::MaxLatencyUs, latency_us);
+        }
+
+        const auto flags = event->event.flags;
+        if (flags & SceKernelEvent::Flags::Clear) {
+            event->Reset();
+        }
 
-            ev[count++] = event.event;
+        ev[count++] = event->event;
 
-            if (count == num) {
-                break;
-            }
+        if (flags & SceKernelEvent::Flags::OneShot) {
+            m_events.erase({event->event.ident, event->event.filter});
+        } else if (event->IsTriggered()) {
+            m_triggered[num_kept++] = event;
         }
     }
+    m_triggered.resize(num_kept);
 
     return count;
 }
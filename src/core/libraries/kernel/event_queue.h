@@ -6,10 +6,13 @@
 #include <condition_variable>
 #include <mutex>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <boost/asio/steady_timer.hpp>
 
+#include "common/perf_stats.h"
 #include "common/types.h"
 
 namespace Libraries::Kernel {
@@ -61,6 +64,7 @@ struct EqueueEvent {
     SceKernelEvent event;
     void* data = nullptr;
     std::chrono::steady_clock::time_point time_added;
+    std::chrono::steady_clock::time_point time_triggered; ///< Only set when perf stats are on.
     std::unique_ptr<boost::asio::steady_timer> timer;
 
     void Reset() {
@@ -69,20 +73,18 @@ struct EqueueEvent {
         event.data = 0;
     }
 
-    void Trigger(void* data) {
-        is_triggered = true;
+    /// Returns true if the event was not already pending delivery.
+    bool Trigger(void* data) {
+        const bool was_triggered = std::exchange(is_triggered, true);
         event.fflags++;
         event.data = reinterpret_cast<uintptr_t>(data);
+        return !was_triggered;
     }
 
     bool IsTriggered() const {
         return is_triggered;
     }
 
-    bool operator==(const EqueueEvent& ev) const {
-        return ev.event.ident == event.ident;
-    }
-
 private:
     bool is_triggered = false;
 };
@@ -98,7 +100,7 @@ public:
         return m_name;
     }
     bool AddEvent(EqueueEvent& event);
-    bool RemoveEvent(u64 id);
+    bool RemoveEvent(u64 id, s16 filter);
     int WaitForEvents(SceKernelEvent* ev, int num, u32 micros);
     bool TriggerEvent(u64 ident, s16 filter, void* trigger_data);
     int GetTriggeredEvents(SceKernelEvent* ev, int num);
@@ -110,11 +112,38 @@ public:
     int WaitForSmallTimer(SceKernelEvent* ev, int num, u32 micros);
 
 private:
+    struct EventKey {
+        u64 ident;
+        s16 filter;
+
+        bool operator==(const EventKey&) const = default;
+    };
+
+    struct EventKeyHash {
+        size_t operator()(const EventKey& key) const noexcept {
+            return std::hash<u64>{}(key.ident ^ (u64(u16(key.filter)) << 48));
+        }
+    };
+
+    int GetTriggeredEventsLocked(SceKernelEvent* ev, int num);
+    void UnlinkTriggered(const EqueueEvent* event);
+
     std::string m_name;
     std::mutex m_mutex;
-    std::vector<EqueueEvent> m_events;
+    std::unordered_map<EventKey, EqueueEvent, EventKeyHash> m_events;
+    std::vector<EqueueEvent*> m_triggered; ///< Events pending delivery, in trigger order.
+    u32 m_waiters{};
     EqueueEvent small_timer_event{};
     std::condition_variable m_cond;
+
+    // Trigger-to-delivery latency of events returned to the guest.
+    enum class WakeCounter : u32 {
+        Wakeups,
+        TotalLatencyUs,
+        MaxLatencyUs,
+    };
+    Common::PerfStats<WakeCounter> m_wake_stats{Common::Log::Class::Kernel_Event,
+                                                "Event queue wakeups"};
 };
 
 } // namespace Libraries::Kernel
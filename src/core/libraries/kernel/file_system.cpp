@@ -9,6 +9,7 @@
 #include "core/libraries/error_codes.h"
 #include "core/libraries/kernel/file_system.h"
 #include "core/libraries/libs.h"
+#include "core/libraries/save_data/save_commit.h"
 #include "libkernel.h"
 
 namespace Libraries::Kernel {
@@ -24,6 +25,52 @@ std::vector<Core::FileSys::DirEntry> GetDirectoryEntries(const std::filesystem::
     return files;
 }
 
+/// Save data writes are committed in the background, so host file access under a save directory
+/// waits for the queued commits touching that path to land first.
+static void WaitSaveCommits(const std::filesystem::path& host_path) {
+    if (!host_path.empty()) {
+        Common::Singleton<Libraries::SaveData::SaveCommitQueue>::Instance()->Wait(host_path);
+    }
+}
+
+static int OpenPackageFile(const Core::FileSys::MntPoints::PackagePath& package_path,
+                           const char* path, int flags) {
+    const auto* node = package_path.node;
+    if ((flags & 0x3) != ORBIS_KERNEL_O_RDONLY || (flags & ORBIS_KERNEL_O_TRUNC) != 0) {
+        return ORBIS_KERNEL_ERROR_EROFS;
+    }
+    if (node == nullptr) {
+        return (flags & ORBIS_KERNEL_O_CREAT) != 0 ? ORBIS_KERNEL_ERROR_EROFS
+                                                     : ORBIS_KERNEL_ERROR_ENOENT;
+    }
+    if ((flags & ORBIS_KERNEL_O_DIRECTORY) != 0 && !node->is_dir) {
+        return ORBIS_KERNEL_ERROR_ENOTDIR;
+    }
+
+    auto* h = Common::Singleton<Core::FileSys::HandleTable>::Instance();
+    const int handle = h->CreateHandle();
+    auto file = h->GetFile(handle);
+    file->m_guest_name = path;
+    file->is_directory = node->is_dir;
+    file->package = package_path.package;
+    file->package_node = node;
+    file->package_pos = 0;
+    for (const u32 child : node->children) {
+        const auto& child_node = file->package->GetNode(child);
+        file->dirents.push_back({child_node.name, !child_node.is_dir});
+    }
+    file->dirents_index = 0;
+    file->is_opened = true;
+    return handle;
+}
+
+static s64 ReadPackageFile(Core::FileSys::File* file, void* buf, size_t nbytes) {
+    const size_t read = file->package->Read(*file->package_node, file->package_pos,
+                                            {static_cast<u8*>(buf), nbytes});
+    file->package_pos += read;
+    return read;
+}
+
 int PS4_SYSV_ABI sceKernelOpen(const char* path, int flags, u16 mode) {
     LOG_INFO(Kernel_Fs, "path = {} flags = {:#x} mode = {}", path, flags, mode);
     auto* h = Common::Singleton<Core::FileSys::HandleTable>::Instance();
@@ -56,12 +103,16 @@ int PS4_SYSV_ABI sceKernelOpen(const char* path, int flags, u16 mode) {
     if (std::string_view{path} == "/dev/urandom") {
         return 2003;
     }
+    if (const auto package_path = mnt->GetPackagePath(path); package_path.package) {
+        return OpenPackageFile(package_path, path, flags);
+    }
     u32 handle = h->CreateHandle();
-    auto* file = h->GetFile(handle);
+    auto file = h->GetFile(handle);
     if (directory) {
         file->is_directory = true;
         file->m_guest_name = path;
         file->m_host_name = mnt->GetHostPath(file->m_guest_name);
+        WaitSaveCommits(file->m_host_name);
         if (!std::filesystem::is_directory(file->m_host_name)) { // directory doesn't exist
             h->DeleteHandle(handle);
             return ORBIS_KERNEL_ERROR_ENOTDIR;
@@ -76,6 +127,7 @@ int PS4_SYSV_ABI sceKernelOpen(const char* path, int flags, u16 mode) {
     } else {
         file->m_guest_name = path;
         file->m_host_name = mnt->GetHostPath(file->m_guest_name);
+        WaitSaveCommits(file->m_host_name);
         int e = 0;
         if (read) {
             e = file->f.Open(file->m_host_name, Common::FS::FileAccessMode::Read);
@@ -96,6 +148,7 @@ int PS4_SYSV_ABI sceKernelOpen(const char* path, int flags, u16 mode) {
             h->DeleteHandle(handle);
             return ErrnoToSceKernelError(e);
         }
+        h->RegisterHostName(handle);
     }
     file->is_opened = true;
     return handle;
@@ -129,7 +182,7 @@ int PS4_SYSV_ABI sceKernelClose(int d) {
         return SCE_OK;
     }
     auto* h = Common::Singleton<Core::FileSys::HandleTable>::Instance();
-    auto* file = h->GetFile(d);
+    auto file = h->GetFile(d);
     if (file == nullptr) {
         return SCE_KERNEL_ERROR_EBADF;
     }
@@ -163,11 +216,15 @@ size_t PS4_SYSV_ABI sceKernelWrite(int d, const void* buf, size_t nbytes) {
         return nbytes;
     }
     auto* h = Common::Singleton<Core::FileSys::HandleTable>::Instance();
-    auto* file = h->GetFile(d);
+    auto file = h->GetFile(d);
     if (file == nullptr) {
         return SCE_KERNEL_ERROR_EBADF;
     }
 
+    if (file->package) {
+        return SCE_KERNEL_ERROR_EBADF;
+    }
+
     std::scoped_lock lk{file->m_mutex};
     return file->f.WriteRaw<u8>(buf, nbytes);
 }
@@ -179,8 +236,12 @@ int PS4_SYSV_ABI sceKernelUnlink(const char* path) {
 
     auto* h = Common::Singleton<Core::FileSys::HandleTable>::Instance();
     auto* mnt = Common::Singleton<Core::FileSys::MntPoints>::Instance();
+    if (mnt->GetPackagePath(path).package) {
+        return ORBIS_KERNEL_ERROR_EROFS;
+    }
 
     const auto host_path = mnt->GetHostPath(path);
+    WaitSaveCommits(host_path);
     if (host_path.empty()) {
         return SCE_KERNEL_ERROR_EACCES;
     }
@@ -189,7 +250,7 @@ int PS4_SYSV_ABI sceKernelUnlink(const char* path) {
         return SCE_KERNEL_ERROR_EPERM;
     }
 
-    auto* file = h->GetFile(host_path);
+    auto file = h->GetFile(host_path);
     if (file != nullptr) {
         file->f.Unlink();
     }
@@ -200,10 +261,14 @@ int PS4_SYSV_ABI sceKernelUnlink(const char* path) {
 
 size_t PS4_SYSV_ABI _readv(int d, const SceKernelIovec* iov, int iovcnt) {
     auto* h = Common::Singleton<Core::FileSys::HandleTable>::Instance();
-    auto* file = h->GetFile(d);
+    auto file = h->GetFile(d);
     size_t total_read = 0;
     std::scoped_lock lk{file->m_mutex};
     for (int i = 0; i < iovcnt; i++) {
+        if (file->package) {
+            total_read += ReadPackageFile(file.get(), iov[i].iov_base, iov[i].iov_len);
+            continue;
+        }
         total_read += file->f.ReadRaw<u8>(iov[i].iov_base, iov[i].iov_len);
     }
     return total_read;
@@ -211,7 +276,7 @@ size_t PS4_SYSV_ABI _readv(int d, const SceKernelIovec* iov, int iovcnt) {
 
 s64 PS4_SYSV_ABI sceKernelLseek(int d, s64 offset, int whence) {
     auto* h = Common::Singleton<Core::FileSys::HandleTable>::Instance();
-    auto* file = h->GetFile(d);
+    auto file = h->GetFile(d);
 
     Common::FS::SeekOrigin origin{};
     if (whence == 0) {
@@ -223,6 +288,19 @@ s64 PS4_SYSV_ABI sceKernelLseek(int d, s64 offset, int whence) {
     }
 
     std::scoped_lock lk{file->m_mutex};
+    if (file->package) {
+        s64 base = 0;
+        if (origin == Common::FS::SeekOrigin::CurrentPosition) {
+            base = file->package_pos;
+        } else if (origin == Common::FS::SeekOrigin::End) {
+            base = file->package_node->size;
+        }
+        if (base + offset < 0) {
+            return ORBIS_KERNEL_ERROR_EINVAL;
+        }
+        file->package_pos = base + offset;
+        return file->package_pos;
+    }
     file->f.Seek(offset, origin);
     return file->f.Tell();
 }
@@ -246,12 +324,15 @@ s64 PS4_SYSV_ABI sceKernelRead(int d, void* buf, size_t nbytes) {
         return nbytes;
     }
     auto* h = Common::Singleton<Core::FileSys::HandleTable>::Instance();
-    auto* file = h->GetFile(d);
+    auto file = h->GetFile(d);
     if (file == nullptr) {
         return SCE_KERNEL_ERROR_EBADF;
     }
 
     std::scoped_lock lk{file->m_mutex};
+    if (file->package) {
+        return ReadPackageFile(file.get(), buf, nbytes);
+    }
     return file->f.ReadRaw<u8>(buf, nbytes);
 }
 
@@ -271,7 +352,11 @@ int PS4_SYSV_ABI sceKernelMkdir(const char* path, u16 mode) {
         return SCE_KERNEL_ERROR_EINVAL;
     }
     auto* mnt = Common::Singleton<Core::FileSys::MntPoints>::Instance();
+    if (const auto package_path = mnt->GetPackagePath(path); package_path.package) {
+        return package_path.node ? SCE_KERNEL_ERROR_EEXIST : ORBIS_KERNEL_ERROR_EROFS;
+    }
     const auto dir_name = mnt->GetHostPath(path);
+    WaitSaveCommits(dir_name);
     if (std::filesystem::exists(dir_name)) {
         return SCE_KERNEL_ERROR_EEXIST;
     }
@@ -300,8 +385,20 @@ int PS4_SYSV_ABI posix_mkdir(const char* path, u16 mode) {
 int PS4_SYSV_ABI sceKernelStat(const char* path, OrbisKernelStat* sb) {
     LOG_INFO(Kernel_Fs, "(PARTIAL) path = {}", path);
     auto* mnt = Common::Singleton<Core::FileSys::MntPoints>::Instance();
-    const auto path_name = mnt->GetHostPath(path);
     std::memset(sb, 0, sizeof(OrbisKernelStat));
+    if (const auto package_path = mnt->GetPackagePath(path); package_path.package) {
+        const auto* node = package_path.node;
+        if (node == nullptr) {
+            return ORBIS_KERNEL_ERROR_ENOENT;
+        }
+        sb->st_mode = 0000555u | (node->is_dir ? 0040000u : 0100000u);
+        sb->st_size = node->is_dir ? 0 : node->size;
+        sb->st_blksize = 512;
+        sb->st_blocks = (sb->st_size + 511) / 512;
+        return ORBIS_OK;
+    }
+    const auto path_name = mnt->GetHostPath(path);
+    WaitSaveCommits(path_name);
     const bool is_dir = std::filesystem::is_directory(path_name);
     const bool is_file = std::filesystem::is_regular_file(path_name);
     if (!is_dir && !is_file) {
@@ -335,7 +432,11 @@ int PS4_SYSV_ABI posix_stat(const char* path, OrbisKernelStat* sb) {
 
 int PS4_SYSV_ABI sceKernelCheckReachability(const char* path) {
     auto* mnt = Common::Singleton<Core::FileSys::MntPoints>::Instance();
+    if (const auto package_path = mnt->GetPackagePath(path); package_path.package) {
+        return package_path.node ? ORBIS_OK : SCE_KERNEL_ERROR_ENOENT;
+    }
     const auto path_name = mnt->GetHostPath(path);
+    WaitSaveCommits(path_name);
     if (!std::filesystem::exists(path_name)) {
         return SCE_KERNEL_ERROR_ENOENT;
     }
@@ -351,12 +452,15 @@ s64 PS4_SYSV_ABI sceKernelPread(int d, void* buf, size_t nbytes, s64 offset) {
     }
 
     auto* h = Common::Singleton<Core::FileSys::HandleTable>::Instance();
-    auto* file = h->GetFile(d);
+    auto file = h->GetFile(d);
     if (file == nullptr) {
         return ORBIS_KERNEL_ERROR_EBADF;
     }
 
     std::scoped_lock lk{file->m_mutex};
+    if (file->package) {
+        return file->package->Read(*file->package_node, offset, {static_cast<u8*>(buf), nbytes});
+    }
     const s64 pos = file->f.Tell();
     SCOPE_EXIT {
         file->f.Seek(pos);
@@ -368,7 +472,7 @@ s64 PS4_SYSV_ABI sceKernelPread(int d, void* buf, size_t nbytes, s64 offset) {
 int PS4_SYSV_ABI sceKernelFStat(int fd, OrbisKernelStat* sb) {
     LOG_INFO(Kernel_Fs, "(PARTIAL) fd = {}", fd);
     auto* h = Common::Singleton<Core::FileSys::HandleTable>::Instance();
-    auto* file = h->GetFile(fd);
+    auto file = h->GetFile(fd);
     std::memset(sb, 0, sizeof(OrbisKernelStat));
 
     if (file->is_directory) {
@@ -379,7 +483,7 @@ int PS4_SYSV_ABI sceKernelFStat(int fd, OrbisKernelStat* sb) {
         // TODO incomplete
     } else {
         sb->st_mode = 0000777u | 0100000u;
-        sb->st_size = file->f.GetSize();
+        sb->st_size = file->package ? file->package_node->size : file->f.GetSize();
         sb->st_blksize = 512;
         sb->st_blocks = (sb->st_size + 511) / 512;
         // TODO incomplete
@@ -399,14 +503,14 @@ int PS4_SYSV_ABI posix_fstat(int fd, OrbisKernelStat* sb) {
 
 s32 PS4_SYSV_ABI sceKernelFsync(int fd) {
     auto* h = Common::Singleton<Core::FileSys::HandleTable>::Instance();
-    auto* file = h->GetFile(fd);
+    auto file = h->GetFile(fd);
     file->f.Flush();
     return ORBIS_OK;
 }
 
 int PS4_SYSV_ABI sceKernelFtruncate(int fd, s64 length) {
     auto* h = Common::Singleton<Core::FileSys::HandleTable>::Instance();
-    auto* file = h->GetFile(fd);
+    auto file = h->GetFile(fd);
 
     if (file == nullptr) {
         return SCE_KERNEL_ERROR_EBADF;
@@ -424,7 +528,7 @@ static int GetDents(int fd, char* buf, int nbytes, s64* basep) {
     // TODO error codes
     ASSERT(buf != nullptr);
     auto* h = Common::Singleton<Core::FileSys::HandleTable>::Instance();
-    auto* file = h->GetFile(fd);
+    auto file = h->GetFile(fd);
 
     if (file->dirents_index == file->dirents.size()) {
         return ORBIS_OK;
@@ -467,11 +571,15 @@ s64 PS4_SYSV_ABI sceKernelPwrite(int d, void* buf, size_t nbytes, s64 offset) {
     }
 
     auto* h = Common::Singleton<Core::FileSys::HandleTable>::Instance();
-    auto* file = h->GetFile(d);
+    auto file = h->GetFile(d);
     if (file == nullptr) {
         return ORBIS_KERNEL_ERROR_EBADF;
     }
 
+    if (file->package) {
+        return ORBIS_KERNEL_ERROR_EBADF;
+    }
+
     std::scoped_lock lk{file->m_mutex};
     const s64 pos = file->f.Tell();
     SCOPE_EXIT {
@@ -483,11 +591,16 @@ s64 PS4_SYSV_ABI sceKernelPwrite(int d, void* buf, size_t nbytes, s64 offset) {
 
 s32 PS4_SYSV_ABI sceKernelRename(const char* from, const char* to) {
     auto* mnt = Common::Singleton<Core::FileSys::MntPoints>::Instance();
+    if (mnt->GetPackagePath(from).package || mnt->GetPackagePath(to).package) {
+        return ORBIS_KERNEL_ERROR_EROFS;
+    }
     const auto src_path = mnt->GetHostPath(from);
+    WaitSaveCommits(src_path);
     if (!std::filesystem::exists(src_path)) {
         return ORBIS_KERNEL_ERROR_ENOENT;
     }
     const auto dst_path = mnt->GetHostPath(to);
+    WaitSaveCommits(dst_path);
     const bool src_is_dir = std::filesystem::is_directory(src_path);
     const bool dst_is_dir = std::filesystem::is_directory(dst_path);
     if (src_is_dir && !dst_is_dir) {
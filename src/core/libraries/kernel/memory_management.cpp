@@ -245,6 +245,10 @@ int PS4_SYSV_ABI sceKernelMunmap(void* addr, size_t len);
 
 s32 PS4_SYSV_ABI sceKernelBatchMap2(OrbisKernelBatchMapEntry* entries, int numEntries,
                                     int* numEntriesOut, int flags) {
+    // Process all entries under a single acquisition of the memory map lock.
+    auto* memory = Core::Memory::Instance();
+    const auto lock = memory->LockExclusive();
+
     int processed = 0;
     int result = 0;
     for (int i = 0; i < numEntries; i++) {
@@ -1,13 +1,17 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <chrono>
 #include <mutex>
 #include <thread>
+#include <utility>
 #include <semaphore.h>
 #include "common/alignment.h"
 #include "common/assert.h"
 #include "common/error.h"
+#include "common/futex.h"
 #include "common/logging/log.h"
+#include "common/perf_stats.h"
 #include "common/singleton.h"
 #include "common/thread.h"
 #include "core/libraries/error_codes.h"
@@ -407,19 +411,181 @@ int PS4_SYSV_ABI scePthreadGetaffinity(ScePthread thread, /*SceKernelCpumask*/ u
     return result;
 }
 
-ScePthreadMutex* createMutex(ScePthreadMutex* addr) {
-    if (addr == nullptr || *addr != nullptr) {
-        return addr;
-    }
+static constexpr u32 MutexUnlocked = 0;
+static constexpr u32 MutexLocked = 1;
+static constexpr u32 MutexContended = 2;
+static constexpr u32 MutexMinSpins = 16;
+static constexpr u32 MutexMaxSpins = 1024;
+
+enum class MutexCounter : u32 {
+    Locks,
+    Contended,
+    WaitNs,
+    MaxWaitNs,
+};
+
+/// Lock statistics of all guest mutexes. Created on first use, after the config is loaded.
+static Common::PerfStats<MutexCounter>& MutexStats() {
+    static Common::PerfStats<MutexCounter> stats{Common::Log::Class::Kernel_Pthread,
+                                                 "Guest mutexes"};
+    return stats;
+}
+
+static inline void CpuRelax() {
+#ifdef _MSC_VER
+    _mm_pause();
+#else
+    __builtin_ia32_pause();
+#endif
+}
+
+/// Unique per-thread tag, also valid for host threads that have no PthreadInternal.
+static const void* MutexOwnerTag() {
+    static thread_local u8 tag;
+    return &tag;
+}
+
+static void createMutex(ScePthreadMutex* addr) {
+    // Statically initialized guest mutexes are null until first use.
     static std::mutex mutex;
     std::scoped_lock lk{mutex};
     if (*addr != nullptr) {
-        return addr;
+        return;
     }
     const VAddr vaddr = reinterpret_cast<VAddr>(addr);
     std::string name = fmt::format("mutex{:#x}", vaddr);
     scePthreadMutexInit(addr, nullptr, name.c_str());
-    return addr;
+}
+
+static inline ScePthreadMutex GetMutex(ScePthreadMutex* addr) {
+    if (addr == nullptr) [[unlikely]] {
+        return nullptr;
+    }
+    if (*addr == nullptr) [[unlikely]] {
+        createMutex(addr);
+    }
+    return *addr;
+}
+
+static inline void MutexAcquired(ScePthreadMutex mutex, const void* self) {
+    mutex->owner.store(self, std::memory_order_relaxed);
+    MutexStats().Add(MutexCounter::Locks);
+}
+
+/// Handles locking a mutex the calling thread already owns. Returns true if handled.
+static inline bool MutexRelock(ScePthreadMutex mutex, const void* self, int* result) {
+    if (mutex->owner.load(std::memory_order_relaxed) != self) {
+        return false;
+    }
+    switch (mutex->type) {
+    case PthreadMutexType::Recursive:
+        ++mutex->recursion_count;
+        *result = SCE_OK;
+        return true;
+    case PthreadMutexType::ErrorCheck:
+        *result = SCE_KERNEL_ERROR_EDEADLK;
+        return true;
+    default:
+        // Normal mutexes deadlock like they would on hardware.
+        return false;
+    }
+}
+
+static int MutexLockSlow(ScePthreadMutex mutex, const void* self,
+                         const std::chrono::nanoseconds* timeout) {
+    auto& stats = MutexStats();
+    const auto start = timeout || stats.IsEnabled() ? std::chrono::steady_clock::now()
+                                                    : std::chrono::steady_clock::time_point{};
+
+    // Spin for a while first, the owner is likely to release it soon. The budget adapts to how
+    // often spinning has paid off for this mutex.
+    const u32 spins = mutex->spin_count.load(std::memory_order_relaxed);
+    for (u32 i = 0; i < spins; ++i) {
+        u32 expected = MutexUnlocked;
+        if (mutex->state.load(std::memory_order_relaxed) == MutexUnlocked &&
+            mutex->state.compare_exchange_weak(expected, MutexLocked,
+                                               std::memory_order_acquire)) {
+            mutex->spin_count.store(std::min(spins * 2, MutexMaxSpins),
+                                    std::memory_order_relaxed);
+            MutexAcquired(mutex, self);
+            stats.Add(MutexCounter::Contended);
+            return SCE_OK;
+        }
+        CpuRelax();
+    }
+    mutex->spin_count.store(std::max(spins / 2, MutexMinSpins), std::memory_order_relaxed);
+
+    // Park until the owner hands the mutex back. Taking it in the contended state makes sure
+    // our own unlock wakes whoever else is parked.
+    const auto deadline = timeout ? start + *timeout : std::chrono::steady_clock::time_point{};
+    while (mutex->state.exchange(MutexContended, std::memory_order_acquire) != MutexUnlocked) {
+        if (!timeout) {
+            Common::FutexWait(mutex->state, MutexContended);
+            continue;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            return SCE_KERNEL_ERROR_ETIMEDOUT;
+        }
+        const std::chrono::nanoseconds remaining = deadline - now;
+        Common::FutexWait(mutex->state, MutexContended, &remaining);
+    }
+
+    MutexAcquired(mutex, self);
+    stats.Add(MutexCounter::Contended);
+    if (stats.IsEnabled()) {
+        const u64 waited_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  std::chrono::steady_clock::now() - start)
+                                  .count();
+        stats.Add(MutexCounter::WaitNs, waited_ns);
+        stats.Max(MutexCounter::MaxWaitNs, waited_ns);
+    }
+    return SCE_OK;
+}
+
+static inline int MutexLock(ScePthreadMutex mutex, const std::chrono::nanoseconds* timeout) {
+    const void* self = MutexOwnerTag();
+    u32 expected = MutexUnlocked;
+    if (mutex->state.compare_exchange_strong(expected, MutexLocked, std::memory_order_acquire))
+        [[likely]] {
+        MutexAcquired(mutex, self);
+        return SCE_OK;
+    }
+    int result;
+    if (MutexRelock(mutex, self, &result)) {
+        return result;
+    }
+    return MutexLockSlow(mutex, self, timeout);
+}
+
+static inline int MutexTrylock(ScePthreadMutex mutex) {
+    const void* self = MutexOwnerTag();
+    u32 expected = MutexUnlocked;
+    if (mutex->state.compare_exchange_strong(expected, MutexLocked, std::memory_order_acquire)) {
+        MutexAcquired(mutex, self);
+        return SCE_OK;
+    }
+    if (mutex->type == PthreadMutexType::Recursive &&
+        mutex->owner.load(std::memory_order_relaxed) == self) {
+        ++mutex->recursion_count;
+        return SCE_OK;
+    }
+    return SCE_KERNEL_ERROR_EBUSY;
+}
+
+static inline int MutexUnlock(ScePthreadMutex mutex) {
+    if (mutex->owner.load(std::memory_order_relaxed) != MutexOwnerTag()) [[unlikely]] {
+        return SCE_KERNEL_ERROR_EPERM;
+    }
+    if (mutex->recursion_count != 0) {
+        --mutex->recursion_count;
+        return SCE_OK;
+    }
+    mutex->owner.store(nullptr, std::memory_order_relaxed);
+    if (mutex->state.exchange(MutexUnlocked, std::memory_order_release) == MutexContended) {
+        Common::FutexWake(&mutex->state, 1);
+    }
+    return SCE_OK;
 }
 
 int PS4_SYSV_ABI scePthreadMutexInit(ScePthreadMutex* mutex, const ScePthreadMutexattr* mutex_attr,
@@ -445,25 +611,15 @@ int PS4_SYSV_ABI scePthreadMutexInit(ScePthreadMutex* mutex, const ScePthreadMut
     } else {
         (*mutex)->name = "nonameMutex";
     }
-
-    int result = pthread_mutex_init(&(*mutex)->pth_mutex, &(*attr)->pth_mutex_attr);
+    (*mutex)->type = (*attr)->type;
+    (*mutex)->protocol = (*attr)->pprotocol;
+    (*mutex)->spin_count = MutexMinSpins;
 
     if (name != nullptr) {
-        LOG_INFO(Kernel_Pthread, "name={}, result={}", name, result);
+        LOG_INFO(Kernel_Pthread, "name={}", name);
     }
 
-    switch (result) {
-    case 0:
-        return SCE_OK;
-    case EAGAIN:
-        return SCE_KERNEL_ERROR_EAGAIN;
-    case EINVAL:
-        return SCE_KERNEL_ERROR_EINVAL;
-    case ENOMEM:
-        return SCE_KERNEL_ERROR_ENOMEM;
-    default:
-        return SCE_KERNEL_ERROR_EINVAL;
-    }
+    return SCE_OK;
 }
 
 int PS4_SYSV_ABI scePthreadMutexDestroy(ScePthreadMutex* mutex) {
@@ -471,62 +627,39 @@ int PS4_SYSV_ABI scePthreadMutexDestroy(ScePthreadMutex* mutex) {
     if (mutex == nullptr || *mutex == nullptr) {
         return SCE_KERNEL_ERROR_EINVAL;
     }
+    if ((*mutex)->state.load(std::memory_order_relaxed) != MutexUnlocked) {
+        return SCE_KERNEL_ERROR_EBUSY;
+    }
 
-    int result = pthread_mutex_destroy(&(*mutex)->pth_mutex);
-
-    LOG_DEBUG(Kernel_Pthread, "name={}, result={}", (*mutex)->name, result);
+    LOG_DEBUG(Kernel_Pthread, "name={}", (*mutex)->name);
 
     delete *mutex;
     *mutex = nullptr;
 
-    switch (result) {
-    case 0:
-        return SCE_OK;
-    case EBUSY:
-        return SCE_KERNEL_ERROR_EBUSY;
-    case EINVAL:
-    default:
-        return SCE_KERNEL_ERROR_EINVAL;
-    }
+    return SCE_OK;
 }
 int PS4_SYSV_ABI scePthreadMutexattrInit(ScePthreadMutexattr* attr) {
     *attr = new PthreadMutexattrInternal{};
 
-    int result = pthread_mutexattr_init(&(*attr)->pth_mutex_attr);
-
-    result = (result == 0 ? scePthreadMutexattrSettype(attr, 1) : result);
+    int result = scePthreadMutexattrSettype(attr, 1);
     result = (result == 0 ? scePthreadMutexattrSetprotocol(attr, 0) : result);
 
-    switch (result) {
-    case 0:
-        return SCE_OK;
-    case ENOMEM:
-        return SCE_KERNEL_ERROR_ENOMEM;
-    default:
-        return SCE_KERNEL_ERROR_EINVAL;
-    }
+    return result;
 }
 
 int PS4_SYSV_ABI scePthreadMutexattrSettype(ScePthreadMutexattr* attr, int type) {
-    int ptype = PTHREAD_MUTEX_DEFAULT;
     switch (type) {
     case 1:
-        ptype = PTHREAD_MUTEX_ERRORCHECK;
-        break;
     case 2:
-        ptype = PTHREAD_MUTEX_RECURSIVE;
-        break;
     case 3:
     case 4:
-        ptype = PTHREAD_MUTEX_NORMAL;
         break;
     default:
         UNREACHABLE_MSG("Invalid type: {}", type);
     }
 
-    int result = pthread_mutexattr_settype(&(*attr)->pth_mutex_attr, ptype);
-
-    return result == 0 ? SCE_OK : SCE_KERNEL_ERROR_EINVAL;
+    (*attr)->type = static_cast<PthreadMutexType>(type);
+    return SCE_OK;
 }
 
 int PS4_SYSV_ABI scePthreadMutexattrSetprotocol(ScePthreadMutexattr* attr, int protocol) {
@@ -545,77 +678,41 @@ int PS4_SYSV_ABI scePthreadMutexattrSetprotocol(ScePthreadMutexattr* attr, int p
         UNREACHABLE_MSG("Invalid protocol: {}", protocol);
     }
 
-#if _WIN64
-    int result = 0;
-#else
-    int result = pthread_mutexattr_setprotocol(&(*attr)->pth_mutex_attr, pprotocol);
-#endif
     (*attr)->pprotocol = pprotocol;
-    return result == 0 ? SCE_OK : SCE_KERNEL_ERROR_EINVAL;
+    return SCE_OK;
 }
 
 int PS4_SYSV_ABI scePthreadMutexLock(ScePthreadMutex* mutex) {
-    mutex = createMutex(mutex);
-    if (mutex == nullptr) {
+    const auto m = GetMutex(mutex);
+    if (m == nullptr) {
         return SCE_KERNEL_ERROR_EINVAL;
     }
 
-    int result = pthread_mutex_lock(&(*mutex)->pth_mutex);
-    if (result != 0) {
-        LOG_TRACE(Kernel_Pthread, "Locked name={}, result={}", (*mutex)->name, result);
-    }
-
-    switch (result) {
-    case 0:
-        return SCE_OK;
-    case EAGAIN:
-        return SCE_KERNEL_ERROR_EAGAIN;
-    case EINVAL:
-        return SCE_KERNEL_ERROR_EINVAL;
-    case EDEADLK:
-        return SCE_KERNEL_ERROR_EDEADLK;
-    default:
-        return SCE_KERNEL_ERROR_EINVAL;
+    const int result = MutexLock(m, nullptr);
+    if (result != SCE_OK) {
+        LOG_TRACE(Kernel_Pthread, "Locked name={}, result={}", m->name, result);
     }
+    return result;
 }
 
 int PS4_SYSV_ABI scePthreadMutexUnlock(ScePthreadMutex* mutex) {
-    mutex = createMutex(mutex);
-    if (mutex == nullptr) {
+    const auto m = GetMutex(mutex);
+    if (m == nullptr) {
         return SCE_KERNEL_ERROR_EINVAL;
     }
 
-    int result = pthread_mutex_unlock(&(*mutex)->pth_mutex);
-    if (result != 0) {
-        LOG_TRACE(Kernel_Pthread, "Unlocking name={}, result={}", (*mutex)->name, result);
-    }
-
-    switch (result) {
-    case 0:
-        return SCE_OK;
-    case EINVAL:
-        return SCE_KERNEL_ERROR_EINVAL;
-    case EPERM:
-        return SCE_KERNEL_ERROR_EPERM;
-    default:
-        return SCE_KERNEL_ERROR_EINVAL;
+    const int result = MutexUnlock(m);
+    if (result != SCE_OK) {
+        LOG_TRACE(Kernel_Pthread, "Unlocking name={}, result={}", m->name, result);
     }
+    return result;
 }
 
 int PS4_SYSV_ABI scePthreadMutexattrDestroy(ScePthreadMutexattr* attr) {
-    int result = pthread_mutexattr_destroy(&(*attr)->pth_mutex_attr);
-
     delete *attr;
     *attr = nullptr;
 
-    switch (result) {
-    case 0:
-        return SCE_OK;
-    case ENOMEM:
-        return SCE_KERNEL_ERROR_ENOMEM;
-    default:
-        return SCE_KERNEL_ERROR_EINVAL;
-    }
+    return SCE_OK;
 }
 
 ScePthreadCond* createCond(ScePthreadCond* addr) {
@@ -651,24 +748,11 @@ int PS4_SYSV_ABI scePthreadCondInit(ScePthreadCond* cond, const ScePthreadCondat
         (*cond)->name = "nonameCond";
     }
 
-    int result = pthread_cond_init(&(*cond)->cond, &(*attr)->cond_attr);
-
     if (name != nullptr) {
-        LOG_INFO(Kernel_Pthread, "name={}, result={}", (*cond)->name, result);
+        LOG_INFO(Kernel_Pthread, "name={}", (*cond)->name);
     }
 
-    switch (result) {
-    case 0:
-        return SCE_OK;
-    case EAGAIN:
-        return SCE_KERNEL_ERROR_EAGAIN;
-    case EINVAL:
-        return SCE_KERNEL_ERROR_EINVAL;
-    case ENOMEM:
-        return SCE_KERNEL_ERROR_ENOMEM;
-    default:
-        return SCE_KERNEL_ERROR_EINVAL;
-    }
+    return SCE_OK;
 }
 
 int PS4_SYSV_ABI scePthreadCondattrInit(ScePthreadCondattr* attr) {
@@ -692,11 +776,29 @@ int PS4_SYSV_ABI scePthreadCondBroadcast(ScePthreadCond* cond) {
         return SCE_KERNEL_ERROR_EINVAL;
     }
 
-    int result = pthread_cond_broadcast(&(*cond)->cond);
+    (*cond)->seq.fetch_add(1, std::memory_order_release);
+    Common::FutexWakeAll(&(*cond)->seq);
 
-    LOG_TRACE(Kernel_Pthread, "called name={}, result={}", (*cond)->name, result);
+    LOG_TRACE(Kernel_Pthread, "called name={}", (*cond)->name);
 
-    return (result == 0 ? SCE_OK : SCE_KERNEL_ERROR_EINVAL);
+    return SCE_OK;
+}
+
+static int CondWait(ScePthreadCond cond, ScePthreadMutex mutex,
+                    const std::chrono::nanoseconds* timeout) {
+    // Sample the sequence before dropping the mutex, a signal sent after that point changes it
+    // and the futex wait returns immediately.
+    const u32 seq = cond->seq.load(std::memory_order_acquire);
+    const u32 recursion_count = std::exchange(mutex->recursion_count, 0);
+    int result = MutexUnlock(mutex);
+    if (result != SCE_OK) {
+        mutex->recursion_count = recursion_count;
+        return result;
+    }
+    const bool signaled = Common::FutexWait(cond->seq, seq, timeout);
+    MutexLock(mutex, nullptr);
+    mutex->recursion_count = recursion_count;
+    return signaled ? SCE_OK : SCE_KERNEL_ERROR_ETIMEDOUT;
 }
 
 int PS4_SYSV_ABI scePthreadCondTimedwait(ScePthreadCond* cond, ScePthreadMutex* mutex, u64 usec) {
@@ -707,46 +809,21 @@ int PS4_SYSV_ABI scePthreadCondTimedwait(ScePthreadCond* cond, ScePthreadMutex*
     if (mutex == nullptr || *mutex == nullptr) {
         return SCE_KERNEL_ERROR_EINVAL;
     }
-    timespec time{};
-    time.tv_sec = usec / 1000000;
-    time.tv_nsec = ((usec % 1000000) * 1000);
-    int result = pthread_cond_timedwait(&(*cond)->cond, &(*mutex)->pth_mutex, &time);
-
-    // LOG_INFO(Kernel_Pthread, "scePthreadCondTimedwait, result={}", result);
-
-    switch (result) {
-    case 0:
-        return SCE_OK;
-    case ETIMEDOUT:
-        return SCE_KERNEL_ERROR_ETIMEDOUT;
-    case EINTR:
-        return SCE_KERNEL_ERROR_EINTR;
-    case EAGAIN:
-        return SCE_KERNEL_ERROR_EAGAIN;
-    default:
-        return SCE_KERNEL_ERROR_EINVAL;
-    }
+    const std::chrono::nanoseconds timeout = std::chrono::microseconds(usec);
+    return CondWait(*cond, *mutex, &timeout);
 }
 
 int PS4_SYSV_ABI scePthreadCondDestroy(ScePthreadCond* cond) {
     if (cond == nullptr) {
         return SCE_KERNEL_ERROR_EINVAL;
     }
-    int result = pthread_cond_destroy(&(*cond)->cond);
 
-    LOG_DEBUG(Kernel_Pthread, "scePthreadCondDestroy, result={}", result);
+    LOG_DEBUG(Kernel_Pthread, "scePthreadCondDestroy");
 
     delete *cond;
     *cond = nullptr;
 
-    switch (result) {
-    case 0:
-        return SCE_OK;
-    case EBUSY:
-        return SCE_KERNEL_ERROR_EBUSY;
-    default:
-        return SCE_KERNEL_ERROR_EINVAL;
-    }
+    return SCE_OK;
 }
 
 int PS4_SYSV_ABI posix_pthread_mutex_init(ScePthreadMutex* mutex, const ScePthreadMutexattr* attr) {
@@ -762,9 +839,12 @@ int PS4_SYSV_ABI posix_pthread_mutex_init(ScePthreadMutex* mutex, const ScePthre
 }
 
 int PS4_SYSV_ABI posix_pthread_mutex_lock(ScePthreadMutex* mutex) {
-    // LOG_INFO(Kernel_Pthread, "posix pthread_mutex_lock redirect to scePthreadMutexLock");
-    int result = scePthreadMutexLock(mutex);
-    if (result < 0) {
+    const auto m = GetMutex(mutex);
+    if (m == nullptr) {
+        return POSIX_EINVAL;
+    }
+    const int result = MutexLock(m, nullptr);
+    if (result < 0) [[unlikely]] {
         int rt = result > SCE_KERNEL_ERROR_UNKNOWN && result <= SCE_KERNEL_ERROR_ESTOP
                      ? result + -SCE_KERNEL_ERROR_UNKNOWN
                      : POSIX_EOTHER;
@@ -774,9 +854,12 @@ int PS4_SYSV_ABI posix_pthread_mutex_lock(ScePthreadMutex* mutex) {
 }
 
 int PS4_SYSV_ABI posix_pthread_mutex_unlock(ScePthreadMutex* mutex) {
-    // LOG_INFO(Kernel_Pthread, "posix pthread_mutex_unlock redirect to scePthreadMutexUnlock");
-    int result = scePthreadMutexUnlock(mutex);
-    if (result < 0) {
+    const auto m = GetMutex(mutex);
+    if (m == nullptr) {
+        return POSIX_EINVAL;
+    }
+    const int result = MutexUnlock(m);
+    if (result < 0) [[unlikely]] {
         int rt = result > SCE_KERNEL_ERROR_UNKNOWN && result <= SCE_KERNEL_ERROR_ESTOP
                      ? result + -SCE_KERNEL_ERROR_UNKNOWN
                      : POSIX_EOTHER;
@@ -872,60 +955,14 @@ int PS4_SYSV_ABI posix_pthread_mutexattr_setprotocol(ScePthreadMutexattr* attr,
     return result;
 }
 
-#ifndef HAVE_PTHREAD_MUTEX_TIMEDLOCK
-static int pthread_mutex_timedlock(pthread_mutex_t* mutex, const struct timespec* abstime) {
-    int rc;
-    while ((rc = pthread_mutex_trylock(mutex)) == EBUSY) {
-        struct timespec curr_time;
-        clock_gettime(CLOCK_REALTIME, &curr_time);
-
-        s64 remaining_ns = 0;
-        remaining_ns +=
-            (static_cast<s64>(abstime->tv_sec) - static_cast<s64>(curr_time.tv_sec)) * 1000000000L;
-        remaining_ns += static_cast<s64>(abstime->tv_nsec) - static_cast<s64>(curr_time.tv_nsec);
-
-        if (remaining_ns <= 0) {
-            return ETIMEDOUT;
-        }
-
-        struct timespec sleep_time;
-        sleep_time.tv_sec = 0;
-        if (remaining_ns < 5000000L) {
-            sleep_time.tv_nsec = remaining_ns;
-        } else {
-            sleep_time.tv_nsec = 5000000;
-        }
-
-        nanosleep(&sleep_time, nullptr);
-    }
-
-    return rc;
-}
-#endif
-
 int PS4_SYSV_ABI scePthreadMutexTimedlock(ScePthreadMutex* mutex, u64 usec) {
-    mutex = createMutex(mutex);
-    if (mutex == nullptr) {
+    const auto m = GetMutex(mutex);
+    if (m == nullptr) {
         return SCE_KERNEL_ERROR_EINVAL;
     }
 
-    timespec time{};
-    time.tv_sec = usec / 1000000;
-    time.tv_nsec = ((usec % 1000000) * 1000);
-    int result = pthread_mutex_timedlock(&(*mutex)->pth_mutex, &time);
-
-    switch (result) {
-    case 0:
-        return SCE_OK;
-    case ETIMEDOUT:
-        return SCE_KERNEL_ERROR_ETIMEDOUT;
-    case EINTR:
-        return SCE_KERNEL_ERROR_EINTR;
-    case EAGAIN:
-        return SCE_KERNEL_ERROR_EAGAIN;
-    default:
-        return SCE_KERNEL_ERROR_EINVAL;
-    }
+    const std::chrono::nanoseconds timeout = std::chrono::microseconds(usec);
+    return MutexLock(m, &timeout);
 }
 
 static int pthread_copy_attributes(ScePthreadAttr* dst, const ScePthreadAttr* src) {
@@ -1138,18 +1175,10 @@ int PS4_SYSV_ABI scePthreadCondSignal(ScePthreadCond* cond) {
         return SCE_KERNEL_ERROR_EINVAL;
     }
 
-    int result = pthread_cond_signal(&(*cond)->cond);
+    (*cond)->seq.fetch_add(1, std::memory_order_release);
+    Common::FutexWake(&(*cond)->seq, 1);
 
-    // LOG_INFO(Kernel_Pthread, "scePthreadCondSignal, result={}", result);
-
-    switch (result) {
-    case 0:
-        return SCE_OK;
-    case EBUSY:
-        return SCE_KERNEL_ERROR_EBUSY;
-    default:
-        return SCE_KERNEL_ERROR_EINVAL;
-    }
+    return SCE_OK;
 }
 
 int PS4_SYSV_ABI scePthreadCondWait(ScePthreadCond* cond, ScePthreadMutex* mutex) {
@@ -1160,20 +1189,7 @@ int PS4_SYSV_ABI scePthreadCondWait(ScePthreadCond* cond, ScePthreadMutex* mutex
     if (mutex == nullptr || *mutex == nullptr) {
         return SCE_KERNEL_ERROR_EINVAL;
     }
-    int result = pthread_cond_wait(&(*cond)->cond, &(*mutex)->pth_mutex);
-
-    LOG_DEBUG(Kernel_Pthread, "scePthreadCondWait, result={}", result);
-
-    switch (result) {
-    case 0:
-        return SCE_OK;
-    case EINTR:
-        return SCE_KERNEL_ERROR_EINTR;
-    case EAGAIN:
-        return SCE_KERNEL_ERROR_EAGAIN;
-    default:
-        return SCE_KERNEL_ERROR_EINVAL;
-    }
+    return CondWait(*cond, *mutex, nullptr);
 }
 
 int PS4_SYSV_ABI scePthreadCondattrDestroy(ScePthreadCondattr* attr) {
@@ -1195,27 +1211,16 @@ int PS4_SYSV_ABI scePthreadCondattrDestroy(ScePthreadCondattr* attr) {
 }
 
 int PS4_SYSV_ABI scePthreadMutexTrylock(ScePthreadMutex* mutex) {
-    mutex = createMutex(mutex);
-    if (mutex == nullptr) {
+    const auto m = GetMutex(mutex);
+    if (m == nullptr) {
         return ORBIS_KERNEL_ERROR_EINVAL;
     }
 
-    int result = pthread_mutex_trylock(&(*mutex)->pth_mutex);
-    if (result != 0) {
-        LOG_TRACE(Kernel_Pthread, "name={}, result={}", (*mutex)->name, result);
-    }
-
-    switch (result) {
-    case 0:
-        return ORBIS_OK;
-    case EAGAIN:
-        return ORBIS_KERNEL_ERROR_EAGAIN;
-    case EBUSY:
-        return ORBIS_KERNEL_ERROR_EBUSY;
-    case EINVAL:
-    default:
-        return ORBIS_KERNEL_ERROR_EINVAL;
+    const int result = MutexTrylock(m);
+    if (result != ORBIS_OK) {
+        LOG_TRACE(Kernel_Pthread, "name={}, result={}", m->name, result);
     }
+    return result;
 }
 
 int PS4_SYSV_ABI scePthreadEqual(ScePthread thread1, ScePthread thread2) {
@@ -69,22 +69,34 @@ struct PthreadAttrInternal {
     pthread_attr_t pth_attr;
 };
 
+enum class PthreadMutexType : int {
+    ErrorCheck = 1,
+    Recursive = 2,
+    Normal = 3,
+    AdaptiveNp = 4,
+};
+
 struct PthreadMutexInternal {
     u8 reserved[256];
     std::string name;
-    pthread_mutex_t pth_mutex;
+    std::atomic<u32> state; ///< 0 = unlocked, 1 = locked, 2 = locked with sleeping waiters
+    std::atomic<const void*> owner;
+    u32 recursion_count;
+    PthreadMutexType type;
+    int protocol;
+    std::atomic<u32> spin_count; ///< Adaptive spin budget before parking
 };
 
 struct PthreadMutexattrInternal {
     u8 reserved[64];
-    pthread_mutexattr_t pth_mutex_attr;
+    PthreadMutexType type;
     int pprotocol;
 };
 
 struct PthreadCondInternal {
     u8 reserved[256];
     std::string name;
-    pthread_cond_t cond;
+    std::atomic<u32> seq; ///< Bumped on every signal, waiters park on it
 };
 
 struct PthreadCondAttrInternal {
@@ -1,12 +1,13 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
-#include <condition_variable>
+#include <atomic>
 #include <mutex>
 #include <utility>
 #include <boost/intrusive/list.hpp>
 #include <pthread.h>
 #include "common/assert.h"
+#include "common/futex.h"
 #include "common/logging/log.h"
 #include "core/libraries/error_codes.h"
 #include "core/libraries/libs.h"
@@ -19,39 +20,89 @@ using ListBaseHook =
 class Semaphore {
 public:
     Semaphore(s32 init_count, s32 max_count, std::string_view name, bool is_fifo)
-        : name{name}, token_count{init_count}, max_count{max_count}, init_count{init_count},
-          is_fifo{is_fifo} {}
+        : name{name}, state{MakeState(init_count, 0)}, max_count{max_count},
+          init_count{init_count}, is_fifo{is_fifo} {}
     ~Semaphore() {
         ASSERT(wait_list.empty());
     }
 
     int Wait(bool can_block, s32 need_count, u32* timeout) {
-        std::unique_lock lk{mutex};
-        if (token_count >= need_count) {
-            token_count -= need_count;
-            return ORBIS_OK;
+        // Fast path, tokens are taken without touching the waiter list. Like the kernel, a
+        // request that can be satisfied right away is granted even if larger requests are
+        // queued, otherwise it could wait forever for a signal that never comes.
+        u64 cur = state.load(std::memory_order_relaxed);
+        while (TokenCount(cur) >= need_count) {
+            if (state.compare_exchange_weak(cur, cur - need_count, std::memory_order_acquire,
+                                            std::memory_order_relaxed)) {
+                return ORBIS_OK;
+            }
         }
         if (!can_block) {
             return ORBIS_KERNEL_ERROR_EBUSY;
         }
 
+        std::unique_lock lk{mutex};
+
+        // Register as a waiter, unless tokens became available in the meantime. Doing both
+        // in one atomic step means a concurrent fast path Signal can not slip in between.
+        cur = state.load(std::memory_order_relaxed);
+        while (true) {
+            const bool can_take = TokenCount(cur) >= need_count;
+            const u64 desired = can_take ? cur - need_count : cur + WaiterOne;
+            if (state.compare_exchange_weak(cur, desired, std::memory_order_acquire,
+                                            std::memory_order_relaxed)) {
+                if (can_take) {
+                    return ORBIS_OK;
+                }
+                break;
+            }
+        }
+
         // Create waiting thread object and add it into the list of waiters.
         WaitingThread waiter{need_count, is_fifo};
         AddWaiter(waiter);
+        lk.unlock();
 
         // Perform the wait.
-        return waiter.Wait(lk, timeout);
+        if (waiter.Wait(timeout)) {
+            return waiter.GetResult();
+        }
+
+        // Timed out, but a signal may have granted us the tokens before we got the lock back.
+        lk.lock();
+        if (waiter.IsWaiting()) {
+            wait_list.erase(wait_list.iterator_to(waiter));
+            state.fetch_sub(WaiterOne, std::memory_order_relaxed);
+            return SCE_KERNEL_ERROR_ETIMEDOUT;
+        }
+        return waiter.GetResult();
     }
 
     bool Signal(s32 signal_count) {
-        std::scoped_lock lk{mutex};
-        if (token_count + signal_count > max_count) {
-            return false;
+        // Uncontended fast path, nobody to wake so only the token count changes.
+        u64 cur = state.load(std::memory_order_relaxed);
+        while (NumWaiters(cur) == 0) {
+            if (TokenCount(cur) + signal_count > max_count) {
+                return false;
+            }
+            if (state.compare_exchange_weak(cur, cur + signal_count, std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+                return true;
+            }
         }
-        token_count += signal_count;
 
-        // Wake up threads in order of priority.
-        for (auto it = wait_list.begin(); it != wait_list.end();) {
+        std::scoped_lock lk{mutex};
+        cur = state.load(std::memory_order_relaxed);
+        do {
+            if (TokenCount(cur) + signal_count > max_count) {
+                return false;
+            }
+        } while (!state.compare_exchange_weak(cur, cur + signal_count, std::memory_order_release,
+                                              std::memory_order_relaxed));
+
+        // Wake up exactly the threads that can be satisfied, in order of priority.
+        s32 token_count = TokenCount(cur) + signal_count;
+        for (auto it = wait_list.begin(); it != wait_list.end() && token_count > 0;) {
             auto& waiter = *it;
             if (waiter.need_count > token_count) {
                 it++;
@@ -59,7 +110,8 @@ public:
             }
             it = wait_list.erase(it);
             token_count -= waiter.need_count;
-            waiter.cv.notify_one();
+            state.fetch_sub(WaiterOne + waiter.need_count, std::memory_order_relaxed);
+            waiter.Wake(WaitStatus::Granted);
         }
 
         return true;
@@ -68,24 +120,29 @@ public:
     int Cancel(s32 set_count, s32* num_waiters) {
         std::scoped_lock lk{mutex};
         if (num_waiters) {
-            *num_waiters = wait_list.size();
+            *num_waiters = NumWaiters(state.load(std::memory_order_relaxed));
         }
-        for (auto& waiter : wait_list) {
-            waiter.was_cancled = true;
-            waiter.cv.notify_one();
+        while (!wait_list.empty()) {
+            auto& waiter = wait_list.front();
+            wait_list.pop_front();
+            waiter.Wake(WaitStatus::Canceled);
         }
-        wait_list.clear();
-        token_count = set_count < 0 ? init_count : set_count;
+        state.store(MakeState(set_count < 0 ? init_count : set_count, 0),
+                    std::memory_order_release);
         return ORBIS_OK;
     }
 
 public:
+    enum class WaitStatus : u32 {
+        Waiting,
+        Granted,
+        Canceled,
+    };
+
     struct WaitingThread : public ListBaseHook {
-        std::condition_variable cv;
+        std::atomic<u32> status{static_cast<u32>(WaitStatus::Waiting)};
         u32 priority;
         s32 need_count;
-        bool was_deleted{};
-        bool was_cancled{};
 
         explicit WaitingThread(s32 need_count, bool is_fifo) : need_count{need_count} {
             if (is_fifo) {
@@ -98,37 +155,55 @@ public:
             priority = param.sched_priority;
         }
 
-        int GetResult(bool timed_out) {
-            if (timed_out) {
-                return SCE_KERNEL_ERROR_ETIMEDOUT;
-            }
-            if (was_deleted) {
-                return SCE_KERNEL_ERROR_EACCES;
-            }
-            if (was_cancled) {
+        bool IsWaiting() const {
+            return static_cast<WaitStatus>(status.load(std::memory_order_acquire)) ==
+                   WaitStatus::Waiting;
+        }
+
+        int GetResult() const {
+            switch (static_cast<WaitStatus>(status.load(std::memory_order_acquire))) {
+            case WaitStatus::Canceled:
                 return SCE_KERNEL_ERROR_ECANCELED;
+            default:
+                return SCE_OK;
             }
-            return SCE_OK;
         }
 
-        int Wait(std::unique_lock<std::mutex>& lk, u32* timeout) {
+        /// Must be called with the semaphore lock held. The waiter may return and go out of
+        /// scope as soon as the status is stored, so only its address is used for the wake.
+        void Wake(WaitStatus new_status) {
+            const auto* word = &status;
+            status.store(static_cast<u32>(new_status), std::memory_order_release);
+            Common::FutexWake(word, 1);
+        }
+
+        /// Parks until woken, returns false if the timeout ran out first.
+        bool Wait(u32* timeout) {
+            constexpr u32 Waiting = static_cast<u32>(WaitStatus::Waiting);
             if (!timeout) {
                 // Wait indefinitely until we are woken up.
-                cv.wait(lk);
-                return GetResult(false);
+                while (status.load(std::memory_order_acquire) == Waiting) {
+                    Common::FutexWait(status, Waiting);
+                }
+                return true;
             }
             // Wait until timeout runs out, recording how much remaining time there was.
-            const auto start = std::chrono::high_resolution_clock::now();
-            const auto status = cv.wait_for(lk, std::chrono::microseconds(*timeout));
-            const auto end = std::chrono::high_resolution_clock::now();
-            const auto time =
-                std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-            if (status == std::cv_status::timeout) {
-                *timeout = 0;
-            } else {
-                *timeout -= time;
+            const auto start = std::chrono::steady_clock::now();
+            const auto end = start + std::chrono::microseconds(*timeout);
+            while (status.load(std::memory_order_acquire) == Waiting) {
+                const auto now = std::chrono::steady_clock::now();
+                if (now >= end) {
+                    *timeout = 0;
+                    return false;
+                }
+                const std::chrono::nanoseconds remaining = end - now;
+                Common::FutexWait(status, Waiting, &remaining);
             }
-            return GetResult(status == std::cv_status::timeout);
+            const auto time = std::chrono::duration_cast<std::chrono::microseconds>(
+                                  std::chrono::steady_clock::now() - start)
+                                  .count();
+            *timeout = time >= *timeout ? 0 : *timeout - time;
+            return true;
         }
     };
 
@@ -146,12 +221,26 @@ public:
         wait_list.insert(it, waiter);
     }
 
+    // The token count (low half) and number of queued waiters (high half) share one word,
+    // so the fast paths can tell whether anybody needs to be woken without taking the lock.
+    static constexpr u64 WaiterOne = 1ULL << 32;
+
+    static constexpr u64 MakeState(s32 token_count, u32 num_waiters) {
+        return (u64(num_waiters) << 32) | u32(token_count);
+    }
+    static constexpr s32 TokenCount(u64 state) {
+        return static_cast<s32>(state & 0xFFFFFFFFULL);
+    }
+    static constexpr u32 NumWaiters(u64 state) {
+        return static_cast<u32>(state >> 32);
+    }
+
     using WaitingThreads =
         boost::intrusive::list<WaitingThread, boost::intrusive::base_hook<ListBaseHook>,
                                boost::intrusive::constant_time_size<false>>;
     WaitingThreads wait_list;
     std::string name;
-    std::atomic<s32> token_count;
+    std::atomic<u64> state;
     std::mutex mutex;
     s32 max_count;
     s32 init_count;
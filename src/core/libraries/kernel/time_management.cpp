@@ -1,10 +1,18 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
 #include <thread>
+#include <immintrin.h>
 #include "common/assert.h"
+#include "common/config.h"
+#include "common/logging/log.h"
 #include "common/native_clock.h"
+#include "common/uint128.h"
 #include "core/libraries/error_codes.h"
+#include "core/libraries/kernel/libkernel.h"
 #include "core/libraries/kernel/time_management.h"
 #include "core/libraries/libs.h"
 
@@ -20,6 +28,10 @@
 #include <unistd.h>
 #endif
 
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
 namespace Libraries::Kernel {
 
 static u64 initial_ptc;
@@ -45,32 +57,117 @@ u64 PS4_SYSV_ABI sceKernelReadTsc() {
     return clock->GetUptime();
 }
 
-int PS4_SYSV_ABI sceKernelUsleep(u32 microseconds) {
+// Host sleeps wake up late by a roughly constant amount. Sleeping for the requested time minus
+// that amount and spinning on the TSC for the remainder lands close to the deadline without
+// burning a core for the whole duration.
+static constexpr u64 MinSleepMarginNs = 5'000;
+static constexpr u64 MaxSleepMarginNs = 100'000;
+static constexpr u64 SleepStatsInterval = 4096;
+// Past this much remaining time the spin yields instead of pausing, so a late host wakeup does
+// not keep a core busy when other threads are runnable.
+static constexpr u64 SpinYieldNs = 20'000;
+// Longer requests are clamped, sleeping for over a year is as good as forever.
+static constexpr s64 MaxSleepSeconds = 365 * 24 * 60 * 60;
+
+static std::atomic<u64> sleep_margin_ns{50'000};
+
+// Sleep accuracy, only collected with the PerfStats debug option. It lives until exit, so it is
+// logged periodically instead of through Common::PerfStats, which reports on destruction.
+struct SleepStats {
+    std::atomic<u64> count;
+    std::atomic<u64> total_error_ns;
+    std::atomic<u64> max_error_ns;
+};
+static SleepStats sleep_stats;
+
+static void HostSleep(u64 ns) {
 #ifdef _WIN64
-    if (microseconds < 1000u) {
-        LARGE_INTEGER interval{
-            .QuadPart = -1 * (microseconds * 10u),
-        };
-        NtDelayExecution(FALSE, &interval);
-    } else {
-        std::this_thread::sleep_for(std::chrono::microseconds(microseconds));
+    LARGE_INTEGER interval{
+        .QuadPart = -static_cast<s64>(ns / 100),
+    };
+    NtDelayExecution(FALSE, &interval);
+#elif defined(__linux__)
+    // Absolute deadlines keep signal restarts from accumulating extra delay.
+    timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    const u64 target_ns = deadline.tv_nsec + ns;
+    deadline.tv_sec += target_ns / 1'000'000'000;
+    deadline.tv_nsec = target_ns % 1'000'000'000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
     }
-    return 0;
 #else
-    timespec start;
+    timespec request{
+        .tv_sec = static_cast<time_t>(ns / 1'000'000'000),
+        .tv_nsec = static_cast<long>(ns % 1'000'000'000),
+    };
     timespec remain;
-    start.tv_sec = microseconds / 1000000;
-    start.tv_nsec = (microseconds % 1000000) * 1000;
-    timespec* requested = &start;
-    int ret = 0;
-    do {
-        ret = nanosleep(requested, &remain);
-        requested = &remain;
-    } while (ret != 0);
-    return ret;
+    while (nanosleep(&request, &remain) != 0 && errno == EINTR) {
+        request = remain;
+    }
 #endif
 }
 
+static void RecordSleep(u64 requested_ns, u64 actual_ns) {
+    if (!Config::perfStats()) {
+        return;
+    }
+    const u64 error_ns = actual_ns > requested_ns ? actual_ns - requested_ns : 0;
+    const u64 count = sleep_stats.count.fetch_add(1, std::memory_order_relaxed) + 1;
+    const u64 total = sleep_stats.total_error_ns.fetch_add(error_ns, std::memory_order_relaxed);
+    u64 max = sleep_stats.max_error_ns.load(std::memory_order_relaxed);
+    while (error_ns > max &&
+           !sleep_stats.max_error_ns.compare_exchange_weak(max, error_ns,
+                                                           std::memory_order_relaxed)) {
+    }
+    if (count % SleepStatsInterval == 0) {
+        LOG_DEBUG(Lib_Kernel, "Sleeps: {}, avg overshoot {} ns, max overshoot {} ns, margin {} ns",
+                  count, (total + error_ns) / count, std::max(max, error_ns),
+                  sleep_margin_ns.load(std::memory_order_relaxed));
+    }
+}
+
+static void PreciseSleep(u64 ns) {
+    if (ns == 0) {
+        // Guests commonly use a zero sleep to give up their time slice.
+        std::this_thread::yield();
+        return;
+    }
+    const u64 freq = clock->GetTscFrequency();
+    const u64 start = clock->GetUptime();
+    const u64 deadline = start + Common::MultiplyAndDivide64(ns, freq, 1'000'000'000);
+
+    const u64 margin = sleep_margin_ns.load(std::memory_order_relaxed);
+    if (ns > margin) {
+        const u64 host_ns = ns - margin;
+        HostSleep(host_ns);
+
+        // Track how late the host sleep woke up, smoothed over recent sleeps. The margin aims
+        // for twice the average lateness so outliers still end in the spin.
+        const u64 slept_ns =
+            Common::MultiplyAndDivide64(clock->GetUptime() - start, 1'000'000'000, freq);
+        const u64 late_ns = slept_ns > host_ns ? slept_ns - host_ns : 0;
+        const u64 new_margin = std::clamp((margin * 7 + late_ns * 2) / 8, MinSleepMarginNs,
+                                          MaxSleepMarginNs);
+        sleep_margin_ns.store(new_margin, std::memory_order_relaxed);
+    }
+
+    const u64 yield_ticks = Common::MultiplyAndDivide64(SpinYieldNs, freq, 1'000'000'000);
+    u64 now;
+    while ((now = clock->GetUptime()) < deadline) {
+        if (deadline - now > yield_ticks) {
+            std::this_thread::yield();
+        } else {
+            _mm_pause();
+        }
+    }
+    RecordSleep(ns, Common::MultiplyAndDivide64(now - start, 1'000'000'000, freq));
+}
+
+int PS4_SYSV_ABI sceKernelUsleep(u32 microseconds) {
+    PreciseSleep(static_cast<u64>(microseconds) * 1000);
+    return 0;
+}
+
 int PS4_SYSV_ABI posix_usleep(u32 microseconds) {
     return sceKernelUsleep(microseconds);
 }
@@ -120,10 +217,30 @@ int PS4_SYSV_ABI posix_clock_gettime(s32 clock_id, OrbisKernelTimespec* time) {
     return result;
 }
 
+static bool IsValidSleep(const OrbisKernelTimespec* rqtp) {
+    return rqtp->tv_sec >= 0 && rqtp->tv_nsec >= 0 && rqtp->tv_nsec < 1'000'000'000;
+}
+
+static void Nanosleep(const OrbisKernelTimespec* rqtp, OrbisKernelTimespec* rmtp) {
+    const s64 seconds = std::min<s64>(rqtp->tv_sec, MaxSleepSeconds);
+    PreciseSleep(static_cast<u64>(seconds) * 1'000'000'000 + rqtp->tv_nsec);
+    if (rmtp != nullptr) {
+        rmtp->tv_sec = 0;
+        rmtp->tv_nsec = 0;
+    }
+}
+
 int PS4_SYSV_ABI posix_nanosleep(const OrbisKernelTimespec* rqtp, OrbisKernelTimespec* rmtp) {
-    const auto* request = reinterpret_cast<const timespec*>(rqtp);
-    auto* remain = reinterpret_cast<timespec*>(rmtp);
-    return nanosleep(request, remain);
+    if (rqtp == nullptr) {
+        SetPosixErrno(EFAULT);
+        return -1;
+    }
+    if (!IsValidSleep(rqtp)) {
+        SetPosixErrno(EINVAL);
+        return -1;
+    }
+    Nanosleep(rqtp, rmtp);
+    return 0;
 }
 
 int PS4_SYSV_ABI sceKernelNanosleep(const OrbisKernelTimespec* rqtp, OrbisKernelTimespec* rmtp) {
@@ -131,11 +248,12 @@ int PS4_SYSV_ABI sceKernelNanosleep(const OrbisKernelTimespec* rqtp, OrbisKernel
         return SCE_KERNEL_ERROR_EFAULT;
     }
 
-    if (rqtp->tv_sec < 0 || rqtp->tv_nsec < 0) {
+    if (!IsValidSleep(rqtp)) {
         return SCE_KERNEL_ERROR_EINVAL;
     }
 
-    return posix_nanosleep(rqtp, rmtp);
+    Nanosleep(rqtp, rmtp);
+    return SCE_OK;
 }
 
 int PS4_SYSV_ABI sceKernelGettimeofday(OrbisKernelTimeval* tp) {
@@ -240,6 +358,11 @@ int PS4_SYSV_ABI sceKernelConvertLocaltimeToUtc(time_t param_1, int64_t param_2,
 void timeSymbolsRegister(Core::Loader::SymbolsResolver* sym) {
     clock = std::make_unique<Common::NativeClock>();
     initial_ptc = clock->GetUptime();
+#ifdef __linux__
+    // The default 50us timer slack delays every timed wait of the guest. Threads created from
+    // here on inherit the tighter value.
+    prctl(PR_SET_TIMERSLACK, 1UL);
+#endif
     LIB_FUNCTION("4J2sUJmuHZQ", "libkernel", 1, "libkernel", 1, 1, sceKernelGetProcessTime);
     LIB_FUNCTION("fgxnMeTNUtY", "libkernel", 1, "libkernel", 1, 1, sceKernelGetProcessTimeCounter);
     LIB_FUNCTION("BNowx2l588E", "libkernel", 1, "libkernel", 1, 1,
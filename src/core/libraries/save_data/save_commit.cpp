@@ -0,0 +1,252 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <cstring>
+#include "common/io_file.h"
+#include "common/logging/log.h"
+#include "common/thread.h"
+#include "core/libraries/save_data/save_commit.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#elif defined(__APPLE__)
+#include <sys/clonefile.h>
+#endif
+
+namespace Libraries::SaveData {
+
+namespace {
+
+bool IsUnder(const std::filesystem::path& path, const std::filesystem::path& prefix) {
+    const auto [prefix_end, path_it] =
+        std::mismatch(prefix.begin(), prefix.end(), path.begin(), path.end());
+    return prefix_end == prefix.end();
+}
+
+std::filesystem::path TempPath(const std::filesystem::path& path) {
+    auto temp = path;
+    temp += ".tmp";
+    return temp;
+}
+
+/// Copies a file, sharing its extents with the source when the filesystem supports it.
+bool CloneFile(const std::filesystem::path& src, const std::filesystem::path& dst) {
+#ifdef __linux__
+    const int src_fd = open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (src_fd >= 0) {
+        const int dst_fd = open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        const bool cloned = dst_fd >= 0 && ioctl(dst_fd, FICLONE, src_fd) == 0;
+        if (dst_fd >= 0) {
+            close(dst_fd);
+        }
+        close(src_fd);
+        if (cloned) {
+            return true;
+        }
+    }
+#elif defined(__APPLE__)
+    std::error_code remove_ec;
+    std::filesystem::remove(dst, remove_ec);
+    if (clonefile(src.c_str(), dst.c_str(), 0) == 0) {
+        return true;
+    }
+#endif
+    std::error_code ec;
+    std::filesystem::copy_file(src, dst, std::filesystem::copy_options::overwrite_existing, ec);
+    return !ec;
+}
+
+} // Anonymous namespace
+
+SaveCommitQueue::SaveCommitQueue() {
+    commit_thread = std::jthread([this](std::stop_token stop_token) { CommitThread(stop_token); });
+}
+
+SaveCommitQueue::~SaveCommitQueue() {
+    WaitIdle();
+}
+
+void SaveCommitQueue::Write(const std::filesystem::path& path, std::span<const u8> data,
+                            u64 offset, bool truncate) {
+    std::scoped_lock lk{mutex};
+    auto [it, is_new] = mergeable_jobs.try_emplace(path);
+    if (is_new) {
+        it->second = &jobs.emplace_back(Job{path, false, {}});
+        it->second->pending.queued = Clock::now();
+    } else {
+        stats.Add(Counter::CoalescedWrites);
+    }
+    auto& pending = it->second->pending;
+    if (truncate) {
+        // Everything queued so far is overwritten by this write.
+        pending.patches.clear();
+        pending.truncate = true;
+    }
+    pending.patches.push_back({offset, std::vector<u8>(data.begin(), data.end())});
+    submit_cv.notify_one();
+}
+
+void SaveCommitQueue::Backup(const std::filesystem::path& dir) {
+    std::scoped_lock lk{mutex};
+    // Writes queued after this point must not end up in the backup, so they start new jobs.
+    std::erase_if(mergeable_jobs, [&](const auto& entry) { return IsUnder(entry.first, dir); });
+    jobs.push_back({dir, true, {}});
+    submit_cv.notify_one();
+}
+
+void SaveCommitQueue::Wait(const std::filesystem::path& path) {
+    std::unique_lock lk{mutex};
+    done_cv.wait(lk, [&] { return !IsBusy(path); });
+}
+
+void SaveCommitQueue::WaitIdle() {
+    std::unique_lock lk{mutex};
+    done_cv.wait(lk, [this] { return jobs.empty() && in_flight.empty(); });
+}
+
+bool SaveCommitQueue::TakeFailure(const std::filesystem::path& path) {
+    std::scoped_lock lk{mutex};
+    return std::erase_if(failures, [&](const auto& failed) {
+        return IsUnder(failed, path) || IsUnder(path, failed);
+    }) != 0;
+}
+
+bool SaveCommitQueue::IsBusy(const std::filesystem::path& path) const {
+    if (!in_flight.empty() && (IsUnder(in_flight, path) || IsUnder(path, in_flight))) {
+        return true;
+    }
+    return std::ranges::any_of(jobs, [&](const Job& job) {
+        return IsUnder(job.path, path) || (job.is_backup && IsUnder(path, job.path));
+    });
+}
+
+void SaveCommitQueue::CommitThread(std::stop_token stop_token) {
+    Common::SetCurrentThreadName("shadPS4:SaveCommit");
+    while (true) {
+        Job job;
+        {
+            std::unique_lock lk{mutex};
+            Common::CondvarWait(submit_cv, lk, stop_token, [this] { return !jobs.empty(); });
+            if (jobs.empty()) {
+                // Stop was requested and there is nothing left to commit.
+                return;
+            }
+            if (const auto it = mergeable_jobs.find(jobs.front().path);
+                it != mergeable_jobs.end() && it->second == &jobs.front()) {
+                mergeable_jobs.erase(it);
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            in_flight = job.path;
+        }
+
+        const bool committed =
+            job.is_backup ? CommitBackup(job.path) : CommitFile(job.path, job.pending);
+
+        std::scoped_lock lk{mutex};
+        if (!committed) {
+            failures.push_back(job.path);
+        }
+        in_flight.clear();
+        done_cv.notify_all();
+    }
+}
+
+bool SaveCommitQueue::CommitFile(const std::filesystem::path& path, PendingFile& pending) {
+    std::error_code ec;
+    std::vector<u8> contents;
+    if (!pending.truncate && std::filesystem::exists(path, ec)) {
+        Common::FS::IOFile file(path, Common::FS::FileAccessMode::Read);
+        contents.resize(file.GetSize());
+        file.ReadSpan<u8>(contents);
+    }
+    for (const auto& patch : pending.patches) {
+        const u64 end = patch.offset + patch.data.size();
+        if (contents.size() < end) {
+            contents.resize(end);
+        }
+        std::memcpy(contents.data() + patch.offset, patch.data.data(), patch.data.size());
+    }
+
+    const auto temp_path = TempPath(path);
+    {
+        Common::FS::IOFile file(temp_path, Common::FS::FileAccessMode::Write);
+        if (!file.IsOpen() || file.WriteSpan<u8>(contents) != contents.size() || !file.Commit()) {
+            LOG_ERROR(Lib_SaveData, "Failed to write save data file {}", temp_path.string());
+            return false;
+        }
+    }
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec) {
+        LOG_ERROR(Lib_SaveData, "Failed to commit save data file {}: {}", path.string(),
+                  ec.message());
+        return false;
+    }
+
+    const u64 latency_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                               Clock::now() - pending.queued)
+                               .count();
+    LOG_DEBUG(Lib_SaveData, "Committed {} ({} bytes, {} writes) in {} us", path.string(),
+              contents.size(), pending.patches.size(), latency_us);
+    stats.Add(Counter::Commits);
+    stats.Add(Counter::BytesWritten, contents.size());
+    stats.Add(Counter::TotalLatencyUs, latency_us);
+    stats.Max(Counter::MaxLatencyUs, latency_us);
+    return true;
+}
+
+bool SaveCommitQueue::CommitBackup(const std::filesystem::path& dir) {
+    const auto start = Clock::now();
+    auto backup_dir = dir;
+    backup_dir += "_backup";
+    const auto temp_dir = TempPath(backup_dir);
+
+    // Every filesystem call reports errors through ec, an exception escaping the commit thread
+    // would terminate the emulator.
+    std::error_code ec;
+    std::filesystem::remove_all(temp_dir, ec);
+    std::filesystem::create_directories(temp_dir, ec);
+    u64 bytes = 0;
+    bool copied = !ec;
+    std::filesystem::recursive_directory_iterator it{dir, ec};
+    copied &= !ec;
+    for (const std::filesystem::recursive_directory_iterator end; copied && it != end;
+         it.increment(ec)) {
+        const auto& entry = *it;
+        std::error_code entry_ec;
+        const auto target = temp_dir / std::filesystem::relative(entry.path(), dir, entry_ec);
+        if (entry.is_directory(entry_ec)) {
+            std::filesystem::create_directories(target, entry_ec);
+        } else if (entry.is_regular_file(entry_ec)) {
+            copied &= CloneFile(entry.path(), target);
+            bytes += entry.file_size(entry_ec);
+        }
+        copied &= !entry_ec;
+    }
+    if (!copied || ec) {
+        LOG_ERROR(Lib_SaveData, "Failed to copy save data backup of {}: {}", dir.string(),
+                  ec.message());
+        std::filesystem::remove_all(temp_dir, ec);
+        return false;
+    }
+    std::filesystem::remove_all(backup_dir, ec);
+    std::filesystem::rename(temp_dir, backup_dir, ec);
+    if (ec) {
+        LOG_ERROR(Lib_SaveData, "Failed to commit save data backup {}: {}", backup_dir.string(),
+                  ec.message());
+        return false;
+    }
+
+    const u64 latency_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+    LOG_DEBUG(Lib_SaveData, "Backed up {} ({} bytes) in {} us", dir.string(), bytes, latency_us);
+    stats.Add(Counter::Backups);
+    stats.Add(Counter::BytesWritten, bytes);
+    return true;
+}
+
+} // namespace Libraries::SaveData
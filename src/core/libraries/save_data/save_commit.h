@@ -0,0 +1,97 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <span>
+#include <vector>
+#include "common/perf_stats.h"
+#include "common/polyfill_thread.h"
+#include "common/types.h"
+
+namespace Libraries::SaveData {
+
+/**
+ * Background queue that moves save data disk I/O off the guest threads.
+ * Files are written to a temporary sibling and renamed over the destination once fully
+ * on disk, so a crash mid-commit leaves the previous contents intact. Repeated writes to a
+ * file that has not been committed yet are merged into a single commit, unless a backup of
+ * its directory was queued in between. Commits run after the guest was told they succeeded,
+ * so failures are recorded and reported by the next save call that checks for them.
+ */
+class SaveCommitQueue {
+    using Clock = std::chrono::steady_clock;
+
+public:
+    SaveCommitQueue();
+    ~SaveCommitQueue();
+
+    /// Queues a write of data at offset into the file at path. When truncate is set the file
+    /// contents are replaced, otherwise the data is patched over the existing file.
+    void Write(const std::filesystem::path& path, std::span<const u8> data, u64 offset = 0,
+               bool truncate = false);
+
+    /// Queues a backup of a save directory into <dir>_backup, after any pending writes to it.
+    void Backup(const std::filesystem::path& dir);
+
+    /// Blocks until every commit touching path (a file or a directory prefix) is on disk.
+    void Wait(const std::filesystem::path& path);
+
+    /// Returns true if a commit under path failed since the last call, clearing the failure.
+    bool TakeFailure(const std::filesystem::path& path);
+
+    /// Blocks until the queue is empty.
+    void WaitIdle();
+
+private:
+    struct Patch {
+        u64 offset;
+        std::vector<u8> data;
+    };
+
+    struct PendingFile {
+        std::vector<Patch> patches;
+        bool truncate{};
+        Clock::time_point queued;
+    };
+
+    enum class Counter : u32 {
+        Commits,
+        CoalescedWrites,
+        Backups,
+        BytesWritten,
+        TotalLatencyUs,
+        MaxLatencyUs,
+    };
+
+    struct Job {
+        std::filesystem::path path;
+        bool is_backup{};
+        PendingFile pending;
+    };
+
+    void CommitThread(std::stop_token stop_token);
+    bool CommitFile(const std::filesystem::path& path, PendingFile& pending);
+    bool CommitBackup(const std::filesystem::path& dir);
+    bool IsBusy(const std::filesystem::path& path) const;
+
+    std::mutex mutex;
+    std::condition_variable_any submit_cv;
+    std::condition_variable done_cv;
+    std::deque<Job> jobs;
+    /// Queued file jobs later writes to the same file can still be merged into. Elements of a
+    /// deque stay in place when others are pushed or popped at the ends.
+    std::map<std::filesystem::path, Job*> mergeable_jobs;
+    std::vector<std::filesystem::path> failures;
+    std::filesystem::path in_flight;
+    Common::PerfStats<Counter> stats{Common::Log::Class::Lib_SaveData, "Save commits"};
+    std::jthread commit_thread;
+};
+
+} // namespace Libraries::SaveData
@@ -11,6 +11,7 @@
 #include "common/logging/log.h"
 #include "core/libraries/error_codes.h"
 #include "core/libraries/libs.h"
+#include "core/libraries/save_data/save_commit.h"
 #include "core/libraries/save_data/savedata.h"
 #include "error_codes.h"
 
@@ -19,6 +20,19 @@ bool is_rw_mode = false;
 static constexpr std::string_view g_mount_point = "/savedata0"; // temp mount point (todo)
 std::string game_serial;
 
+static SaveCommitQueue* GetCommitQueue() {
+    return Common::Singleton<SaveCommitQueue>::Instance();
+}
+
+/// Checks for a queued commit under path that failed after the guest was told it succeeded.
+static bool CommitFailed(const std::filesystem::path& path) {
+    if (!GetCommitQueue()->TakeFailure(path)) {
+        return false;
+    }
+    LOG_ERROR(Lib_SaveData, "A previous commit under {} failed", path.string());
+    return true;
+}
+
 int PS4_SYSV_ABI sceSaveDataAbort() {
     LOG_ERROR(Lib_SaveData, "(STUBBED) called");
     return ORBIS_OK;
@@ -150,6 +164,7 @@ int PS4_SYSV_ABI sceSaveDataDelete(const OrbisSaveDataDelete* del) {
                             std::to_string(1) / game_serial / std::string(del->dirName->data);
     LOG_INFO(Lib_SaveData, "called: dirname = {}, mount_dir = {}", (char*)del->dirName->data,
              mount_dir.string());
+    GetCommitQueue()->Wait(mount_dir);
     if (std::filesystem::exists(mount_dir) && std::filesystem::is_directory(mount_dir)) {
         std::filesystem::remove_all(mount_dir);
     }
@@ -316,6 +331,7 @@ int PS4_SYSV_ABI sceSaveDataGetParam(const OrbisSaveDataMountPoint* mountPoint,
 
     auto* mnt = Common::Singleton<Core::FileSys::MntPoints>::Instance();
     const auto mount_dir = mnt->GetHostPath(mountPoint->data);
+    GetCommitQueue()->Wait(mount_dir / "param.txt");
     Common::FS::IOFile file(mount_dir / "param.txt", Common::FS::FileAccessMode::Read);
     OrbisSaveDataParam params;
     file.Read(params);
@@ -370,6 +386,7 @@ int PS4_SYSV_ABI sceSaveDataGetSaveDataMemory(const u32 userId, void* buf, const
     const auto& mount_dir = Common::FS::GetUserPath(Common::FS::PathType::SaveDataDir) /
                             std::to_string(userId) / game_serial / "sdmemory/save_mem1.sav";
 
+    GetCommitQueue()->Wait(mount_dir);
     Common::FS::IOFile file(mount_dir, Common::FS::FileAccessMode::Read);
     if (!file.IsOpen()) {
         return false;
@@ -386,6 +403,7 @@ int PS4_SYSV_ABI sceSaveDataGetSaveDataMemory2(OrbisSaveDataMemoryGet2* getParam
                             std::to_string(getParam->userId) / game_serial / "sdmemory";
     if (getParam == nullptr)
         return ORBIS_SAVE_DATA_ERROR_PARAMETER;
+    GetCommitQueue()->Wait(mount_dir);
     if (getParam->data != nullptr) {
         Common::FS::IOFile file(mount_dir / "save_mem2.sav", Common::FS::FileAccessMode::Read);
         if (!file.IsOpen()) {
@@ -473,6 +491,7 @@ int PS4_SYSV_ABI sceSaveDataLoadIcon(const OrbisSaveDataMountPoint* mountPoint,
     LOG_INFO(Lib_SaveData, "called: dir = {}", mount_dir.string());
 
     if (icon != nullptr) {
+        GetCommitQueue()->Wait(mount_dir / "save_data.png");
         Common::FS::IOFile file(mount_dir / "save_data.png", Common::FS::FileAccessMode::Read);
         icon->bufSize = file.GetSize();
         file.ReadRaw<u8>(icon->buf, icon->bufSize);
@@ -485,6 +504,8 @@ s32 saveDataMount(u32 user_id, char* dir_name, u32 mount_mode,
     const auto& mount_dir = Common::FS::GetUserPath(Common::FS::PathType::SaveDataDir) /
                             std::to_string(user_id) / game_serial / dir_name;
     auto* mnt = Common::Singleton<Core::FileSys::MntPoints>::Instance();
+    // A backup of this directory may still be in progress from a previous unmount.
+    GetCommitQueue()->Wait(mount_dir);
     switch (mount_mode) {
     case ORBIS_SAVE_DATA_MOUNT_MODE_RDONLY:
     case ORBIS_SAVE_DATA_MOUNT_MODE_RDWR:
@@ -606,10 +627,13 @@ int PS4_SYSV_ABI sceSaveDataSaveIcon(const OrbisSaveDataMountPoint* mountPoint,
     auto* mnt = Common::Singleton<Core::FileSys::MntPoints>::Instance();
     const auto mount_dir = mnt->GetHostPath(mountPoint->data);
     LOG_INFO(Lib_SaveData, "called = {}", mount_dir.string());
+    if (CommitFailed(mount_dir)) {
+        return ORBIS_SAVE_DATA_ERROR_INTERNAL;
+    }
 
     if (icon != nullptr) {
-        Common::FS::IOFile file(mount_dir / "save_data.png", Common::FS::FileAccessMode::Write);
-        file.WriteRaw<u8>(icon->buf, icon->bufSize);
+        GetCommitQueue()->Write(mount_dir / "save_data.png",
+                                {static_cast<const u8*>(icon->buf), icon->bufSize}, 0, true);
     }
     return ORBIS_OK;
 }
@@ -633,6 +657,10 @@ int PS4_SYSV_ABI sceSaveDataSetParam(const OrbisSaveDataMountPoint* mountPoint,
     auto* mnt = Common::Singleton<Core::FileSys::MntPoints>::Instance();
     const auto mount_dir = mnt->GetHostPath(mountPoint->data) / "param.txt";
     OrbisSaveDataParam params;
+    GetCommitQueue()->Wait(mount_dir);
+    if (CommitFailed(mount_dir.parent_path())) {
+        return ORBIS_SAVE_DATA_ERROR_INTERNAL;
+    }
     if (std::filesystem::exists(mount_dir)) {
         Common::FS::IOFile file(mount_dir, Common::FS::FileAccessMode::Read);
         file.ReadRaw<u8>(&params, sizeof(OrbisSaveDataParam));
@@ -664,8 +692,8 @@ int PS4_SYSV_ABI sceSaveDataSetParam(const OrbisSaveDataMountPoint* mountPoint,
     }
     }
 
-    Common::FS::IOFile file(mount_dir, Common::FS::FileAccessMode::Write);
-    file.WriteRaw<u8>(&params, sizeof(OrbisSaveDataParam));
+    GetCommitQueue()->Write(
+        mount_dir, {reinterpret_cast<const u8*>(&params), sizeof(OrbisSaveDataParam)}, 0, true);
 
     return ORBIS_OK;
 }
@@ -680,10 +708,11 @@ int PS4_SYSV_ABI sceSaveDataSetSaveDataMemory(const u32 userId, const void* buf,
     LOG_INFO(Lib_SaveData, "called");
     const auto& mount_dir = Common::FS::GetUserPath(Common::FS::PathType::SaveDataDir) /
                             std::to_string(userId) / game_serial / "sdmemory/save_mem1.sav";
+    if (CommitFailed(mount_dir.parent_path())) {
+        return ORBIS_SAVE_DATA_ERROR_INTERNAL;
+    }
 
-    Common::FS::IOFile file(mount_dir, Common::FS::FileAccessMode::Write);
-    file.Seek(offset);
-    file.WriteRaw<u8>(buf, bufSize);
+    GetCommitQueue()->Write(mount_dir, {static_cast<const u8*>(buf), bufSize}, offset);
 
     return ORBIS_OK;
 }
@@ -692,22 +721,28 @@ int PS4_SYSV_ABI sceSaveDataSetSaveDataMemory2(const OrbisSaveDataMemorySet2* se
     LOG_INFO(Lib_SaveData, "called: dataNum = {}, slotId= {}", setParam->dataNum, setParam->slotId);
     const auto& mount_dir = Common::FS::GetUserPath(Common::FS::PathType::SaveDataDir) /
                             std::to_string(setParam->userId) / game_serial / "sdmemory";
+    auto* commit_queue = GetCommitQueue();
+    if (CommitFailed(mount_dir)) {
+        return ORBIS_SAVE_DATA_ERROR_INTERNAL;
+    }
     if (setParam->data != nullptr) {
-        Common::FS::IOFile file(mount_dir / "save_mem2.sav", Common::FS::FileAccessMode::Write);
-        if (!file.IsOpen())
+        if (!std::filesystem::exists(mount_dir))
             return -1;
-        file.Seek(setParam->data->offset);
-        file.WriteRaw<u8>(setParam->data->buf, setParam->data->bufSize);
+        commit_queue->Write(mount_dir / "save_mem2.sav",
+                            {static_cast<const u8*>(setParam->data->buf), setParam->data->bufSize},
+                            setParam->data->offset);
     }
 
     if (setParam->param != nullptr) {
-        Common::FS::IOFile file(mount_dir / "param.txt", Common::FS::FileAccessMode::Write);
-        file.WriteRaw<u8>((void*)setParam->param, sizeof(OrbisSaveDataParam));
+        commit_queue->Write(
+            mount_dir / "param.txt",
+            {reinterpret_cast<const u8*>(setParam->param), sizeof(OrbisSaveDataParam)}, 0, true);
     }
 
     if (setParam->icon != nullptr) {
-        Common::FS::IOFile file(mount_dir / "save_icon.png", Common::FS::FileAccessMode::Write);
-        file.WriteRaw<u8>(setParam->icon->buf, setParam->icon->bufSize);
+        commit_queue->Write(mount_dir / "save_icon.png",
+                            {static_cast<const u8*>(setParam->icon->buf), setParam->icon->bufSize},
+                            0, true);
     }
 
     return ORBIS_OK;
@@ -721,6 +756,7 @@ int PS4_SYSV_ABI sceSaveDataSetupSaveDataMemory(u32 userId, size_t memorySize,
     const auto& mount_dir = Common::FS::GetUserPath(Common::FS::PathType::SaveDataDir) /
                             std::to_string(userId) / game_serial / "sdmemory";
 
+    GetCommitQueue()->Wait(mount_dir);
     if (std::filesystem::exists(mount_dir)) {
         return ORBIS_SAVE_DATA_ERROR_EXISTS;
     }
@@ -739,6 +775,7 @@ int PS4_SYSV_ABI sceSaveDataSetupSaveDataMemory2(const OrbisSaveDataMemorySetup2
     // if (setupParam->option == 1) { // check this later.
     const auto& mount_dir = Common::FS::GetUserPath(Common::FS::PathType::SaveDataDir) /
                             std::to_string(setupParam->userId) / game_serial / "sdmemory";
+    GetCommitQueue()->Wait(mount_dir);
     if (std::filesystem::exists(mount_dir) &&
         std::filesystem::exists(mount_dir / "save_mem2.sav")) {
         Common::FS::IOFile file(mount_dir / "save_mem2.sav", Common::FS::FileAccessMode::Read);
@@ -777,12 +814,24 @@ int PS4_SYSV_ABI sceSaveDataSyncCloudList() {
 }
 
 int PS4_SYSV_ABI sceSaveDataSyncSaveDataMemory(OrbisSaveDataMemorySync* syncParam) {
-    LOG_ERROR(Lib_SaveData, "(STUBBED) called: option = {}", syncParam->option);
+    if (syncParam == nullptr) {
+        return ORBIS_SAVE_DATA_ERROR_PARAMETER;
+    }
+    LOG_INFO(Lib_SaveData, "called: option = {}", syncParam->option);
+    const auto& mount_dir = Common::FS::GetUserPath(Common::FS::PathType::SaveDataDir) /
+                            std::to_string(syncParam->userId) / game_serial / "sdmemory";
+    if (syncParam->option & SCE_SAVE_DATA_MEMORY_SYNC_OPTION_BLOCKING) {
+        GetCommitQueue()->Wait(mount_dir);
+    }
+    if (CommitFailed(mount_dir)) {
+        return ORBIS_SAVE_DATA_ERROR_INTERNAL;
+    }
     return ORBIS_OK;
 }
 
 int PS4_SYSV_ABI sceSaveDataTerminate() {
-    LOG_ERROR(Lib_SaveData, "(STUBBED) called");
+    LOG_INFO(Lib_SaveData, "called");
+    GetCommitQueue()->WaitIdle();
     return ORBIS_OK;
 }
 
@@ -802,7 +851,11 @@ s32 PS4_SYSV_ABI sceSaveDataUmount(const OrbisSaveDataMountPoint* mountPoint) {
     const auto& guest_path = mnt->GetHostPath(mountPoint->data);
     if (guest_path.empty())
         return ORBIS_SAVE_DATA_ERROR_NOT_MOUNTED;
+    GetCommitQueue()->Wait(guest_path);
     mnt->Unmount(mount_dir, mountPoint->data);
+    if (CommitFailed(guest_path)) {
+        return ORBIS_SAVE_DATA_ERROR_INTERNAL;
+    }
     return ORBIS_OK;
 }
 
@@ -819,29 +872,18 @@ int PS4_SYSV_ABI sceSaveDataUmountWithBackup(const OrbisSaveDataMountPoint* moun
     if (!std::filesystem::exists(mount_dir)) {
         return ORBIS_SAVE_DATA_ERROR_NOT_FOUND;
     }
-    // leave disabled for now. and just unmount.
-
-    /* if (is_rw_mode) { // backup is done only when mount mode is ReadWrite.
-        auto backup_path = mount_dir;
-        std::string save_data_dir = (mount_dir.string() + "_backup");
-        backup_path.replace_filename(save_data_dir);
-
-        std::filesystem::create_directories(backup_path);
-
-        for (const auto& entry : std::filesystem::recursive_directory_iterator(mount_dir)) {
-            const auto& path = entry.path();
-            if (std::filesystem::is_regular_file(path)) {
-                std::filesystem::copy(path, save_data_dir,
-                                      std::filesystem::copy_options::overwrite_existing);
-            }
-        }
-    }*/
+    // Don't back up a directory whose last writes never reached the disk.
+    const bool commit_failed = CommitFailed(mount_dir);
+    if (is_rw_mode && !commit_failed) { // backup is done only when mount mode is ReadWrite.
+        // Runs after any pending writes to the directory, a later mount waits for it.
+        GetCommitQueue()->Backup(mount_dir);
+    }
     const auto& guest_path = mnt->GetHostPath(mountPoint->data);
     if (guest_path.empty())
         return ORBIS_SAVE_DATA_ERROR_NOT_MOUNTED;
 
     mnt->Unmount(mount_dir, mountPoint->data);
-    return ORBIS_OK;
+    return commit_failed ? ORBIS_SAVE_DATA_ERROR_INTERNAL : ORBIS_OK;
 }
 
 int PS4_SYSV_ABI sceSaveDataUnregisterEventCallback() {
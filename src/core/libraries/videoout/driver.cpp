@@ -54,7 +54,6 @@ int VideoOutDriver::Open(const ServiceThreadParams* params) {
         return ORBIS_VIDEO_OUT_ERROR_RESOURCE_BUSY;
     }
     main_port.is_open = true;
-    liverpool->SetVoPort(&main_port);
     return 1;
 }
 
@@ -133,7 +132,9 @@ int VideoOutDriver::RegisterBuffers(VideoOutPort* port, s32 startIndex, void* co
             .address_right = 0,
         };
 
-        renderer->RegisterVideoOutSurface(group, address);
+        if (renderer) {
+            renderer->RegisterVideoOutSurface(group, address);
+        }
         LOG_INFO(Lib_VideoOut, "buffers[{}] = {:#x}", i + startIndex, address);
     }
 
@@ -167,7 +168,7 @@ std::chrono::microseconds VideoOutDriver::Flip(const Request& req) {
     const auto start = std::chrono::high_resolution_clock::now();
 
     // Whatever the game is rendering show splash if it is active
-    if (!renderer->ShowSplash(req.frame)) {
+    if (renderer && !renderer->ShowSplash(req.frame)) {
         // Present the frame.
         renderer->Present(req.frame);
     }
@@ -199,7 +200,7 @@ std::chrono::microseconds VideoOutDriver::Flip(const Request& req) {
     // Reset flip label
     if (req.index != -1) {
         port->buffer_labels[req.index] = 0;
-        port->SignalVoLabel();
+        liverpool->NotifyLabelWrite(reinterpret_cast<VAddr>(&port->buffer_labels[req.index]));
     }
 
     const auto end = std::chrono::high_resolution_clock::now();
@@ -227,7 +228,9 @@ bool VideoOutDriver::SubmitFlip(VideoOutPort* port, s32 index, s64 flip_arg,
         // point VO surface is ready to be presented, and we will need have an actual state of
         // Vulkan image at the time of frame presentation.
         liverpool->SendCommand([=, this]() {
-            renderer->FlushDraw();
+            if (renderer) {
+                renderer->FlushDraw();
+            }
             SubmitFlipInternal(port, index, flip_arg, is_eop);
         });
     } else {
@@ -239,14 +242,19 @@ bool VideoOutDriver::SubmitFlip(VideoOutPort* port, s32 index, s64 flip_arg,
 
 void VideoOutDriver::SubmitFlipInternal(VideoOutPort* port, s32 index, s64 flip_arg,
                                         bool is_eop /*= false*/) {
-    Vulkan::Frame* frame;
-    if (index == -1) {
+    liverpool->EndFrame();
+
+    Vulkan::Frame* frame = nullptr;
+    if (!renderer) {
+        // Null GPU, only the flip bookkeeping is done.
+    } else if (index == -1) {
         frame = renderer->PrepareBlankFrame(is_eop);
     } else {
         const auto& buffer = port->buffer_slots[index];
         const auto& group = port->groups[buffer.group_index];
         frame = renderer->PrepareFrame(group, buffer.address_left, is_eop);
     }
+    ASSERT(port != nullptr && (frame != nullptr || !renderer));
 
     std::scoped_lock lock{mutex};
     requests.push({
@@ -30,7 +30,6 @@ struct VideoOutPort {
     std::vector<Kernel::SceKernelEqueue> vblank_events;
     std::mutex vo_mutex;
     std::mutex port_mutex;
-    std::condition_variable vo_cv;
     std::condition_variable vblank_cv;
     int flip_rate = 0;
 
@@ -42,22 +41,6 @@ struct VideoOutPort {
         return index;
     }
 
-    bool IsVoLabel(const u64* address) const {
-        const u64* start = &buffer_labels[0];
-        const u64* end = &buffer_labels[MaxDisplayBuffers - 1];
-        return address >= start && address <= end;
-    }
-
-    void WaitVoLabel(auto&& pred) {
-        std::unique_lock lk{vo_mutex};
-        vo_cv.wait(lk, pred);
-    }
-
-    void SignalVoLabel() {
-        std::scoped_lock lk{vo_mutex};
-        vo_cv.notify_one();
-    }
-
     [[nodiscard]] int NumRegisteredBuffers() const {
         return std::count_if(buffer_slots.cbegin(), buffer_slots.cend(),
                              [](auto& buffer) { return buffer.group_index != -1; });
@@ -96,8 +79,10 @@ private:
         s64 flip_arg;
         bool eop;
 
+        /// False for the empty request returned when the queue is empty. Queued requests always
+        /// have a port, and a frame unless running without a renderer.
         operator bool() const noexcept {
-            return frame != nullptr;
+            return port != nullptr;
         }
     };
 
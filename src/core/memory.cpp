@@ -27,6 +27,9 @@ MemoryManager::MemoryManager() {
     vma_map.emplace(system_reserved_base,
                     VirtualMemoryArea{system_reserved_base, system_reserved_size});
     vma_map.emplace(user_base, VirtualMemoryArea{user_base, user_size});
+    for (const auto& [base, vma] : vma_map) {
+        TrackFree(vma);
+    }
 
     // Log initialization.
     LOG_INFO(Kernel_Vmm, "Usable memory address space: {}_GB",
@@ -35,9 +38,36 @@ MemoryManager::MemoryManager() {
 
 MemoryManager::~MemoryManager() = default;
 
+MemoryManager::MapLock::MapLock(MemoryManager& memory_, bool exclusive) : memory{memory_} {
+    if (memory.writer.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+        mode = Mode::Nested;
+    } else if (exclusive) {
+        memory.mutex.lock();
+        memory.writer.store(std::this_thread::get_id(), std::memory_order_relaxed);
+        mode = Mode::Exclusive;
+    } else {
+        memory.mutex.lock_shared();
+        mode = Mode::Shared;
+    }
+}
+
+MemoryManager::MapLock::~MapLock() {
+    switch (mode) {
+    case Mode::Nested:
+        break;
+    case Mode::Shared:
+        memory.mutex.unlock_shared();
+        break;
+    case Mode::Exclusive:
+        memory.writer.store({}, std::memory_order_relaxed);
+        memory.mutex.unlock();
+        break;
+    }
+}
+
 PAddr MemoryManager::Allocate(PAddr search_start, PAddr search_end, size_t size, u64 alignment,
                               int memory_type) {
-    std::scoped_lock lk{mutex};
+    const MapLock lk{*this, true};
 
     auto dmem_area = FindDmemArea(search_start);
 
@@ -61,7 +91,7 @@ PAddr MemoryManager::Allocate(PAddr search_start, PAddr search_end, size_t size,
 }
 
 void MemoryManager::Free(PAddr phys_addr, size_t size) {
-    std::scoped_lock lk{mutex};
+    const MapLock lk{*this, true};
 
     auto dmem_area = CarveDmemArea(phys_addr, size);
     ASSERT(dmem_area != dmem_map.end() && dmem_area->second.size >= size);
@@ -81,7 +111,7 @@ void MemoryManager::Free(PAddr phys_addr, size_t size) {
         }
     }
     for (const auto& [addr, size] : remove_list) {
-        UnmapMemory(addr, size);
+        UnmapMemoryImpl(addr, size);
     }
 
     // Mark region as free and attempt to coalesce it with neighbours.
@@ -93,7 +123,7 @@ void MemoryManager::Free(PAddr phys_addr, size_t size) {
 
 int MemoryManager::Reserve(void** out_addr, VAddr virtual_addr, size_t size, MemoryMapFlags flags,
                            u64 alignment) {
-    std::scoped_lock lk{mutex};
+    const MapLock lk{*this, true};
 
     virtual_addr = (virtual_addr == 0) ? impl.SystemManagedVirtualBase() : virtual_addr;
     alignment = alignment > 0 ? alignment : 16_KB;
@@ -104,7 +134,7 @@ int MemoryManager::Reserve(void** out_addr, VAddr virtual_addr, size_t size, Mem
         const auto& vma = FindVMA(mapped_addr)->second;
         // If the VMA is mapped, unmap the region first.
         if (vma.IsMapped()) {
-            UnmapMemory(mapped_addr, size);
+            UnmapMemoryImpl(mapped_addr, size);
         }
         const size_t remaining_size = vma.base + vma.size - mapped_addr;
         ASSERT_MSG(vma.type == VMAType::Free && remaining_size >= size);
@@ -112,7 +142,11 @@ int MemoryManager::Reserve(void** out_addr, VAddr virtual_addr, size_t size, Mem
 
     // Find the first free area starting with provided virtual address.
     if (False(flags & MemoryMapFlags::Fixed)) {
-        mapped_addr = SearchFree(mapped_addr, size, alignment);
+        const auto free_addr = SearchFree(mapped_addr, size, alignment);
+        if (!free_addr) {
+            return SCE_KERNEL_ERROR_ENOMEM;
+        }
+        mapped_addr = *free_addr;
     }
 
     // Add virtual memory area
@@ -131,7 +165,7 @@ int MemoryManager::Reserve(void** out_addr, VAddr virtual_addr, size_t size, Mem
 int MemoryManager::MapMemory(void** out_addr, VAddr virtual_addr, size_t size, MemoryProt prot,
                              MemoryMapFlags flags, VMAType type, std::string_view name,
                              bool is_exec, PAddr phys_addr, u64 alignment) {
-    std::scoped_lock lk{mutex};
+    const MapLock lk{*this, true};
 
     // Certain games perform flexible mappings on loop to determine
     // the available flexible memory size. Questionable but we need to handle this.
@@ -155,7 +189,11 @@ int MemoryManager::MapMemory(void** out_addr, VAddr virtual_addr, size_t size, M
 
     // Find the first free area starting with provided virtual address.
     if (False(flags & MemoryMapFlags::Fixed)) {
-        mapped_addr = SearchFree(mapped_addr, size, alignment);
+        const auto free_addr = SearchFree(mapped_addr, size, alignment);
+        if (!free_addr) {
+            return SCE_KERNEL_ERROR_ENOMEM;
+        }
+        mapped_addr = *free_addr;
     }
 
     // Perform the mapping.
@@ -171,7 +209,9 @@ int MemoryManager::MapMemory(void** out_addr, VAddr virtual_addr, size_t size, M
 
     if (type == VMAType::Direct) {
         new_vma.phys_base = phys_addr;
-        rasterizer->MapMemory(mapped_addr, size);
+        if (rasterizer) {
+            rasterizer->MapMemory(mapped_addr, size);
+        }
     }
     if (type == VMAType::Flexible) {
         flexible_usage += size;
@@ -182,12 +222,18 @@ int MemoryManager::MapMemory(void** out_addr, VAddr virtual_addr, size_t size, M
 
 int MemoryManager::MapFile(void** out_addr, VAddr virtual_addr, size_t size, MemoryProt prot,
                            MemoryMapFlags flags, uintptr_t fd, size_t offset) {
+    const MapLock lk{*this, true};
+
     VAddr mapped_addr = (virtual_addr == 0) ? impl.SystemManagedVirtualBase() : virtual_addr;
     const size_t size_aligned = Common::AlignUp(size, 16_KB);
 
     // Find first free area to map the file.
     if (False(flags & MemoryMapFlags::Fixed)) {
-        mapped_addr = SearchFree(mapped_addr, size_aligned, 1);
+        const auto free_addr = SearchFree(mapped_addr, size_aligned, 1);
+        if (!free_addr) {
+            return SCE_KERNEL_ERROR_ENOMEM;
+        }
+        mapped_addr = *free_addr;
     }
 
     if (True(flags & MemoryMapFlags::Fixed)) {
@@ -212,8 +258,11 @@ int MemoryManager::MapFile(void** out_addr, VAddr virtual_addr, size_t size, Mem
 }
 
 void MemoryManager::UnmapMemory(VAddr virtual_addr, size_t size) {
-    std::scoped_lock lk{mutex};
+    const MapLock lk{*this, true};
+    UnmapMemoryImpl(virtual_addr, size);
+}
 
+void MemoryManager::UnmapMemoryImpl(VAddr virtual_addr, size_t size) {
     const auto it = FindVMA(virtual_addr);
     const auto& vma_base = it->second;
     ASSERT_MSG(vma_base.Contains(virtual_addr, size),
@@ -226,7 +275,7 @@ void MemoryManager::UnmapMemory(VAddr virtual_addr, size_t size) {
     const auto start_in_vma = virtual_addr - vma_base_addr;
     const auto type = vma_base.type;
     const bool has_backing = type == VMAType::Direct || type == VMAType::File;
-    if (type == VMAType::Direct) {
+    if (type == VMAType::Direct && rasterizer) {
         rasterizer->UnmapMemory(virtual_addr, size);
     }
     if (type == VMAType::Flexible) {
@@ -251,7 +300,7 @@ void MemoryManager::UnmapMemory(VAddr virtual_addr, size_t size) {
 }
 
 int MemoryManager::QueryProtection(VAddr addr, void** start, void** end, u32* prot) {
-    std::scoped_lock lk{mutex};
+    const MapLock lk{*this, false};
 
     const auto it = FindVMA(addr);
     const auto& vma = it->second;
@@ -271,7 +320,7 @@ int MemoryManager::QueryProtection(VAddr addr, void** start, void** end, u32* pr
 
 int MemoryManager::VirtualQuery(VAddr addr, int flags,
                                 ::Libraries::Kernel::OrbisVirtualQueryInfo* info) {
-    std::scoped_lock lk{mutex};
+    const MapLock lk{*this, false};
 
     auto it = FindVMA(addr);
     if (it->second.type == VMAType::Free && flags == 1) {
@@ -301,7 +350,7 @@ int MemoryManager::VirtualQuery(VAddr addr, int flags,
 
 int MemoryManager::DirectMemoryQuery(PAddr addr, bool find_next,
                                      ::Libraries::Kernel::OrbisQueryInfo* out_info) {
-    std::scoped_lock lk{mutex};
+    const MapLock lk{*this, false};
 
     auto dmem_area = FindDmemArea(addr);
     while (dmem_area != dmem_map.end() && dmem_area->second.is_free && find_next) {
@@ -322,7 +371,7 @@ int MemoryManager::DirectMemoryQuery(PAddr addr, bool find_next,
 
 int MemoryManager::DirectQueryAvailable(PAddr search_start, PAddr search_end, size_t alignment,
                                         PAddr* phys_addr_out, size_t* size_out) {
-    std::scoped_lock lk{mutex};
+    const MapLock lk{*this, false};
 
     auto dmem_area = FindDmemArea(search_start);
     PAddr paddr{};
@@ -341,13 +390,32 @@ int MemoryManager::DirectQueryAvailable(PAddr search_start, PAddr search_end, si
 }
 
 void MemoryManager::NameVirtualRange(VAddr virtual_addr, size_t size, std::string_view name) {
+    const MapLock lk{*this, true};
+
     auto it = FindVMA(virtual_addr);
 
     ASSERT_MSG(it->second.Contains(virtual_addr, size),
                "Range provided is not fully containted in vma");
     it->second.name = name;
 }
-VAddr MemoryManager::SearchFree(VAddr virtual_addr, size_t size, u32 alignment) {
+
+void MemoryManager::ForEachGpuMapping(const std::function<void(VAddr, size_t, VMAType)>& func) {
+    const MapLock lk{*this, false};
+
+    static constexpr u32 GpuAccess =
+        static_cast<u32>(MemoryProt::GpuRead) | static_cast<u32>(MemoryProt::GpuWrite);
+    for (const auto& [base, vma] : vma_map) {
+        const bool is_gpu_mapped =
+            vma.type == VMAType::Direct ||
+            ((vma.type == VMAType::Flexible || vma.type == VMAType::Pooled) &&
+             (static_cast<u32>(vma.prot) & GpuAccess) != 0);
+        if (is_gpu_mapped) {
+            func(base, vma.size, vma.type);
+        }
+    }
+}
+
+std::optional<VAddr> MemoryManager::SearchFree(VAddr virtual_addr, size_t size, u32 alignment) {
     // If the requested address is below the mapped range, start search from the lowest address
     auto min_search_address = impl.SystemManagedVirtualBase();
     if (virtual_addr < min_search_address) {
@@ -361,24 +429,37 @@ VAddr MemoryManager::SearchFree(VAddr virtual_addr, size_t size, u32 alignment)
     if (it->second.IsFree() && it->second.Contains(virtual_addr, size)) {
         return virtual_addr;
     }
-    // Search for the first free VMA that fits our mapping.
-    const auto is_suitable = [&] {
-        if (!it->second.IsFree()) {
-            return false;
+
+    // Mappings stay inside the address space region the search started in.
+    VAddr region_end = impl.UserVirtualBase() + impl.UserVirtualSize();
+    for (const auto& [region_base, region_size] :
+         {std::pair{impl.SystemManagedVirtualBase(), impl.SystemManagedVirtualSize()},
+          std::pair{impl.SystemReservedVirtualBase(), impl.SystemReservedVirtualSize()}}) {
+        if (virtual_addr >= region_base && virtual_addr < region_base + region_size) {
+            region_end = region_base + region_size;
         }
-        const auto& vma = it->second;
-        virtual_addr = Common::AlignUp(vma.base, alignment);
+    }
+
+    // First fit, walk the free VMAs in address order starting with the one holding the
+    // requested address, skipping over everything that is mapped.
+    auto free_it = free_index.upper_bound(virtual_addr);
+    if (free_it != free_index.begin()) {
+        const auto prev_it = std::prev(free_it);
+        if (prev_it->first + prev_it->second > virtual_addr) {
+            free_it = prev_it;
+        }
+    }
+    for (; free_it != free_index.end() && free_it->first < region_end; ++free_it) {
+        const auto [free_base, free_size] = *free_it;
+        const VAddr free_end = std::min(free_base + free_size, region_end);
+        const VAddr mapped_addr = Common::AlignUp(std::max(free_base, virtual_addr), alignment);
         // Sometimes the alignment itself might be larger than the VMA.
-        if (virtual_addr > vma.base + vma.size) {
-            return false;
+        if (mapped_addr < free_end && free_end - mapped_addr >= size) {
+            return mapped_addr;
         }
-        const size_t remaining_size = vma.base + vma.size - virtual_addr;
-        return remaining_size >= size;
-    };
-    while (!is_suitable()) {
-        it++;
     }
-    return virtual_addr;
+    LOG_ERROR(Kernel_Vmm, "Unable to find free virtual area of size {:#x}", size);
+    return std::nullopt;
 }
 
 MemoryManager::VMAHandle MemoryManager::CarveVMA(VAddr virtual_addr, size_t size) {
@@ -401,6 +482,7 @@ MemoryManager::VMAHandle MemoryManager::CarveVMA(VAddr virtual_addr, size_t size
         vma_handle = Split(vma_handle, start_in_vma);
     }
 
+    UntrackFree(vma_handle->second);
     return vma_handle;
 }
 
@@ -431,6 +513,7 @@ MemoryManager::VMAHandle MemoryManager::Split(VMAHandle vma_handle, size_t offse
     auto& old_vma = vma_handle->second;
     ASSERT(offset_in_vma < old_vma.size && offset_in_vma > 0);
 
+    UntrackFree(old_vma);
     auto new_vma = old_vma;
     old_vma.size = offset_in_vma;
     new_vma.base += offset_in_vma;
@@ -439,6 +522,8 @@ MemoryManager::VMAHandle MemoryManager::Split(VMAHandle vma_handle, size_t offse
     if (new_vma.type == VMAType::Direct) {
         new_vma.phys_base += offset_in_vma;
     }
+    TrackFree(old_vma);
+    TrackFree(new_vma);
     return vma_map.emplace_hint(std::next(vma_handle), new_vma.base, new_vma);
 }
 
@@ -456,7 +541,7 @@ MemoryManager::DMemHandle MemoryManager::Split(DMemHandle dmem_handle, size_t of
 
 int MemoryManager::GetDirectMemoryType(PAddr addr, int* directMemoryTypeOut,
                                        void** directMemoryStartOut, void** directMemoryEndOut) {
-    std::scoped_lock lk{mutex};
+    const MapLock lk{*this, false};
 
     auto dmem_area = FindDmemArea(addr);
 
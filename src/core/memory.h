@@ -3,9 +3,13 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
 #include <map>
-#include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <string_view>
+#include <thread>
 #include "common/enum.h"
 #include "common/singleton.h"
 #include "common/types.h"
@@ -123,9 +127,31 @@ class MemoryManager {
     using VMAHandle = VMAMap::iterator;
 
 public:
+    /// Lock over the memory maps. Queries share it, while modifications hold it exclusively and
+    /// may nest on the thread that holds it, so several operations can run under one lock.
+    class [[nodiscard]] MapLock {
+    public:
+        explicit MapLock(MemoryManager& memory, bool exclusive);
+        ~MapLock();
+
+        MapLock(const MapLock&) = delete;
+        MapLock& operator=(const MapLock&) = delete;
+
+    private:
+        enum class Mode : u32 { Nested, Shared, Exclusive };
+
+        MemoryManager& memory;
+        Mode mode;
+    };
+
     explicit MemoryManager();
     ~MemoryManager();
 
+    /// Holds the memory maps exclusively until the returned lock is destroyed.
+    MapLock LockExclusive() {
+        return MapLock{*this, true};
+    }
+
     void SetRasterizer(Vulkan::Rasterizer* rasterizer_) {
         rasterizer = rasterizer_;
     }
@@ -173,6 +199,10 @@ public:
 
     void NameVirtualRange(VAddr virtual_addr, size_t size, std::string_view name);
 
+    /// Calls func with the base, size and type of every mapping the GPU can access, while
+    /// holding the memory maps shared.
+    void ForEachGpuMapping(const std::function<void(VAddr, size_t, VMAType)>& func);
+
 private:
     VMAHandle FindVMA(VAddr target) {
         return std::prev(vma_map.upper_bound(target));
@@ -182,10 +212,27 @@ private:
         return std::prev(dmem_map.upper_bound(target));
     }
 
+    void TrackFree(const VirtualMemoryArea& vma) {
+        if (vma.IsFree()) {
+            free_index.emplace(vma.base, vma.size);
+        }
+    }
+
+    void UntrackFree(const VirtualMemoryArea& vma) {
+        if (vma.IsFree()) {
+            free_index.erase(vma.base);
+        }
+    }
+
     template <typename Handle>
     Handle MergeAdjacent(auto& handle_map, Handle iter) {
+        static constexpr bool IsVMA = std::is_same_v<Handle, VMAHandle>;
         const auto next_vma = std::next(iter);
         if (next_vma != handle_map.end() && iter->second.CanMergeWith(next_vma->second)) {
+            if constexpr (IsVMA) {
+                UntrackFree(iter->second);
+                UntrackFree(next_vma->second);
+            }
             iter->second.size += next_vma->second.size;
             handle_map.erase(next_vma);
         }
@@ -193,19 +240,31 @@ private:
         if (iter != handle_map.begin()) {
             auto prev_vma = std::prev(iter);
             if (prev_vma->second.CanMergeWith(iter->second)) {
+                if constexpr (IsVMA) {
+                    UntrackFree(prev_vma->second);
+                    UntrackFree(iter->second);
+                }
                 prev_vma->second.size += iter->second.size;
                 handle_map.erase(iter);
                 iter = prev_vma;
             }
         }
 
+        if constexpr (IsVMA) {
+            TrackFree(iter->second);
+        }
         return iter;
     }
 
-    VAddr SearchFree(VAddr virtual_addr, size_t size, u32 alignment = 0);
+    /// Returns the first free address at or past virtual_addr that fits the mapping, if any.
+    std::optional<VAddr> SearchFree(VAddr virtual_addr, size_t size, u32 alignment = 0);
 
+    /// Splits off the area at the given range. The returned area is left out of the free index,
+    /// callers that keep it free have to merge it back.
     VMAHandle CarveVMA(VAddr virtual_addr, size_t size);
 
+    void UnmapMemoryImpl(VAddr virtual_addr, size_t size);
+
     DMemHandle CarveDmemArea(PAddr addr, size_t size);
 
     VMAHandle Split(VMAHandle vma_handle, size_t offset_in_vma);
@@ -216,7 +275,9 @@ private:
     AddressSpace impl;
     DMemMap dmem_map;
     VMAMap vma_map;
-    std::recursive_mutex mutex;
+    std::map<VAddr, size_t> free_index; ///< Base and size of the free VMAs, by address.
+    std::shared_mutex mutex;
+    std::atomic<std::thread::id> writer{};
     size_t total_flexible_size = 448_MB;
     size_t flexible_usage{};
     Vulkan::Rasterizer* rasterizer{};
@@ -52,9 +52,12 @@ Emulator::Emulator() {
     LOG_INFO(Loader, "Description {}", Common::g_scm_desc);
 
     LOG_INFO(Config, "General isNeo: {}", Config::isNeoMode());
+    LOG_INFO(Config, "General hugePages: {}", Config::hugePages());
+    LOG_INFO(Config, "General prefaultDmem: {}", Config::prefaultDmem());
     LOG_INFO(Config, "GPU isNullGpu: {}", Config::nullGpu());
     LOG_INFO(Config, "GPU shouldDumpShaders: {}", Config::dumpShaders());
     LOG_INFO(Config, "GPU shouldDumpPM4: {}", Config::dumpPM4());
+    LOG_INFO(Config, "GPU pm4CaptureFrames: {}", Config::getPm4CaptureFrames());
     LOG_INFO(Config, "GPU vblankDivider: {}", Config::vblankDiv());
     LOG_INFO(Config, "Vulkan gpuId: {}", Config::getGpuId());
     LOG_INFO(Config, "Vulkan vkValidation: {}", Config::vkValidationEnabled());
@@ -77,16 +80,64 @@ Emulator::~Emulator() {
     Config::save(config_dir / "config.toml");
 }
 
+/// Extracts the files the loader and frontend read from the host out of a package.
+static void ExtractBootFiles(FileSys::PackageFs& package, const std::filesystem::path& dest) {
+    const auto extract = [&](const FileSys::PackageFs::Node& node, const std::string& path) {
+        const auto host_path = dest / path;
+        std::error_code ec;
+        if (std::filesystem::file_size(host_path, ec) == node.size) {
+            return;
+        }
+        std::filesystem::create_directories(host_path.parent_path());
+        if (!package.Extract(node, host_path)) {
+            LOG_ERROR(Loader, "Unable to extract {} from package", path);
+        }
+    };
+
+    static constexpr std::array<std::string_view, 5> BootFiles = {
+        "eboot.bin", "sce_sys/param.sfo", "sce_sys/playgo-chunk.dat", "sce_sys/pic0.png",
+        "sce_sys/pic1.png"};
+    for (const auto path : BootFiles) {
+        if (const auto* node = package.Find(path)) {
+            extract(*node, std::string{path});
+        }
+    }
+    if (const auto* sce_module = package.Find("sce_module")) {
+        for (const u32 child : sce_module->children) {
+            const auto& node = package.GetNode(child);
+            extract(node, "sce_module/" + node.name);
+        }
+    }
+}
+
 void Emulator::Run(const std::filesystem::path& file) {
     // Applications expect to be run from /app0 so mount the file's parent path as app0.
     auto* mnt = Common::Singleton<Core::FileSys::MntPoints>::Instance();
-    mnt->Mount(file.parent_path(), "/app0");
+    auto game_folder = file.parent_path();
+    auto eboot_path = file;
+    if (file.extension() == ".pkg") {
+        // Serve the game straight from the package, only executables and the metadata read
+        // by the emulator itself are extracted to the host up front. Anything else that needs
+        // a host file, like modules loaded at runtime or movies, is extracted on first use.
+        auto package = std::make_shared<FileSys::PackageFs>();
+        if (!package->Open(file)) {
+            LOG_CRITICAL(Loader, "Unable to open package {}", file.string());
+            return;
+        }
+        game_folder = Common::FS::GetUserPath(Common::FS::PathType::PkgCacheDir) /
+                      package->GetTitleID();
+        ExtractBootFiles(*package, game_folder);
+        eboot_path = game_folder / "eboot.bin";
+        mnt->Mount(std::move(package), "/app0", game_folder);
+    } else {
+        mnt->Mount(game_folder, "/app0");
+    }
 
     // Loading param.sfo file if exists
     std::string id;
     std::string title;
     std::string app_version;
-    std::filesystem::path sce_sys_folder = file.parent_path() / "sce_sys";
+    std::filesystem::path sce_sys_folder = game_folder / "sce_sys";
     if (std::filesystem::is_directory(sce_sys_folder)) {
         for (const auto& entry : std::filesystem::directory_iterator(sce_sys_folder)) {
             if (entry.path().filename() == "param.sfo") {
@@ -160,13 +211,13 @@ void Emulator::Run(const std::filesystem::path& file) {
     Libraries::InitHLELibs(&linker->GetHLESymbols());
 
     // Load the module with the linker
-    linker->LoadModule(file);
+    linker->LoadModule(eboot_path);
 
     // check if we have system modules to load
-    LoadSystemModules(file);
+    LoadSystemModules(eboot_path);
 
     // Load all prx from game's sce_module folder
-    std::filesystem::path sce_module_folder = file.parent_path() / "sce_module";
+    std::filesystem::path sce_module_folder = game_folder / "sce_module";
     if (std::filesystem::is_directory(sce_module_folder)) {
         for (const auto& entry : std::filesystem::directory_iterator(sce_module_folder)) {
             LOG_INFO(Loader, "Loading {}", entry.path().string().c_str());
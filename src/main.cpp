@@ -1,14 +1,31 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <charconv>
+#include <cstring>
+#include <string_view>
 #include <fmt/core.h>
 #include "emulator.h"
+#include "pm4_replay.h"
 
 int main(int argc, char* argv[]) {
     if (argc == 1) {
         fmt::print("Usage: {} <elf or eboot.bin path>\n", argv[0]);
+        fmt::print("       {} --replay <capture.pm4cap> [loops]\n", argv[0]);
         return -1;
     }
+    if (std::string_view{argv[1]} == "--replay" && argc > 2) {
+        u32 num_loops = 1;
+        if (argc > 3) {
+            const char* end = argv[3] + std::strlen(argv[3]);
+            const auto [ptr, ec] = std::from_chars(argv[3], end, num_loops);
+            if (ec != std::errc{} || ptr != end || num_loops == 0) {
+                fmt::print("Invalid loop count {}\n", argv[3]);
+                return -1;
+            }
+        }
+        return Core::ReplayPm4Capture(argv[2], num_loops);
+    }
 
     Core::Emulator emulator;
     emulator.Run(argv[1]);
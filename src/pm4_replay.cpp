@@ -0,0 +1,220 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <optional>
+#include <set>
+#include <fmt/core.h>
+
+#include "common/config.h"
+#include "common/logging/backend.h"
+#include "common/logging/log.h"
+#include "common/path_util.h"
+#include "common/singleton.h"
+#include "core/libraries/error_codes.h"
+#include "core/libraries/kernel/memory_management.h"
+#include "core/memory.h"
+#include "input/controller.h"
+#include "pm4_replay.h"
+#include "sdl_window.h"
+#include "video_core/amdgpu/liverpool.h"
+#include "video_core/amdgpu/pm4_capture.h"
+#include "video_core/renderer_vulkan/renderer_vulkan.h"
+#include "video_core/renderer_vulkan/vk_null_rasterizer.h"
+
+extern Frontend::WindowSDL* g_window;
+extern std::unique_ptr<Vulkan::RendererVulkan> renderer;
+extern std::unique_ptr<Vulkan::NullRasterizer> null_rasterizer;
+extern std::unique_ptr<AmdGpu::Liverpool> liverpool;
+
+namespace Core {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using AmdGpu::Capture::RecordType;
+
+/// Recreates the GPU mappings of the capture at their original guest addresses.
+class ReplayMemory {
+    static constexpr u64 PageSize = 16_KB;
+
+public:
+    explicit ReplayMemory(MemoryManager* memory_) : memory{memory_} {}
+
+    void Map(VAddr base, u64 size, VMAType type) {
+        VAddr run_base = 0;
+        u64 run_size = 0;
+        for (VAddr page = base; page < base + size; page += PageSize) {
+            if (mapped_pages.insert(page).second) {
+                run_base = run_size ? run_base : page;
+                run_size += PageSize;
+                continue;
+            }
+            MapRun(run_base, run_size, type);
+            run_size = 0;
+        }
+        MapRun(run_base, run_size, type);
+    }
+
+private:
+    void MapRun(VAddr base, u64 size, VMAType type) {
+        if (size == 0) {
+            return;
+        }
+        void* out_addr{};
+        if (type != VMAType::Direct) {
+            // Flexible and pooled memory is not backed by direct memory on the guest either,
+            // giving it some would run out of direct memory on captures that use a lot of it.
+            const int result =
+                memory->MapMemory(&out_addr, base, size, MemoryProt::GpuReadWrite,
+                                  MemoryMapFlags::Fixed, VMAType::Flexible, "PM4Replay");
+            if (result != ORBIS_OK) {
+                LOG_ERROR(Render, "Failed to map {:#x} bytes of flexible memory at {:#x}", size,
+                          base);
+            }
+            return;
+        }
+        const PAddr phys_addr = memory->Allocate(0, SCE_KERNEL_MAIN_DMEM_SIZE, size, PageSize, 0);
+        memory->MapMemory(&out_addr, base, size, MemoryProt::GpuReadWrite, MemoryMapFlags::Fixed,
+                          VMAType::Direct, "PM4Replay", false, phys_addr);
+    }
+
+    MemoryManager* memory;
+    std::set<VAddr> mapped_pages;
+};
+
+/// Blocks until the command processor and the GPU are done with everything submitted.
+void WaitIdle() {
+    liverpool->WaitGpuIdle();
+    if (!renderer) {
+        return;
+    }
+    std::promise<void> finished;
+    liverpool->SendCommand([&finished] {
+        renderer->FinishDraw();
+        finished.set_value();
+    });
+    finished.get_future().wait();
+}
+
+/// Replays a frame and returns the time from each run of submissions to the GPU going idle.
+/// Restoring memory in between is not included.
+Clock::duration ReplayFrame(const AmdGpu::CaptureReader& reader,
+                            const AmdGpu::CaptureReader::Frame& frame,
+                            ReplayMemory& replay_memory) {
+    Clock::duration gpu_time{};
+    std::optional<Clock::time_point> busy_since;
+    const auto submit = [&] {
+        if (!busy_since) {
+            busy_since = Clock::now();
+        }
+    };
+    const auto wait_idle = [&] {
+        if (busy_since) {
+            WaitIdle();
+            gpu_time += Clock::now() - *busy_since;
+            busy_since.reset();
+        }
+    };
+    for (const auto& command : frame.commands) {
+        switch (command.type) {
+        case RecordType::MapMemory:
+        case RecordType::MemoryData:
+            // Memory is restored to the state it had at the next submission, so whatever was
+            // submitted before has to be done with it first.
+            wait_idle();
+            if (command.type == RecordType::MapMemory) {
+                replay_memory.Map(command.address, command.size,
+                                  static_cast<VMAType>(command.map_type));
+            } else {
+                const auto data = reader.GetContents(command.hash);
+                std::memcpy(std::bit_cast<void*>(command.address), data.data(), data.size());
+            }
+            break;
+        case RecordType::SubmitGfx: {
+            const auto& cmds = reader.GetSubmit(command.submit);
+            submit();
+            liverpool->SubmitGfx(cmds.dcb, cmds.ccb);
+            break;
+        }
+        case RecordType::SubmitAsc: {
+            const auto& cmds = reader.GetSubmit(command.submit);
+            submit();
+            liverpool->SubmitAsc(cmds.vqid, cmds.dcb);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    submit();
+    liverpool->SubmitDone();
+    wait_idle();
+    return gpu_time;
+}
+
+} // Anonymous namespace
+
+int ReplayPm4Capture(const std::filesystem::path& capture_path, u32 num_loops) {
+    const auto config_dir = Common::FS::GetUserPath(Common::FS::PathType::UserDir);
+    Config::load(config_dir / "config.toml");
+    Common::Log::Initialize();
+    Common::Log::Start();
+
+    AmdGpu::CaptureReader reader;
+    if (!reader.Open(capture_path)) {
+        fmt::print("Failed to load capture {}\n", capture_path.string());
+        return -1;
+    }
+
+    auto* memory = Memory::Instance();
+    std::unique_ptr<Frontend::WindowSDL> window;
+    liverpool = std::make_unique<AmdGpu::Liverpool>();
+    if (!Config::nullGpu()) {
+        auto* controller = Common::Singleton<Input::GameController>::Instance();
+        window = std::make_unique<Frontend::WindowSDL>(
+            Config::getScreenWidth(), Config::getScreenHeight(), controller, "shadPS4 PM4 replay");
+        g_window = window.get();
+        renderer = std::make_unique<Vulkan::RendererVulkan>(*g_window, liverpool.get());
+    } else {
+        null_rasterizer = std::make_unique<Vulkan::NullRasterizer>(liverpool.get());
+    }
+
+    const auto frames = reader.GetFrames();
+    ReplayMemory replay_memory{memory};
+    std::vector<std::vector<u64>> frame_times(frames.size());
+    for (u32 loop = 0; loop < num_loops; ++loop) {
+        for (size_t i = 0; i < frames.size(); ++i) {
+            const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                ReplayFrame(reader, frames[i], replay_memory));
+            frame_times[i].push_back(elapsed.count());
+        }
+    }
+
+    fmt::print("{:>6} {:>12} {:>12} {:>12}\n", "frame", "avg us", "min us", "max us");
+    u64 total_us = 0;
+    for (size_t i = 0; i < frame_times.size(); ++i) {
+        const auto& times = frame_times[i];
+        u64 sum = 0;
+        for (const u64 time : times) {
+            sum += time;
+        }
+        total_us += sum;
+        const auto [min, max] = std::ranges::minmax(times);
+        fmt::print("{:>6} {:>12} {:>12} {:>12}\n", i, sum / times.size(), min, max);
+    }
+    const u64 num_frames = frames.size() * num_loops;
+    fmt::print("{} frames in {} loops, avg {} us/frame\n", num_frames, num_loops,
+               total_us / num_frames);
+
+    renderer.reset();
+    null_rasterizer.reset();
+    liverpool.reset();
+    return 0;
+}
+
+} // namespace Core
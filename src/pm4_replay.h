@@ -0,0 +1,19 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <filesystem>
+#include "common/types.h"
+
+namespace Core {
+
+/**
+ * Replays a capture written with dumpPM4 and pm4CaptureFrames set, without booting the game.
+ * The captured frames are pushed through the command processor and the Vulkan rasterizer, or the
+ * null rasterizer when nullGpu is set, num_loops times. The time of each frame is printed at the
+ * end.
+ */
+int ReplayPm4Capture(const std::filesystem::path& capture_path, u32 num_loops);
+
+} // namespace Core
@@ -166,11 +166,12 @@ EmitContext::SpirvAttribute EmitContext::GetAttributeInfo(AmdGpu::NumberFormat f
 }
 
 void EmitContext::DefineBufferOffsets() {
-    for (auto& buffer : buffers) {
-        const u32 binding = buffer.binding;
-        const u32 half = Shader::PushData::BufOffsetIndex + (binding >> 4);
-        const u32 comp = (binding & 0xf) >> 2;
-        const u32 offset = (binding & 0x3) << 3;
+    for (u32 i = 0; i < buffers.size(); ++i) {
+        auto& buffer = buffers[i];
+        const u32 slot = Shader::PushData::BufOffsetSlot(stage, i);
+        const u32 half = Shader::PushData::BufOffsetIndex + (slot >> 4);
+        const u32 comp = (slot & 0xf) >> 2;
+        const u32 offset = (slot & 0x3) << 3;
         const Id ptr{OpAccessChain(TypePointer(spv::StorageClass::PushConstant, U32[1]),
                                    push_data_block, ConstU32(half), ConstU32(comp))};
         const Id value{OpLoad(U32[1], ptr)};
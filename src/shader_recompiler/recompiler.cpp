@@ -1,11 +1,14 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <chrono>
+#include "common/logging/backend.h"
 #include "shader_recompiler/frontend/control_flow_graph.h"
 #include "shader_recompiler/frontend/decode.h"
 #include "shader_recompiler/frontend/structured_control_flow.h"
 #include "shader_recompiler/ir/passes/ir_passes.h"
 #include "shader_recompiler/ir/post_order.h"
+#include "shader_recompiler/recompiler.h"
 
 namespace Shader {
 
@@ -27,44 +30,73 @@ IR::BlockList GenerateBlocks(const IR::AbstractSyntaxList& syntax_list) {
     return blocks;
 }
 
-IR::Program TranslateProgram(Common::ObjectPool<IR::Inst>& inst_pool,
-                             Common::ObjectPool<IR::Block>& block_pool, std::span<const u32> token,
+IR::Program TranslateProgram(Pools& pools, PassTimes& times, std::span<const u32> token,
                              const Info&& info, const Profile& profile) {
     // Ensure first instruction is expected.
     constexpr u32 token_mov_vcchi = 0xBEEB03FF;
     ASSERT_MSG(token[0] == token_mov_vcchi, "First instruction is not s_mov_b32 vcc_hi, #imm");
 
+    // The IR of the previous program is no longer needed, reuse its storage.
+    pools.ReleaseContents();
+
+    using Clock = std::chrono::steady_clock;
+    const bool timed = times.IsEnabled();
+    auto last = timed ? Clock::now() : Clock::time_point{};
+    const auto end_pass = [&](TranslatePass pass) {
+        if (!timed) {
+            return;
+        }
+        const auto now = Clock::now();
+        times.Add(pass, std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count());
+        last = now;
+    };
+
     Gcn::GcnCodeSlice slice(token.data(), token.data() + token.size());
     Gcn::GcnDecodeContext decoder;
 
     // Decode and save instructions
-    IR::Program program;
-    program.ins_list.reserve(token.size());
+    auto& inst_list = pools.inst_list;
+    inst_list.reserve(token.size());
     while (!slice.atEnd()) {
-        program.ins_list.emplace_back(decoder.decodeInstruction(slice));
+        inst_list.emplace_back(decoder.decodeInstruction(slice));
     }
+    end_pass(TranslatePass::Decode);
 
     // Create control flow graph
-    Common::ObjectPool<Gcn::Block> gcn_block_pool{64};
-    Gcn::CFG cfg{gcn_block_pool, program.ins_list};
+    Gcn::CFG cfg{pools.gcn_block_pool, inst_list};
+    end_pass(TranslatePass::BuildCfg);
 
     // Structurize control flow graph and create program.
+    IR::Program program;
     program.info = std::move(info);
-    program.syntax_list = Shader::Gcn::BuildASL(inst_pool, block_pool, cfg, program.info, profile);
+    program.syntax_list =
+        Shader::Gcn::BuildASL(pools.inst_pool, pools.block_pool, cfg, program.info, profile);
     program.blocks = GenerateBlocks(program.syntax_list);
     program.post_order_blocks = Shader::IR::PostOrder(program.syntax_list.front());
+    end_pass(TranslatePass::Structurize);
 
     // Run optimization passes
     Shader::Optimization::SsaRewritePass(program.post_order_blocks);
+    end_pass(TranslatePass::SsaRewrite);
     Shader::Optimization::ResourceTrackingPass(program);
+    end_pass(TranslatePass::ResourceTracking);
     Shader::Optimization::ConstantPropagationPass(program.post_order_blocks);
+    end_pass(TranslatePass::ConstantPropagation);
     if (program.info.stage != Stage::Compute) {
         Shader::Optimization::LowerSharedMemToRegisters(program);
+        end_pass(TranslatePass::LowerSharedMem);
     }
     Shader::Optimization::IdentityRemovalPass(program.blocks);
+    end_pass(TranslatePass::IdentityRemoval);
     Shader::Optimization::DeadCodeEliminationPass(program);
+    end_pass(TranslatePass::DeadCodeElimination);
     Shader::Optimization::CollectShaderInfoPass(program);
-    LOG_DEBUG(Render_Vulkan, "{}", Shader::IR::DumpProgram(program));
+    end_pass(TranslatePass::CollectShaderInfo);
+
+    // Dumping walks and formats every instruction, only do it when it will be printed.
+    if (Common::Log::IsLogged(Common::Log::Class::Render_Vulkan, Common::Log::Level::Debug)) {
+        LOG_DEBUG(Render_Vulkan, "{}", Shader::IR::DumpProgram(program));
+    }
 
     return program;
 }
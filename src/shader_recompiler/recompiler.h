@@ -3,7 +3,10 @@
 
 #pragma once
 
+#include <vector>
 #include "common/object_pool.h"
+#include "common/perf_stats.h"
+#include "shader_recompiler/frontend/control_flow_graph.h"
 #include "shader_recompiler/ir/basic_block.h"
 #include "shader_recompiler/ir/program.h"
 
@@ -11,8 +14,45 @@ namespace Shader {
 
 struct Profile;
 
-[[nodiscard]] IR::Program TranslateProgram(Common::ObjectPool<IR::Inst>& inst_pool,
-                                           Common::ObjectPool<IR::Block>& block_pool,
+/**
+ * Storage reused by every translation. The IR of a program lives in these pools until the
+ * next program is translated, so contents are released in bulk instead of freeing each
+ * instruction and block on its own.
+ * Phi instructions with more than two incoming blocks still spill their arguments to the heap,
+ * the small_vector holding them sits in a union inside IR::Inst and has no pool to draw from.
+ */
+struct Pools {
+    Common::ObjectPool<IR::Inst> inst_pool{8192};
+    Common::ObjectPool<IR::Block> block_pool{512};
+    Common::ObjectPool<Gcn::Block> gcn_block_pool{64};
+    std::vector<Gcn::GcnInst> inst_list;
+
+    void ReleaseContents() {
+        inst_pool.ReleaseContents();
+        block_pool.ReleaseContents();
+        gcn_block_pool.ReleaseContents();
+        inst_list.clear();
+    }
+};
+
+/// Stages of the translation.
+enum class TranslatePass : u32 {
+    Decode,
+    BuildCfg,
+    Structurize,
+    SsaRewrite,
+    ResourceTracking,
+    ConstantPropagation,
+    LowerSharedMem,
+    IdentityRemoval,
+    DeadCodeElimination,
+    CollectShaderInfo,
+};
+
+/// Nanoseconds spent in each stage, accumulated over every translated program.
+using PassTimes = Common::PerfStats<TranslatePass>;
+
+[[nodiscard]] IR::Program TranslateProgram(Pools& pools, PassTimes& times,
                                            std::span<const u32> code, const Info&& info,
                                            const Profile& profile);
 
@@ -110,14 +110,23 @@ using SamplerResourceList = boost::container::static_vector<SamplerResource, 16>
 
 struct PushData {
     static constexpr size_t BufOffsetIndex = 2;
+    static constexpr u32 MaxStageBuffers = 16; ///< buf_offsets entries of each stage.
 
     u32 step0;
     u32 step1;
-    std::array<u8, 32> buf_offsets;
+    std::array<u8, 2 * MaxStageBuffers> buf_offsets;
+
+    /// Returns the buf_offsets entry of the buffer at an index of the stage resources. It does
+    /// not depend on resource bindings, so shader code stays valid for any binding base.
+    static u32 BufOffsetSlot(Stage stage, u32 buffer_index) {
+        // Past this the fragment stage would alias the entries of the other stages.
+        ASSERT_MSG(buffer_index < MaxStageBuffers, "Too many buffers in stage: {}", buffer_index);
+        return (stage == Stage::Fragment ? MaxStageBuffers : 0) + buffer_index;
+    }
 
-    void AddOffset(u32 binding, u32 offset) {
-        ASSERT(offset < 256 && binding < buf_offsets.size());
-        buf_offsets[binding] = offset;
+    void AddOffset(u32 slot, u32 offset) {
+        ASSERT(offset < 256 && slot < buf_offsets.size());
+        buf_offsets[slot] = offset;
     }
 };
 
@@ -1,14 +1,18 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <algorithm>
+#include <chrono>
 #include "common/assert.h"
 #include "common/debug.h"
+#include "common/logging/log.h"
 #include "common/polyfill_thread.h"
 #include "common/thread.h"
 #include "core/libraries/videoout/driver.h"
 #include "video_core/amdgpu/liverpool.h"
 #include "video_core/amdgpu/pm4_cmds.h"
 #include "video_core/renderdoc.h"
+#include "video_core/renderer_vulkan/vk_null_rasterizer.h"
 #include "video_core/renderer_vulkan/vk_rasterizer.h"
 
 namespace AmdGpu {
@@ -19,6 +23,9 @@ static const char* acb_task_name{"ACB_TASK"};
 
 std::array<u8, 48_KB> Liverpool::ConstantEngine::constants_heap;
 
+// Labels written by the guest CPU cannot be observed, parked queues are polled at this interval.
+static constexpr auto LabelPollInterval = std::chrono::microseconds{100};
+
 Liverpool::Liverpool() {
     process_thread = std::jthread{std::bind_front(&Liverpool::Process, this)};
 }
@@ -28,6 +35,23 @@ Liverpool::~Liverpool() {
     process_thread.join();
 }
 
+void Liverpool::EndFrame() {
+    const u64 draws = frame_stats.draws.exchange(0, std::memory_order_relaxed);
+    const u64 dispatches = frame_stats.dispatches.exchange(0, std::memory_order_relaxed);
+    const u64 submits = frame_stats.submits.exchange(0, std::memory_order_relaxed);
+    const u64 busy_us = frame_stats.busy_us.exchange(0, std::memory_order_relaxed);
+
+    const u64 frame = num_frames.fetch_add(1, std::memory_order_relaxed);
+    LOG_DEBUG(Render, "Frame {}: {} draws, {} dispatches, {} submits, {} us busy", frame, draws,
+              dispatches, submits, busy_us);
+    stats.Add(Counter::Frames);
+    stats.Add(Counter::Draws, draws);
+    stats.Add(Counter::Dispatches, dispatches);
+    stats.Add(Counter::Submits, submits);
+    stats.Add(Counter::BusyUs, busy_us);
+    stats.Max(Counter::MaxFrameBusyUs, busy_us);
+}
+
 void Liverpool::Process(std::stop_token stoken) {
     Common::SetCurrentThreadName("GPU_CommandProcessor");
 
@@ -44,6 +68,9 @@ void Liverpool::Process(std::stop_token stoken) {
         VideoCore::StartCapture();
 
         int qid = -1;
+        bool made_progress = false;
+        u64 wake_seen = wake_count;
+        u32 submits_seen = num_submits;
 
         while (num_submits || num_commands) {
 
@@ -57,12 +84,28 @@ void Liverpool::Process(std::stop_token stoken) {
                     command_queue.pop();
                 }
 
+                const auto start = Clock::now();
                 callback();
+                AddBusyTime(start);
 
                 --num_commands;
+                made_progress = true;
             }
 
             qid = (qid + 1) % NumTotalQueues;
+            if (qid == 0) {
+                // A whole round went by with every queue parked, sleep until that changes. The
+                // labels they wait on may come from fences that were not submitted yet.
+                if (!made_progress) {
+                    if (rasterizer) {
+                        rasterizer->FlushFences();
+                    }
+                    WaitForWork(wake_seen, submits_seen);
+                }
+                made_progress = false;
+                wake_seen = wake_count;
+                submits_seen = num_submits;
+            }
 
             auto& queue = mapped_queues[qid];
 
@@ -74,11 +117,26 @@ void Liverpool::Process(std::stop_token stoken) {
                 }
                 task = queue.submits.front();
             }
+            if (queue.wait_reg_mem) {
+                if (!queue.wait_reg_mem->Test()) {
+                    continue;
+                }
+                queue.wait_reg_mem = nullptr;
+                queue.wait_addr = 0;
+            }
+            made_progress = true;
+            const auto start = Clock::now();
             task.resume();
+            AddBusyTime(start);
 
             if (task.done()) {
                 task.destroy();
 
+                // Fences raised by the command buffer are submitted together once it is done.
+                if (rasterizer) {
+                    rasterizer->FlushFences();
+                }
+
                 std::scoped_lock lock{queue.m_access};
                 queue.submits.pop();
 
@@ -92,7 +150,7 @@ void Liverpool::Process(std::stop_token stoken) {
             VideoCore::EndCapture();
 
             if (rasterizer) {
-                rasterizer->Flush();
+                rasterizer->EndFrame();
             }
             submit_done = false;
         }
@@ -101,6 +159,43 @@ void Liverpool::Process(std::stop_token stoken) {
     }
 }
 
+void Liverpool::AddBusyTime(Clock::time_point start) {
+    const auto elapsed =
+        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+    frame_stats.busy_us.fetch_add(elapsed, std::memory_order_relaxed);
+}
+
+void Liverpool::ParkQueue(u32 qid, const PM4CmdWaitRegMem* wait_reg_mem) {
+    auto& queue = mapped_queues[qid];
+    queue.wait_reg_mem = wait_reg_mem;
+    queue.wait_addr = wait_reg_mem->Address<VAddr>();
+    if (rasterizer) {
+        // The label may only be written by the GPU so far, bring it back for the poll to see.
+        rasterizer->ReadLabel(queue.wait_addr, sizeof(u32));
+    }
+}
+
+void Liverpool::WaitForWork(u64 wake_seen, u32 submits_seen) {
+    std::unique_lock lk{submit_mutex};
+    submit_cv.wait_for(lk, LabelPollInterval, [&] {
+        return num_commands || num_submits != submits_seen || wake_count != wake_seen ||
+               process_thread.get_stop_token().stop_requested();
+    });
+}
+
+void Liverpool::NotifyLabelWrite(VAddr address, u64 size) {
+    const bool is_watched = std::ranges::any_of(mapped_queues, [&](const GpuQueue& queue) {
+        const VAddr wait_addr = queue.wait_addr.load(std::memory_order_relaxed);
+        return wait_addr >= address && wait_addr < address + size;
+    });
+    if (!is_watched) {
+        return;
+    }
+    std::scoped_lock lk{submit_mutex};
+    ++wake_count;
+    submit_cv.notify_all();
+}
+
 Liverpool::Task Liverpool::ProcessCeUpdate(std::span<const u32> ccb) {
     TracyFiberEnter(ccb_task_name);
 
@@ -321,12 +416,15 @@ Liverpool::Task Liverpool::ProcessGraphics(std::span<const u32> dcb, std::span<c
             regs.index_base_address.base_addr_hi.Assign(draw_index->index_base_hi);
             regs.num_indices = draw_index->index_count;
             regs.draw_initiator = draw_index->draw_initiator;
+            ++frame_stats.draws;
             if (rasterizer) {
                 const auto cmd_address = reinterpret_cast<const void*>(header);
                 rasterizer->ScopeMarkerBegin(fmt::format("dcb:{}:DrawIndex2", cmd_address));
                 rasterizer->Breadcrumb(u64(cmd_address));
                 rasterizer->Draw(true);
                 rasterizer->ScopeMarkerEnd();
+            } else if (null_rasterizer) {
+                null_rasterizer->Draw();
             }
             break;
         }
@@ -335,12 +433,15 @@ Liverpool::Task Liverpool::ProcessGraphics(std::span<const u32> dcb, std::span<c
             regs.max_index_size = draw_index_off->max_size;
             regs.num_indices = draw_index_off->index_count;
             regs.draw_initiator = draw_index_off->draw_initiator;
+            ++frame_stats.draws;
             if (rasterizer) {
                 const auto cmd_address = reinterpret_cast<const void*>(header);
                 rasterizer->ScopeMarkerBegin(fmt::format("dcb:{}:DrawIndexOffset2", cmd_address));
                 rasterizer->Breadcrumb(u64(cmd_address));
                 rasterizer->Draw(true, draw_index_off->index_offset);
                 rasterizer->ScopeMarkerEnd();
+            } else if (null_rasterizer) {
+                null_rasterizer->Draw();
             }
             break;
         }
@@ -348,12 +449,15 @@ Liverpool::Task Liverpool::ProcessGraphics(std::span<const u32> dcb, std::span<c
             const auto* draw_index = reinterpret_cast<const PM4CmdDrawIndexAuto*>(header);
             regs.num_indices = draw_index->index_count;
             regs.draw_initiator = draw_index->draw_initiator;
+            ++frame_stats.draws;
             if (rasterizer) {
                 const auto cmd_address = reinterpret_cast<const void*>(header);
                 rasterizer->ScopeMarkerBegin(fmt::format("dcb:{}:DrawIndexAuto", cmd_address));
                 rasterizer->Breadcrumb(u64(cmd_address));
                 rasterizer->Draw(false);
                 rasterizer->ScopeMarkerEnd();
+            } else if (null_rasterizer) {
+                null_rasterizer->Draw();
             }
             break;
         }
@@ -363,12 +467,17 @@ Liverpool::Task Liverpool::ProcessGraphics(std::span<const u32> dcb, std::span<c
             regs.cs_program.dim_y = dispatch_direct->dim_y;
             regs.cs_program.dim_z = dispatch_direct->dim_z;
             regs.cs_program.dispatch_initiator = dispatch_direct->dispatch_initiator;
+            if (regs.cs_program.dispatch_initiator & 1) {
+                ++frame_stats.dispatches;
+            }
             if (rasterizer && (regs.cs_program.dispatch_initiator & 1)) {
                 const auto cmd_address = reinterpret_cast<const void*>(header);
                 rasterizer->ScopeMarkerBegin(fmt::format("dcb:{}:Dispatch", cmd_address));
                 rasterizer->Breadcrumb(u64(cmd_address));
                 rasterizer->DispatchDirect();
                 rasterizer->ScopeMarkerEnd();
+            } else if (null_rasterizer && (regs.cs_program.dispatch_initiator & 1)) {
+                null_rasterizer->DispatchDirect();
             }
             break;
         }
@@ -394,28 +503,38 @@ Liverpool::Task Liverpool::ProcessGraphics(std::span<const u32> dcb, std::span<c
         }
         case PM4ItOpcode::EventWriteEos: {
             const auto* event_eos = reinterpret_cast<const PM4CmdEventWriteEos*>(header);
-            event_eos->SignalFence();
+            if (rasterizer) {
+                // The label is written once the GPU has executed everything recorded before it,
+                // the packet is copied as the command buffer may be reused by then.
+                rasterizer->SignalFence([this, eos = *event_eos] {
+                    eos.SignalFence();
+                    NotifyLabelWrite(eos.Address<VAddr>());
+                });
+            } else {
+                event_eos->SignalFence();
+            }
             break;
         }
         case PM4ItOpcode::EventWriteEop: {
             const auto* event_eop = reinterpret_cast<const PM4CmdEventWriteEop*>(header);
-            event_eop->SignalFence();
+            if (rasterizer) {
+                rasterizer->SignalFence([this, eop = *event_eop] {
+                    eop.SignalFence();
+                    NotifyLabelWrite(std::bit_cast<VAddr>(eop.Address<u64>()));
+                });
+            } else {
+                event_eop->SignalFence();
+            }
             break;
         }
         case PM4ItOpcode::DmaData: {
             const auto* dma_data = reinterpret_cast<const PM4DmaData*>(header);
+            ExecuteDmaData(dma_data);
             break;
         }
         case PM4ItOpcode::WriteData: {
             const auto* write_data = reinterpret_cast<const PM4CmdWriteData*>(header);
-            ASSERT(write_data->dst_sel.Value() == 2 || write_data->dst_sel.Value() == 5);
-            const u32 data_size = (header->type3.count.Value() - 2) * 4;
-            u64* address = write_data->Address<u64*>();
-            if (!write_data->wr_one_addr.Value()) {
-                std::memcpy(address, write_data->data, data_size);
-            } else {
-                UNREACHABLE();
-            }
+            ExecuteWriteData(write_data);
             break;
         }
         case PM4ItOpcode::AcquireMem: {
@@ -425,15 +544,8 @@ Liverpool::Task Liverpool::ProcessGraphics(std::span<const u32> dcb, std::span<c
         case PM4ItOpcode::WaitRegMem: {
             const auto* wait_reg_mem = reinterpret_cast<const PM4CmdWaitRegMem*>(header);
             // ASSERT(wait_reg_mem->engine.Value() == PM4CmdWaitRegMem::Engine::Me);
-            // Optimization: VO label waits are special because the emulator
-            // will write to the label when presentation is finished. So if
-            // there are no other submits to yield to we can sleep the thread
-            // instead and allow other tasks to run.
-            const u64* wait_addr = wait_reg_mem->Address<u64*>();
-            if (vo_port->IsVoLabel(wait_addr) && num_submits == 1) {
-                vo_port->WaitVoLabel([&] { return wait_reg_mem->Test(); });
-            }
             while (!wait_reg_mem->Test()) {
+                ParkQueue(GfxQueueId, wait_reg_mem);
                 mapped_queues[GfxQueueId].cs_state = regs.cs_program;
                 TracyFiberLeave;
                 co_yield {};
@@ -516,30 +628,30 @@ Liverpool::Task Liverpool::ProcessCompute(std::span<const u32> acb, int vqid) {
             regs.cs_program.dim_y = dispatch_direct->dim_y;
             regs.cs_program.dim_z = dispatch_direct->dim_z;
             regs.cs_program.dispatch_initiator = dispatch_direct->dispatch_initiator;
+            if (regs.cs_program.dispatch_initiator & 1) {
+                ++frame_stats.dispatches;
+            }
             if (rasterizer && (regs.cs_program.dispatch_initiator & 1)) {
                 const auto cmd_address = reinterpret_cast<const void*>(header);
                 rasterizer->ScopeMarkerBegin(fmt::format("acb[{}]:{}:Dispatch", vqid, cmd_address));
                 rasterizer->Breadcrumb(u64(cmd_address));
                 rasterizer->DispatchDirect();
                 rasterizer->ScopeMarkerEnd();
+            } else if (null_rasterizer && (regs.cs_program.dispatch_initiator & 1)) {
+                null_rasterizer->DispatchDirect();
             }
             break;
         }
         case PM4ItOpcode::WriteData: {
             const auto* write_data = reinterpret_cast<const PM4CmdWriteData*>(header);
-            ASSERT(write_data->dst_sel.Value() == 2 || write_data->dst_sel.Value() == 5);
-            const u32 data_size = (header->type3.count.Value() - 2) * 4;
-            if (!write_data->wr_one_addr.Value()) {
-                std::memcpy(write_data->Address<void*>(), write_data->data, data_size);
-            } else {
-                UNREACHABLE();
-            }
+            ExecuteWriteData(write_data);
             break;
         }
         case PM4ItOpcode::WaitRegMem: {
             const auto* wait_reg_mem = reinterpret_cast<const PM4CmdWaitRegMem*>(header);
             ASSERT(wait_reg_mem->engine.Value() == PM4CmdWaitRegMem::Engine::Me);
             while (!wait_reg_mem->Test()) {
+                ParkQueue(vqid, wait_reg_mem);
                 mapped_queues[vqid].cs_state = regs.cs_program;
                 TracyFiberLeave;
                 co_yield {};
@@ -550,7 +662,14 @@ Liverpool::Task Liverpool::ProcessCompute(std::span<const u32> acb, int vqid) {
         }
         case PM4ItOpcode::ReleaseMem: {
             const auto* release_mem = reinterpret_cast<const PM4CmdReleaseMem*>(header);
-            release_mem->SignalFence(Platform::InterruptId::Compute0RelMem); // <---
+            if (rasterizer) {
+                rasterizer->SignalFence([this, release = *release_mem] {
+                    release.SignalFence(Platform::InterruptId::Compute0RelMem);
+                    NotifyLabelWrite(std::bit_cast<VAddr>(release.Address<u64>()));
+                });
+            } else {
+                release_mem->SignalFence(Platform::InterruptId::Compute0RelMem); // <---
+            }
             break;
         }
         default:
@@ -564,6 +683,81 @@ Liverpool::Task Liverpool::ProcessCompute(std::span<const u32> acb, int vqid) {
     TracyFiberLeave;
 }
 
+void Liverpool::ExecuteDmaData(const PM4DmaData* dma_data) {
+    const u32 num_bytes = dma_data->NumBytes();
+    if (num_bytes == 0) {
+        return;
+    }
+    if (dma_data->sas || dma_data->das) {
+        LOG_WARNING(Render, "Skipping DMA_DATA to or from register space");
+        return;
+    }
+    const auto dst_sel = dma_data->dst_sel.Value();
+    const auto src_sel = dma_data->src_sel.Value();
+    const bool dst_gds = dst_sel == DmaDataDst::Gds;
+    const VAddr dst = dst_gds ? dma_data->dst_addr_lo : dma_data->DstAddress<VAddr>();
+    const bool src_gds = src_sel == DmaDataSrc::Gds;
+    const VAddr src = src_gds ? dma_data->src_addr_lo : dma_data->SrcAddress<VAddr>();
+
+    if (dma_data->saic && !src_gds && src_sel != DmaDataSrc::Data) {
+        // The source does not advance, every destination dword receives the first one. It is
+        // read from guest memory, fixed sources are registers or labels the CPU maintains.
+        u32 value;
+        std::memcpy(&value, std::bit_cast<const void*>(src), sizeof(value));
+        ExecuteDmaFill(dst, dma_data->daic ? sizeof(u32) : num_bytes, value, dst_gds);
+        return;
+    }
+    if (dma_data->saic && src_gds) {
+        LOG_WARNING(Render, "Unsupported DMA_DATA from a fixed GDS address, copying linearly");
+    }
+    if (dma_data->daic) {
+        // The destination does not advance, only the last dword written remains.
+        if (src_sel == DmaDataSrc::Data) {
+            ExecuteDmaFill(dst, sizeof(u32), dma_data->data, dst_gds);
+        } else if (rasterizer) {
+            rasterizer->CopyBuffer(dst, src + num_bytes - sizeof(u32), sizeof(u32), dst_gds,
+                                   src_gds);
+        } else if (!dst_gds && !src_gds) {
+            std::memmove(std::bit_cast<void*>(dst),
+                         std::bit_cast<const void*>(src + num_bytes - sizeof(u32)), sizeof(u32));
+        }
+        return;
+    }
+
+    if (src_sel == DmaDataSrc::Data) {
+        ExecuteDmaFill(dst, num_bytes, dma_data->data, dst_gds);
+        return;
+    }
+
+    if (rasterizer) {
+        rasterizer->CopyBuffer(dst, src, num_bytes, dst_gds, src_gds);
+    } else if (!dst_gds && !src_gds) {
+        std::memmove(std::bit_cast<void*>(dst), std::bit_cast<const void*>(src), num_bytes);
+    }
+}
+
+void Liverpool::ExecuteDmaFill(VAddr dst, u32 num_bytes, u32 value, bool dst_gds) {
+    if (rasterizer) {
+        rasterizer->FillBuffer(dst, num_bytes, value, dst_gds);
+    } else if (!dst_gds) {
+        std::fill_n(std::bit_cast<u32*>(dst), num_bytes / sizeof(u32), value);
+    }
+}
+
+void Liverpool::ExecuteWriteData(const PM4CmdWriteData* write_data) {
+    ASSERT(write_data->dst_sel.Value() == 2 || write_data->dst_sel.Value() == 5);
+    ASSERT_MSG(!write_data->wr_one_addr.Value(), "Single address writes are not supported");
+    const u32 data_size = (write_data->header.count.Value() - 2) * 4;
+    const VAddr address = write_data->Address<VAddr>();
+    if (rasterizer) {
+        // Goes through the buffer cache so writes to GPU resident memory stay ordered with the
+        // draws around them instead of invalidating the cached copy.
+        rasterizer->InlineData(address, write_data->data, data_size, false);
+    } else {
+        std::memcpy(std::bit_cast<void*>(address), write_data->data, data_size);
+    }
+}
+
 void Liverpool::SubmitGfx(std::span<const u32> dcb, std::span<const u32> ccb) {
     auto& queue = mapped_queues[GfxQueueId];
 
@@ -573,6 +767,7 @@ void Liverpool::SubmitGfx(std::span<const u32> dcb, std::span<const u32> ccb) {
         queue.submits.emplace(task.handle);
     }
 
+    frame_stats.submits.fetch_add(1, std::memory_order_relaxed);
     std::scoped_lock lk{submit_mutex};
     ++num_submits;
     submit_cv.notify_one();
@@ -588,6 +783,7 @@ void Liverpool::SubmitAsc(u32 vqid, std::span<const u32> acb) {
         queue.submits.emplace(task.handle);
     }
 
+    frame_stats.submits.fetch_add(1, std::memory_order_relaxed);
     std::scoped_lock lk{submit_mutex};
     ++num_submits;
     submit_cv.notify_one();
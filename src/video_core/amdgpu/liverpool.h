@@ -4,6 +4,8 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <coroutine>
 #include <exception>
@@ -14,6 +16,7 @@
 
 #include "common/assert.h"
 #include "common/bit_field.h"
+#include "common/perf_stats.h"
 #include "common/polyfill_thread.h"
 #include "common/types.h"
 #include "common/unique_function.h"
@@ -22,14 +25,15 @@
 
 namespace Vulkan {
 class Rasterizer;
-}
-
-namespace Libraries::VideoOut {
-struct VideoOutPort;
+class NullRasterizer;
 }
 
 namespace AmdGpu {
 
+struct PM4DmaData;
+struct PM4CmdWriteData;
+struct PM4CmdWaitRegMem;
+
 #define GFX6_3D_REG_INDEX(field_name) (offsetof(AmdGpu::Liverpool::Regs, field_name) / sizeof(u32))
 
 #define CONCAT2(x, y) DO_CONCAT2(x, y)
@@ -1058,14 +1062,15 @@ public:
         return num_submits == 0;
     }
 
-    void SetVoPort(Libraries::VideoOut::VideoOutPort* port) {
-        vo_port = port;
-    }
-
     void BindRasterizer(Vulkan::Rasterizer* rasterizer_) {
         rasterizer = rasterizer_;
     }
 
+    /// Binds the command sink that takes draws and dispatches when running without a GPU.
+    void BindNullRasterizer(Vulkan::NullRasterizer* null_rasterizer_) {
+        null_rasterizer = null_rasterizer_;
+    }
+
     void SendCommand(Common::UniqueFunction<void>&& func) {
         std::scoped_lock lk{submit_mutex};
         command_queue.emplace(std::move(func));
@@ -1073,7 +1078,21 @@ public:
         submit_cv.notify_one();
     }
 
+    /// Returns true when called from the command processor thread.
+    [[nodiscard]] bool IsGpuThread() const noexcept {
+        return std::this_thread::get_id() == process_thread.get_id();
+    }
+
+    /// Wakes the queues parked on a WaitRegMem that polls memory in the written range. Writes
+    /// made by the command processor itself are picked up without a notification.
+    void NotifyLabelWrite(VAddr address, u64 size = sizeof(u64));
+
+    /// Closes the per frame command processor statistics, called on every flip.
+    void EndFrame();
+
 private:
+    using Clock = std::chrono::steady_clock;
+
     struct Task {
         struct promise_type {
             auto get_return_object() {
@@ -1110,12 +1129,27 @@ private:
     Task ProcessCeUpdate(std::span<const u32> ccb);
     Task ProcessCompute(std::span<const u32> acb, int vqid);
 
+    void ExecuteDmaData(const PM4DmaData* dma_data);
+    void ExecuteDmaFill(VAddr dst, u32 num_bytes, u32 value, bool dst_gds);
+    void ExecuteWriteData(const PM4CmdWriteData* write_data);
+
     void Process(std::stop_token stoken);
 
+    /// Parks the queue on a WaitRegMem, it is not resumed until the wait is satisfied.
+    void ParkQueue(u32 qid, const PM4CmdWaitRegMem* wait_reg_mem);
+
+    /// Sleeps until a parked queue may be runnable again or new work arrives.
+    void WaitForWork(u64 wake_seen, u32 submits_seen);
+
+    /// Accounts the CPU time the command processor spent since start to the current frame.
+    void AddBusyTime(Clock::time_point start);
+
     struct GpuQueue {
         std::mutex m_access{};
         std::queue<Task::Handle> submits{};
         ComputeProgram cs_state{};
+        const PM4CmdWaitRegMem* wait_reg_mem{};
+        std::atomic<VAddr> wait_addr{};
     };
     std::array<GpuQueue, NumTotalQueues> mapped_queues{};
 
@@ -1138,14 +1172,33 @@ private:
     } cblock{};
 
     Vulkan::Rasterizer* rasterizer{};
-    Libraries::VideoOut::VideoOutPort* vo_port{};
+    Vulkan::NullRasterizer* null_rasterizer{};
     std::jthread process_thread{};
     std::atomic<u32> num_submits{};
     std::atomic<u32> num_commands{};
     std::atomic<bool> submit_done{};
+    std::atomic<u64> wake_count{};
     std::mutex submit_mutex;
     std::condition_variable_any submit_cv;
     std::queue<Common::UniqueFunction<void>> command_queue{};
+
+    struct FrameStats {
+        std::atomic<u64> draws{};
+        std::atomic<u64> dispatches{};
+        std::atomic<u64> submits{};
+        std::atomic<u64> busy_us{};
+    } frame_stats{};
+    std::atomic<u64> num_frames{};
+
+    enum class Counter : u32 {
+        Frames,
+        Draws,
+        Dispatches,
+        Submits,
+        BusyUs,
+        MaxFrameBusyUs,
+    };
+    Common::PerfStats<Counter> stats{Common::Log::Class::Render, "Command processor"};
 };
 
 static_assert(GFX6_3D_REG_INDEX(ps_program) == 0x2C08);
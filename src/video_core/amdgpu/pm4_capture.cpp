@@ -0,0 +1,313 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <xxhash.h>
+#include <zlib-ng.h>
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "core/memory.h"
+#include "video_core/amdgpu/liverpool.h"
+#include "video_core/amdgpu/pm4_capture.h"
+#include "video_core/page_manager.h"
+
+namespace AmdGpu {
+
+using namespace Capture;
+
+namespace {
+
+template <typename T>
+std::span<const u8> AsBytes(const T& object) {
+    return {reinterpret_cast<const u8*>(&object), sizeof(T)};
+}
+
+template <typename T>
+T ReadBody(std::span<const u8> body) {
+    T object{};
+    std::memcpy(&object, body.data(), std::min(body.size(), sizeof(T)));
+    return object;
+}
+
+bool Decompress(std::span<const u8> in, std::span<u8> out) {
+    size_t out_size = out.size();
+    const int ret = zng_uncompress(out.data(), &out_size, in.data(), in.size());
+    return ret == Z_OK && out_size == out.size();
+}
+
+} // Anonymous namespace
+
+CaptureWriter::CaptureWriter(const std::filesystem::path& path, u32 max_frames_,
+                             Liverpool* liverpool_, VideoCore::PageManager* page_manager_)
+    : file{path, Common::FS::FileAccessMode::Write}, max_frames{max_frames_},
+      liverpool{liverpool_}, page_manager{page_manager_} {
+    if (!file.IsOpen()) {
+        LOG_ERROR(Render, "Failed to create PM4 capture {}", path.string());
+        return;
+    }
+    file.WriteObject(FileHeader{Magic, Version});
+    LOG_INFO(Render, "Capturing {} frames to {}", max_frames, path.string());
+}
+
+void CaptureWriter::SubmitGfx(std::span<const u32> dcb, std::span<const u32> ccb) {
+    std::scoped_lock lk{mutex};
+    if (!IsActive()) {
+        return;
+    }
+    SnapshotMemory();
+    WriteSubmit(RecordType::SubmitGfx, 0, dcb, ccb);
+}
+
+void CaptureWriter::SubmitAsc(u32 vqid, std::span<const u32> acb) {
+    std::scoped_lock lk{mutex};
+    if (!IsActive()) {
+        return;
+    }
+    SnapshotMemory();
+    WriteSubmit(RecordType::SubmitAsc, vqid, acb, {});
+}
+
+void CaptureWriter::EndFrame() {
+    std::scoped_lock lk{mutex};
+    if (!IsActive()) {
+        return;
+    }
+    WriteRecord(RecordType::EndFrame, {});
+    if (++num_frames >= max_frames) {
+        LOG_INFO(Render, "PM4 capture of {} frames finished", num_frames);
+        file.Close();
+    }
+}
+
+void CaptureWriter::SnapshotMemory() {
+    // Memory has to be captured as the GPU finds it when it starts on this submission, so the
+    // previous ones must be done writing to it.
+    liverpool->WaitGpuIdle();
+
+    // Only the list of mappings is taken under the map lock, hashing happens outside of it.
+    gpu_mappings.clear();
+    Core::Memory::Instance()->ForEachGpuMapping(
+        [this](VAddr base, size_t size, Core::VMAType type) {
+            gpu_mappings.push_back({base, size, static_cast<u32>(type), 0});
+        });
+
+    const auto written =
+        page_manager ? page_manager->TakeWrittenRanges() : boost::icl::interval_set<VAddr>{};
+    for (const auto& mapping : gpu_mappings) {
+        // Direct mappings are the ones the page manager is told about on map and unmap.
+        const bool watch =
+            page_manager && mapping.type == static_cast<u32>(Core::VMAType::Direct);
+        const auto [it, is_new] = mappings.try_emplace(mapping.address, mapping);
+        if (is_new || it->second.size != mapping.size || it->second.type != mapping.type) {
+            it->second = mapping;
+            WriteRecord(RecordType::MapMemory, AsBytes(mapping));
+            WriteChunks(mapping, watch);
+        } else if (watch) {
+            SnapshotWrittenChunks(mapping, written);
+        } else {
+            WriteChunks(mapping, false);
+        }
+    }
+}
+
+void CaptureWriter::SnapshotWrittenChunks(const MapRecord& mapping,
+                                          const boost::icl::interval_set<VAddr>& written) {
+    const VAddr end = mapping.address + mapping.size;
+    using Interval = boost::icl::interval_set<VAddr>::interval_type;
+    const auto range = written & Interval::right_open(mapping.address, end);
+    VAddr next_chunk = mapping.address;
+    for (const auto& interval : range) {
+        const VAddr first = boost::icl::first(interval);
+        VAddr chunk = mapping.address + (first - mapping.address) / ChunkSize * ChunkSize;
+        for (chunk = std::max(chunk, next_chunk); chunk < boost::icl::last_next(interval);
+             chunk += ChunkSize) {
+            WriteChunk(chunk, std::min<size_t>(ChunkSize, end - chunk), true);
+        }
+        next_chunk = chunk;
+    }
+}
+
+void CaptureWriter::WriteChunks(const MapRecord& mapping, bool watch) {
+    const VAddr end = mapping.address + mapping.size;
+    for (VAddr address = mapping.address; address < end; address += ChunkSize) {
+        WriteChunk(address, std::min<size_t>(ChunkSize, end - address), watch);
+    }
+}
+
+void CaptureWriter::WriteChunk(VAddr address, size_t size, bool watch) {
+    if (watch) {
+        // Protect before hashing, a write racing with the hash then still marks the chunk.
+        page_manager->WatchWrites(address, size);
+    }
+    const auto* data = std::bit_cast<const u8*>(address);
+    const u64 hash = XXH3_64bits(data, size);
+    const auto [it, is_new] = chunk_hashes.try_emplace(address, hash);
+    if (!is_new) {
+        if (it->second == hash) {
+            return;
+        }
+        it.value() = hash;
+    }
+
+    MemoryRecord record{
+        .address = address,
+        .hash = hash,
+        .size = static_cast<u32>(size),
+        .compressed_size = 0,
+    };
+    if (!stored_contents.insert(hash).second) {
+        stats.Add(Counter::ChunksDeduplicated);
+        WriteRecord(RecordType::MemoryRef, AsBytes(record));
+        return;
+    }
+    const auto compressed = Compress({data, size});
+    record.compressed_size = static_cast<u32>(compressed.size());
+    WriteRecord(RecordType::MemoryData, AsBytes(record), compressed);
+    stats.Add(Counter::ChunksWritten);
+    stats.Add(Counter::BytesRaw, size);
+}
+
+void CaptureWriter::WriteSubmit(RecordType type, u32 vqid, std::span<const u32> dcb,
+                                std::span<const u32> ccb) {
+    std::vector<u32> dwords(dcb.size() + ccb.size());
+    std::ranges::copy(dcb, dwords.begin());
+    std::ranges::copy(ccb, dwords.begin() + dcb.size());
+    const auto compressed = Compress(
+        {reinterpret_cast<const u8*>(dwords.data()), dwords.size() * sizeof(u32)});
+
+    const SubmitRecord record{
+        .vqid = vqid,
+        .dcb_dwords = static_cast<u32>(dcb.size()),
+        .ccb_dwords = static_cast<u32>(ccb.size()),
+        .compressed_size = static_cast<u32>(compressed.size()),
+    };
+    WriteRecord(type, AsBytes(record), compressed);
+    stats.Add(Counter::Submits);
+    stats.Add(Counter::BytesRaw, dwords.size() * sizeof(u32));
+}
+
+void CaptureWriter::WriteRecord(RecordType type, std::span<const u8> body,
+                                std::span<const u8> payload) {
+    const RecordHeader header{
+        .type = type,
+        .size = static_cast<u32>(body.size() + payload.size()),
+    };
+    file.WriteObject(header);
+    file.WriteSpan(body);
+    file.WriteSpan(payload);
+    stats.Add(Counter::BytesWritten, sizeof(header) + header.size);
+}
+
+std::span<const u8> CaptureWriter::Compress(std::span<const u8> data) {
+    size_t size = zng_compressBound(data.size());
+    compress_buffer.resize(size);
+    const int ret =
+        zng_compress2(compress_buffer.data(), &size, data.data(), data.size(), Z_BEST_SPEED);
+    ASSERT_MSG(ret == Z_OK, "Failed to compress capture data: {}", ret);
+    return {compress_buffer.data(), size};
+}
+
+bool CaptureReader::Open(const std::filesystem::path& path) {
+    const Common::FS::IOFile file{path, Common::FS::FileAccessMode::Read};
+    if (!file.IsOpen()) {
+        LOG_ERROR(Render, "Failed to open PM4 capture {}", path.string());
+        return false;
+    }
+    FileHeader header{};
+    if (!file.ReadObject(header) || header.magic != Magic) {
+        LOG_ERROR(Render, "{} is not a PM4 capture", path.string());
+        return false;
+    }
+    if (header.version != Version) {
+        LOG_ERROR(Render, "Unsupported PM4 capture version {}", header.version);
+        return false;
+    }
+
+    Frame frame{};
+    std::vector<u8> body;
+    RecordHeader record{};
+    while (file.ReadObject(record)) {
+        body.resize(record.size);
+        if (file.ReadSpan<u8>(body) != body.size()) {
+            LOG_WARNING(Render, "PM4 capture is truncated, dropping the last frame");
+            break;
+        }
+        const std::span<const u8> data{body};
+        switch (record.type) {
+        case RecordType::MapMemory: {
+            const auto map = ReadBody<MapRecord>(data);
+            frame.commands.push_back({
+                .type = RecordType::MapMemory,
+                .address = map.address,
+                .size = map.size,
+                .map_type = map.type,
+            });
+            break;
+        }
+        case RecordType::MemoryData:
+        case RecordType::MemoryRef: {
+            const auto memory = ReadBody<MemoryRecord>(data);
+            auto& chunk = contents[memory.hash];
+            if (record.type == RecordType::MemoryData && chunk.empty()) {
+                chunk.resize(memory.size);
+                if (!Decompress(data.subspan(sizeof(MemoryRecord)), chunk)) {
+                    LOG_ERROR(Render, "Corrupted memory chunk at {:#x}", memory.address);
+                    return false;
+                }
+            }
+            ASSERT_MSG(chunk.size() == memory.size, "Memory chunk {:#x} references missing data",
+                       memory.address);
+            frame.commands.push_back({
+                .type = RecordType::MemoryData,
+                .address = memory.address,
+                .size = memory.size,
+                .hash = memory.hash,
+            });
+            break;
+        }
+        case RecordType::SubmitGfx:
+        case RecordType::SubmitAsc: {
+            const auto submit = ReadBody<SubmitRecord>(data);
+            std::vector<u32> dwords(submit.dcb_dwords + submit.ccb_dwords);
+            const std::span<u8> out{reinterpret_cast<u8*>(dwords.data()),
+                                    dwords.size() * sizeof(u32)};
+            if (!Decompress(data.subspan(sizeof(SubmitRecord)), out)) {
+                LOG_ERROR(Render, "Corrupted command buffer in submit {}", submits.size());
+                return false;
+            }
+            const auto ccb_begin = dwords.begin() + submit.dcb_dwords;
+            frame.commands.push_back({
+                .type = record.type,
+                .submit = static_cast<u32>(submits.size()),
+            });
+            submits.push_back({
+                .vqid = submit.vqid,
+                .dcb = std::vector<u32>(dwords.begin(), ccb_begin),
+                .ccb = std::vector<u32>(ccb_begin, dwords.end()),
+            });
+            break;
+        }
+        case RecordType::EndFrame:
+            frames.push_back(std::move(frame));
+            frame = {};
+            break;
+        default:
+            LOG_ERROR(Render, "Unknown PM4 capture record {}", static_cast<u32>(record.type));
+            return false;
+        }
+    }
+
+    LOG_INFO(Render, "Loaded PM4 capture with {} frames, {} submits and {} unique chunks",
+             frames.size(), submits.size(), contents.size());
+    return !frames.empty();
+}
+
+std::span<const u8> CaptureReader::GetContents(u64 hash) const {
+    const auto it = contents.find(hash);
+    ASSERT_MSG(it != contents.end(), "Missing memory chunk {:#x}", hash);
+    return it->second;
+}
+
+} // namespace AmdGpu
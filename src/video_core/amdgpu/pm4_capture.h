@@ -0,0 +1,172 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <span>
+#include <vector>
+#include <boost/icl/interval_set.hpp>
+#include <tsl/robin_map.h>
+#include <tsl/robin_set.h>
+#include "common/io_file.h"
+#include "common/perf_stats.h"
+#include "common/types.h"
+
+namespace VideoCore {
+class PageManager;
+}
+
+namespace AmdGpu {
+
+class Liverpool;
+
+/**
+ * Replayable capture of the command buffers submitted to the GPU.
+ * Every submission is stored along with the guest memory the GPU can access at that point, so
+ * shaders, resource descriptors and the buffers and textures they point to are all available to
+ * the replayer. Memory is tracked in chunks, a chunk is written again only when its contents
+ * changed since the previous submission, and contents that were already stored are referenced
+ * by hash instead. Chunk contents and command buffers are zlib compressed.
+ * Chunks of direct memory are write protected once stored and only hashed again after a write,
+ * other mappings and captures without a renderer hash every chunk on each submission.
+ */
+namespace Capture {
+
+constexpr u32 Magic = 0x43344D50; ///< "PM4C"
+constexpr u32 Version = 2;
+constexpr size_t ChunkSize = 64_KB;
+
+enum class RecordType : u32 {
+    MapMemory = 0,   ///< A range the GPU can access was mapped.
+    MemoryData = 1,  ///< A chunk changed, followed by its compressed contents.
+    MemoryRef = 2,   ///< A chunk changed to contents stored by an earlier MemoryData.
+    SubmitGfx = 3,   ///< Graphics submission, followed by the compressed DCB and CCB.
+    SubmitAsc = 4,   ///< Compute submission, followed by the compressed ACB.
+    EndFrame = 5,    ///< The guest called sceGnmSubmitDone.
+};
+
+struct FileHeader {
+    u32 magic;
+    u32 version;
+};
+
+struct RecordHeader {
+    RecordType type;
+    u32 size; ///< Size of the record after this header.
+};
+
+struct MapRecord {
+    u64 address;
+    u64 size;
+    u32 type; ///< Core::VMAType of the mapping.
+    u32 reserved;
+};
+
+struct MemoryRecord {
+    u64 address;
+    u64 hash;
+    u32 size;
+    u32 compressed_size; ///< Zero for a MemoryRef.
+};
+
+struct SubmitRecord {
+    u32 vqid; ///< Compute queue of a SubmitAsc.
+    u32 dcb_dwords;
+    u32 ccb_dwords;
+    u32 compressed_size;
+};
+
+} // namespace Capture
+
+class CaptureWriter {
+public:
+    /// The page manager is used to find changed memory, it is null when there is no renderer.
+    explicit CaptureWriter(const std::filesystem::path& path, u32 max_frames,
+                           Liverpool* liverpool, VideoCore::PageManager* page_manager);
+
+    /// Returns true until the requested number of frames has been captured.
+    [[nodiscard]] bool IsActive() const {
+        return file.IsOpen();
+    }
+
+    void SubmitGfx(std::span<const u32> dcb, std::span<const u32> ccb);
+    void SubmitAsc(u32 vqid, std::span<const u32> acb);
+    void EndFrame();
+
+private:
+    void SnapshotMemory();
+    void SnapshotWrittenChunks(const Capture::MapRecord& mapping,
+                               const boost::icl::interval_set<VAddr>& written);
+    void WriteChunks(const Capture::MapRecord& mapping, bool watch);
+    void WriteChunk(VAddr address, size_t size, bool watch);
+    void WriteSubmit(Capture::RecordType type, u32 vqid, std::span<const u32> dcb,
+                     std::span<const u32> ccb);
+    void WriteRecord(Capture::RecordType type, std::span<const u8> body,
+                     std::span<const u8> payload = {});
+    std::span<const u8> Compress(std::span<const u8> data);
+
+    enum class Counter : u32 {
+        Submits,
+        ChunksWritten,
+        ChunksDeduplicated,
+        BytesRaw,
+        BytesWritten,
+    };
+
+    Common::FS::IOFile file;
+    u32 max_frames;
+    u32 num_frames{};
+    Liverpool* liverpool;
+    VideoCore::PageManager* page_manager;
+    std::mutex mutex;
+    std::map<VAddr, Capture::MapRecord> mappings;
+    std::vector<Capture::MapRecord> gpu_mappings;
+    tsl::robin_map<VAddr, u64> chunk_hashes;
+    tsl::robin_set<u64> stored_contents;
+    std::vector<u8> compress_buffer;
+    Common::PerfStats<Counter> stats{Common::Log::Class::Render, "PM4 capture"};
+};
+
+class CaptureReader {
+public:
+    struct Command {
+        Capture::RecordType type;
+        VAddr address; ///< Memory commands.
+        u64 size;      ///< Size of the mapping or chunk.
+        u32 map_type;  ///< Core::VMAType of a mapping.
+        u64 hash;      ///< Contents of a chunk.
+        u32 submit;    ///< Index into the submits of a submit command.
+    };
+
+    struct Submit {
+        u32 vqid;
+        std::vector<u32> dcb;
+        std::vector<u32> ccb;
+    };
+
+    struct Frame {
+        std::vector<Command> commands;
+    };
+
+    bool Open(const std::filesystem::path& path);
+
+    [[nodiscard]] std::span<const Frame> GetFrames() const {
+        return frames;
+    }
+
+    [[nodiscard]] const Submit& GetSubmit(u32 index) const {
+        return submits[index];
+    }
+
+    [[nodiscard]] std::span<const u8> GetContents(u64 hash) const;
+
+private:
+    std::vector<Frame> frames;
+    std::vector<Submit> submits;
+    tsl::robin_map<u64, std::vector<u8>> contents;
+};
+
+} // namespace AmdGpu
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <bit>
 #include <cstring>
 #include "common/bit_field.h"
 #include "common/rdtsc.h"
@@ -364,6 +365,19 @@ struct PM4CmdEventWriteEop {
     }
 };
 
+enum class DmaDataDst : u32 {
+    Memory = 0,
+    Gds = 1,
+    MemoryUsingL2 = 3,
+};
+
+enum class DmaDataSrc : u32 {
+    Memory = 0,
+    Gds = 1,
+    Data = 2,
+    MemoryUsingL2 = 3,
+};
+
 struct PM4DmaData {
     PM4Type3Header header;
     union {
@@ -371,11 +385,11 @@ struct PM4DmaData {
         BitField<12, 1, u32> src_atc;
         BitField<13, 2, u32> src_cache_policy;
         BitField<15, 1, u32> src_volatile;
-        BitField<20, 2, u32> dst_sel;
+        BitField<20, 2, DmaDataDst> dst_sel;
         BitField<24, 1, u32> dst_atc;
         BitField<25, 2, u32> dst_cache_policy;
         BitField<27, 1, u32> dst_volatile;
-        BitField<29, 2, u32> src_sel;
+        BitField<29, 2, DmaDataSrc> src_sel;
         BitField<31, 1, u32> cp_sync;
     };
     union {
@@ -385,7 +399,29 @@ struct PM4DmaData {
     u32 src_addr_hi;
     u32 dst_addr_lo;
     u32 dst_addr_hi;
-    u32 command;
+    union {
+        u32 command;
+        BitField<0, 21, u32> num_bytes;
+        BitField<26, 1, u32> sas;  ///< Source address space, 0 = memory, 1 = register
+        BitField<27, 1, u32> das;  ///< Destination address space, 0 = memory, 1 = register
+        BitField<28, 1, u32> saic; ///< Source address increment disable
+        BitField<29, 1, u32> daic; ///< Destination address increment disable
+        BitField<30, 1, u32> raw_wait;
+    };
+
+    template <typename T>
+    T SrcAddress() const {
+        return std::bit_cast<T>(src_addr_lo | u64(src_addr_hi) << 32);
+    }
+
+    template <typename T>
+    T DstAddress() const {
+        return std::bit_cast<T>(dst_addr_lo | u64(dst_addr_hi) << 32);
+    }
+
+    u32 NumBytes() const noexcept {
+        return num_bytes;
+    }
 };
 
 struct PM4CmdWaitRegMem {
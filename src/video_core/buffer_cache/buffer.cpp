@@ -1,6 +1,7 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <cstring>
 #include "common/alignment.h"
 #include "common/assert.h"
 #include "video_core/buffer_cache/buffer.h"
@@ -204,6 +205,12 @@ void StreamBuffer::Commit() {
     watch.tick = scheduler.CurrentTick();
 }
 
+void StreamBuffer::Invalidate(u64 offset, u64 size) {
+    if (!is_coherent) {
+        vmaInvalidateAllocation(instance->GetAllocator(), buffer.allocation, offset, size);
+    }
+}
+
 void StreamBuffer::ReserveWatches(std::vector<Watch>& watches, std::size_t grow_size) {
     watches.resize(watches.size() + grow_size);
 }
@@ -220,4 +227,50 @@ void StreamBuffer::WaitPendingOperations(u64 requested_upper_bound) {
     }
 }
 
+FrameStreamBuffer::FrameStreamBuffer(const Vulkan::Instance& instance,
+                                     Vulkan::Scheduler& scheduler_, u64 size_bytes)
+    : Buffer{instance, MemoryUsage::Stream, 0, size_bytes}, scheduler{scheduler_},
+      region_size{size_bytes / NumRegions} {
+    const auto device = instance.GetDevice();
+    Vulkan::SetObjectName(device, Handle(), "FrameStreamBuffer:{:#x}", size_bytes);
+}
+
+u64 FrameStreamBuffer::Copy(VAddr src, u32 size, u32 alignment) {
+    ASSERT(size <= region_size);
+    u64 offset = Common::AlignUp(cursor, alignment);
+    if (offset + size > region_size) {
+        // The frame outgrew its region, continue in the next one.
+        AdvanceRegion();
+        offset = 0;
+    }
+    const u64 buffer_offset = region * region_size + offset;
+    std::memcpy(mapped_data.data() + buffer_offset, reinterpret_cast<const void*>(src), size);
+    if (!is_coherent) {
+        vmaFlushAllocation(instance->GetAllocator(), buffer.allocation, buffer_offset, size);
+    }
+    cursor = offset + size;
+    stats.Add(Counter::Uploads);
+    stats.Add(Counter::Bytes, size);
+    return buffer_offset;
+}
+
+void FrameStreamBuffer::NextFrame() {
+    if (cursor != 0) {
+        AdvanceRegion();
+    }
+}
+
+void FrameStreamBuffer::AdvanceRegion() {
+    region_ticks[region] = scheduler.CurrentTick();
+    region = (region + 1) % NumRegions;
+    cursor = 0;
+    stats.Add(Counter::Regions);
+
+    const u64 tick = region_ticks[region];
+    if (tick != 0 && !scheduler.IsFree(tick)) {
+        stats.Add(Counter::Waits);
+        scheduler.Wait(tick);
+    }
+}
+
 } // namespace VideoCore
@@ -3,9 +3,11 @@
 
 #pragma once
 
+#include <array>
 #include <cstddef>
 #include <utility>
 #include <vector>
+#include "common/perf_stats.h"
 #include "common/types.h"
 #include "video_core/amdgpu/resource.h"
 #include "video_core/renderer_vulkan/vk_common.h"
@@ -112,6 +114,7 @@ public:
     bool is_picked{};
     bool is_coherent{};
     int stream_score = 0;
+    u64 tick{}; ///< Scheduler tick of the last command buffer that accessed the buffer.
     size_t size_bytes = 0;
     std::span<u8> mapped_data;
     const Vulkan::Instance* instance{};
@@ -138,6 +141,9 @@ public:
     /// Ensures that reserved bytes of memory are available to the GPU.
     void Commit();
 
+    /// Makes GPU writes to a committed region visible to the host.
+    void Invalidate(u64 offset, u64 size);
+
     /// Maps and commits a memory region with user provided data
     u64 Copy(VAddr src, size_t size, size_t alignment = 0) {
         const auto [data, offset] = Map(size, alignment);
@@ -174,4 +180,41 @@ private:
     u64 wait_bound{};
 };
 
+/**
+ * Persistently mapped ring for the small uploads of a frame, split into a few regions.
+ * Each frame fills its own region with a bump pointer. A region is reused only once the GPU is
+ * done with the last command buffer that read from it. So an upload costs one copy, with no
+ * per upload commit or fence bookkeeping, and the uploads of a frame stay contiguous.
+ */
+class FrameStreamBuffer : public Buffer {
+public:
+    explicit FrameStreamBuffer(const Vulkan::Instance& instance, Vulkan::Scheduler& scheduler,
+                               u64 size_bytes);
+
+    /// Copies guest memory into the current region and returns its offset in the buffer.
+    u64 Copy(VAddr src, u32 size, u32 alignment);
+
+    /// Closes the region of the frame, uploads of the next frame start a new one.
+    void NextFrame();
+
+private:
+    static constexpr u32 NumRegions = 4;
+
+    enum class Counter : u32 {
+        Uploads,
+        Bytes,
+        Regions,
+        Waits,
+    };
+
+    void AdvanceRegion();
+
+    Vulkan::Scheduler& scheduler;
+    u64 region_size;
+    u32 region{};
+    u64 cursor{};
+    std::array<u64, NumRegions> region_ticks{};
+    Common::PerfStats<Counter> stats{Common::Log::Class::Render_Vulkan, "Streamed uniforms"};
+};
+
 } // namespace VideoCore
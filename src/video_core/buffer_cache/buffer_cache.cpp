@@ -2,7 +2,10 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 
 #include <algorithm>
+#include <bit>
+#include <chrono>
 #include "common/alignment.h"
+#include "common/logging/log.h"
 #include "common/scope_exit.h"
 #include "shader_recompiler/runtime_info.h"
 #include "video_core/amdgpu/liverpool.h"
@@ -10,25 +13,77 @@
 #include "video_core/renderer_vulkan/liverpool_to_vk.h"
 #include "video_core/renderer_vulkan/vk_instance.h"
 #include "video_core/renderer_vulkan/vk_scheduler.h"
+#include "video_core/renderer_vulkan/vk_shader_util.h"
+
+#include "video_core/host_shaders/convert_indices_comp.h"
 
 namespace VideoCore {
 
 static constexpr size_t StagingBufferSize = 512_MB;
 static constexpr size_t UboStreamBufferSize = 64_MB;
+static constexpr size_t DownloadBufferSize = 128_MB;
+static constexpr size_t ConvertedIndexBufferSize = 32_MB;
+static constexpr u32 MinCachedQuads = 16384;
+
+/// Parameters of the index conversion shader.
+struct ConvertIndicesParams {
+    u32 prim_type;
+    u32 num_indices;
+    u32 in_offset;
+    u32 index_size;
+};
+
+/// Records a transfer command ordered against the GPU work around it.
+template <typename Func>
+static void RecordTransfer(Vulkan::Scheduler& scheduler, Func&& func) {
+    scheduler.EndRendering(Vulkan::RenderBreak::Transfer);
+    const auto cmdbuf = scheduler.CommandBuffer();
+    static constexpr vk::MemoryBarrier READ_BARRIER{
+        .srcAccessMask = vk::AccessFlagBits::eMemoryWrite,
+        .dstAccessMask = vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite,
+    };
+    static constexpr vk::MemoryBarrier WRITE_BARRIER{
+        .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .dstAccessMask = vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite,
+    };
+    cmdbuf.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
+                           vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlagBits::eByRegion,
+                           READ_BARRIER, {}, {});
+    func(cmdbuf);
+    cmdbuf.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                           vk::PipelineStageFlagBits::eAllCommands,
+                           vk::DependencyFlagBits::eByRegion, WRITE_BARRIER, {}, {});
+}
 
 BufferCache::BufferCache(const Vulkan::Instance& instance_, Vulkan::Scheduler& scheduler_,
-                         const AmdGpu::Liverpool* liverpool_, PageManager& tracker_)
+                         AmdGpu::Liverpool* liverpool_, PageManager& tracker_)
     : instance{instance_}, scheduler{scheduler_}, liverpool{liverpool_}, tracker{tracker_},
       staging_buffer{instance, scheduler, MemoryUsage::Upload, StagingBufferSize},
-      stream_buffer{instance, scheduler, MemoryUsage::Stream, UboStreamBufferSize},
+      stream_buffer{instance, scheduler, UboStreamBufferSize},
+      download_buffer{instance, scheduler, MemoryUsage::Download, DownloadBufferSize},
+      converted_index_buffer{instance, scheduler, MemoryUsage::DeviceLocal,
+                             ConvertedIndexBufferSize},
+      gds_buffer{instance, MemoryUsage::DeviceLocal, 0, GDS_SIZE},
       memory_tracker{&tracker} {
     // Ensure the first slot is used for the null buffer
     void(slot_buffers.insert(instance, MemoryUsage::DeviceLocal, 0, 1));
+    CreateIndexConverter();
 }
 
-BufferCache::~BufferCache() = default;
+BufferCache::~BufferCache() {
+    scheduler.WaitCompletions();
+}
+
+void BufferCache::InvalidateMemory(VAddr device_addr, u64 size, bool unmap) {
+    if (unmap) {
+        // Readbacks still on their way have to land before the pages go away.
+        WaitReadbacks(device_addr, size);
+    } else {
+        // GPU written pages stay with the GPU until the CPU touches them, bring their data back
+        // now that it does.
+        ReadMemory(device_addr, size);
+    }
 
-void BufferCache::InvalidateMemory(VAddr device_addr, u64 size) {
     std::scoped_lock lk{mutex};
     const bool is_tracked = IsRegionRegistered(device_addr, size);
     if (!is_tracked) {
@@ -44,46 +99,229 @@ void BufferCache::InvalidateMemory(VAddr device_addr, u64 size) {
     }
 }
 
-void BufferCache::DownloadBufferMemory(Buffer& buffer, VAddr device_addr, u64 size) {
-    boost::container::small_vector<vk::BufferCopy, 1> copies;
-    u64 total_size_bytes = 0;
-    u64 largest_copy = 0;
-    memory_tracker.ForEachDownloadRange<true>(
-        device_addr, size, [&](u64 device_addr_out, u64 range_size) {
-            const VAddr buffer_addr = buffer.CpuAddr();
-            const auto add_download = [&](VAddr start, VAddr end, u64) {
-                const u64 new_offset = start - buffer_addr;
-                const u64 new_size = end - start;
-                copies.push_back(vk::BufferCopy{
-                    .srcOffset = new_offset,
-                    .dstOffset = total_size_bytes,
-                    .size = new_size,
-                });
-                // Align up to avoid cache conflicts
-                constexpr u64 align = 64ULL;
-                constexpr u64 mask = ~(align - 1ULL);
-                total_size_bytes += (new_size + align - 1) & mask;
-                largest_copy = std::max(largest_copy, new_size);
-            };
-        });
-    if (total_size_bytes == 0) {
+void BufferCache::ReadLabel(VAddr address, u64 size) {
+    {
+        std::scoped_lock lk{mutex};
+        if (!memory_tracker.IsRegionGpuModified(address, size)) {
+            return;
+        }
+    }
+    QueueReadback(address, size);
+}
+
+void BufferCache::ReadMemory(VAddr device_addr, u64 size) {
+    if (scheduler.IsCompletionThread()) {
+        // Writing the readback may fault on pages the texture cache protects. The batch being
+        // committed is the one that faulted, so there is nothing to read or wait for.
         return;
     }
-    const auto [staging, offset] = staging_buffer.Map(total_size_bytes);
-    for (auto& copy : copies) {
-        // Modify copies to have the staging offset in mind
-        copy.dstOffset += offset;
+    bool is_gpu_modified;
+    {
+        std::scoped_lock lk{mutex};
+        is_gpu_modified = memory_tracker.IsRegionGpuModified(device_addr, size);
     }
-    staging_buffer.Commit();
-    scheduler.EndRendering();
-    const auto cmdbuf = scheduler.CommandBuffer();
-    cmdbuf.copyBuffer(buffer.buffer, staging_buffer.Handle(), copies);
-    scheduler.Finish();
-    for (const auto& copy : copies) {
-        const VAddr copy_device_addr = buffer.CpuAddr() + copy.srcOffset;
-        const u64 dst_offset = copy.dstOffset - offset;
-        std::memcpy(std::bit_cast<u8*>(copy_device_addr), staging + dst_offset, copy.size);
+    if (is_gpu_modified) {
+        if (liverpool->IsGpuThread()) {
+            QueueReadback(device_addr, size);
+        } else {
+            // Commands are recorded on the GPU thread only, hand the readback over to it.
+            std::promise<void> queued;
+            liverpool->SendCommand([&] {
+                QueueReadback(device_addr, size);
+                queued.set_value();
+            });
+            queued.get_future().wait();
+        }
+    }
+    WaitReadbacks(device_addr, size);
+}
+
+void BufferCache::QueueReadback(VAddr device_addr, u64 size) {
+    // The CPU takes over whole pages, so all of their GPU data is brought back.
+    const VAddr start_addr = Common::AlignDown(device_addr, CACHING_PAGESIZE);
+    const VAddr end_addr = Common::AlignUp(device_addr + size, CACHING_PAGESIZE);
+    const u64 read_size = end_addr - start_addr;
+
+    struct DownloadRange {
+        BufferId buffer_id;
+        VAddr device_addr;
+        u64 size;
+    };
+    boost::container::small_vector<DownloadRange, 16> download_ranges;
+    std::unique_lock lk{mutex};
+    ForEachBufferInRange(start_addr, read_size, [&](BufferId buffer_id, Buffer& buffer) {
+        const VAddr start = std::max(start_addr, buffer.CpuAddr());
+        const VAddr end = std::min(end_addr, buffer.CpuAddr() + buffer.SizeBytes());
+        if (start >= end) {
+            return;
+        }
+        memory_tracker.ForEachDownloadRange<true>(
+            start, end - start, [&](VAddr range_addr, u64 range_size) {
+                download_ranges.push_back({buffer_id, range_addr, range_size});
+            });
+    });
+    if (download_ranges.empty()) {
+        return;
+    }
+
+    // Every batch fits the download buffer, larger readbacks are split across several batches.
+    // Copies are grouped by the buffer holding them, so a batch is recorded with one copy
+    // command per buffer.
+    struct BufferCopies {
+        BufferId buffer_id;
+        boost::container::small_vector<vk::BufferCopy, 8> copies;
+    };
+    auto it = download_ranges.begin();
+    while (it != download_ranges.end()) {
+        boost::container::small_vector<BufferCopies, 16> buffer_copies;
+        ReadbackBatch batch;
+        u64 total_size_bytes = 0;
+        while (it != download_ranges.end() && total_size_bytes < DownloadBufferSize) {
+            const u64 copy_size = std::min(it->size, DownloadBufferSize - total_size_bytes);
+            if (buffer_copies.empty() || buffer_copies.back().buffer_id != it->buffer_id) {
+                buffer_copies.push_back({it->buffer_id, {}});
+            }
+            buffer_copies.back().copies.push_back(vk::BufferCopy{
+                .srcOffset = slot_buffers[it->buffer_id].Offset(it->device_addr),
+                .dstOffset = total_size_bytes,
+                .size = copy_size,
+            });
+            batch.ranges.push_back({it->device_addr, copy_size, total_size_bytes});
+            total_size_bytes += Common::AlignUp(copy_size, 64);
+            it->device_addr += copy_size;
+            it->size -= copy_size;
+            if (it->size == 0) {
+                ++it;
+            }
+        }
+
+        if (total_size_bytes > download_buffer.GetFreeSize()) {
+            // The download buffer is about to wrap around, make sure the oldest batches are
+            // committed before they are overwritten.
+            lk.unlock();
+            Vulkan::SubmitInfo info{};
+            scheduler.Flush(info);
+            std::unique_lock readback_lk{readback_mutex};
+            readback_cv.wait(readback_lk, [this] { return readback_batches.empty(); });
+            readback_lk.unlock();
+            lk.lock();
+        }
+
+        const auto [staging, offset] = download_buffer.Map(total_size_bytes);
+        for (auto& [buffer_id, copies] : buffer_copies) {
+            for (auto& copy : copies) {
+                copy.dstOffset += offset;
+            }
+        }
+        for (auto& range : batch.ranges) {
+            range.staging_offset += offset;
+        }
+        download_buffer.Commit();
+
+        scheduler.EndRendering(Vulkan::RenderBreak::Download);
+        const auto cmdbuf = scheduler.CommandBuffer();
+        static constexpr vk::MemoryBarrier READ_BARRIER{
+            .srcAccessMask = vk::AccessFlagBits::eMemoryWrite,
+            .dstAccessMask = vk::AccessFlagBits::eTransferRead,
+        };
+        static constexpr vk::MemoryBarrier HOST_BARRIER{
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eHostRead,
+        };
+        cmdbuf.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
+                               vk::PipelineStageFlagBits::eTransfer,
+                               vk::DependencyFlagBits::eByRegion, READ_BARRIER, {}, {});
+        for (const auto& [buffer_id, copies] : buffer_copies) {
+            Buffer& buffer = slot_buffers[buffer_id];
+            buffer.tick = scheduler.CurrentTick();
+            cmdbuf.copyBuffer(buffer.Handle(), download_buffer.Handle(), copies);
+        }
+        cmdbuf.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                               vk::PipelineStageFlagBits::eHost,
+                               vk::DependencyFlagBits::eByRegion, HOST_BARRIER, {}, {});
+
+        {
+            std::scoped_lock readback_lk{readback_mutex};
+            readback_batches.push_back(std::move(batch));
+        }
+        scheduler.DeferCompletion([this] { CommitReadbacks(); });
     }
+    lk.unlock();
+
+    // Someone is waiting on the data, submit right away.
+    Vulkan::SubmitInfo info{};
+    scheduler.Flush(info);
+}
+
+void BufferCache::WaitReadbacks(VAddr device_addr, u64 size) {
+    if (scheduler.IsCompletionThread()) {
+        // Writing the readback may fault on pages the texture cache protects. The batch being
+        // committed is the one that faulted, so there is nothing to wait for.
+        return;
+    }
+    std::unique_lock lk{readback_mutex};
+    if (!IsReadbackPending(device_addr, size)) {
+        return;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    readback_cv.wait(lk, [&] { return !IsReadbackPending(device_addr, size); });
+    readback_stats.Add(ReadbackCounter::Stalls);
+    readback_stats.Add(ReadbackCounter::StallUs,
+                       std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - start)
+                           .count());
+}
+
+bool BufferCache::IsReadbackPending(VAddr device_addr, u64 size) const {
+    const VAddr end = device_addr + size;
+    return std::ranges::any_of(readback_batches, [&](const ReadbackBatch& batch) {
+        return std::ranges::any_of(batch.ranges, [&](const Readback& range) {
+            return range.device_addr < end && device_addr < range.device_addr + range.size;
+        });
+    });
+}
+
+void BufferCache::CommitReadbacks() {
+    const ReadbackBatch* batch{};
+    {
+        std::scoped_lock lk{readback_mutex};
+        // Completions run in order and only here are batches popped, so the reference stays
+        // valid after unlocking.
+        batch = &readback_batches.front();
+    }
+
+    // Pages the guest wrote since the GPU did now belong to the CPU, skip them. The rest are
+    // handed to the CPU before the copy and stay that way, a guest write racing with the copy
+    // then lands in a CPU owned page and is picked up by the next upload instead of being lost.
+    boost::container::small_vector<const Readback*, 16> ranges;
+    {
+        std::scoped_lock lk{mutex};
+        for (const auto& range : batch->ranges) {
+            if (memory_tracker.IsRegionCpuModified(range.device_addr, range.size)) {
+                continue;
+            }
+            memory_tracker.MarkRegionAsCpuModified(range.device_addr, range.size);
+            ranges.push_back(&range);
+        }
+    }
+    u64 bytes = 0;
+    for (const Readback* range : ranges) {
+        download_buffer.Invalidate(range->staging_offset, range->size);
+        std::memcpy(std::bit_cast<u8*>(range->device_addr),
+                    download_buffer.mapped_data.data() + range->staging_offset, range->size);
+        bytes += range->size;
+    }
+    // Queues may be parked on a WaitRegMem polling one of the labels that just landed.
+    for (const Readback* range : ranges) {
+        liverpool->NotifyLabelWrite(range->device_addr, range->size);
+    }
+
+    readback_stats.Add(ReadbackCounter::Batches);
+    readback_stats.Add(ReadbackCounter::Ranges, ranges.size());
+    readback_stats.Add(ReadbackCounter::Bytes, bytes);
+    std::scoped_lock lk{readback_mutex};
+    readback_batches.pop_front();
+    readback_cv.notify_all();
 }
 
 bool BufferCache::BindVertexBuffers(const Shader::Info& vs_info) {
@@ -192,21 +430,21 @@ bool BufferCache::BindVertexBuffers(const Shader::Info& vs_info) {
 }
 
 u32 BufferCache::BindIndexBuffer(bool& is_indexed, u32 index_offset) {
-    // Emulate QuadList primitive type with CPU made index buffer.
+    using PrimitiveType = AmdGpu::Liverpool::PrimitiveType;
     const auto& regs = liverpool->regs;
-    if (regs.primitive_type == AmdGpu::Liverpool::PrimitiveType::QuadList) {
+    const auto prim_type = regs.primitive_type;
+    if (prim_type == PrimitiveType::QuadList && !is_indexed) {
+        // Quad lists draw from a cached index buffer that only grows when needed.
         is_indexed = true;
-
-        // Emit indices.
-        const u32 index_size = 3 * regs.num_indices;
-        const auto [data, offset] = stream_buffer.Map(index_size);
-        Vulkan::LiverpoolToVK::EmitQuadToTriangleListIndices(data, regs.num_indices);
-        stream_buffer.Commit();
-
-        // Bind index buffer.
+        const u32 num_quads = regs.num_indices / 4;
+        ReserveQuadIndices(num_quads);
         const auto cmdbuf = scheduler.CommandBuffer();
-        cmdbuf.bindIndexBuffer(stream_buffer.Handle(), offset, vk::IndexType::eUint16);
-        return index_size / sizeof(u16);
+        cmdbuf.bindIndexBuffer(quad_index_buffer->Handle(), 0, vk::IndexType::eUint32);
+        return num_quads * 6;
+    }
+    if (prim_type == PrimitiveType::QuadList || prim_type == PrimitiveType::Polygon ||
+        prim_type == PrimitiveType::LineLoop) {
+        return ConvertIndices(is_indexed, index_offset);
     }
     if (!is_indexed) {
         return regs.num_indices;
@@ -229,30 +467,33 @@ u32 BufferCache::BindIndexBuffer(bool& is_indexed, u32 index_offset) {
 }
 
 std::pair<Buffer*, u32> BufferCache::ObtainBuffer(VAddr device_addr, u32 size, bool is_written) {
-    std::scoped_lock lk{mutex};
     static constexpr u64 StreamThreshold = CACHING_PAGESIZE;
-    const bool is_gpu_dirty = memory_tracker.IsRegionGpuModified(device_addr, size);
-    if (!is_written && size < StreamThreshold && !is_gpu_dirty) {
+    // Pages only become GPU modified on this thread, which also owns the stream buffer, so the
+    // stream path runs without the cache lock.
+    if (!is_written && size < StreamThreshold &&
+        !memory_tracker.MayBeGpuModified(device_addr, size)) {
         // For small uniform buffers that have not been modified by gpu
         // use device local stream buffer to reduce renderpass breaks.
         const u64 offset = stream_buffer.Copy(device_addr, size, instance.UniformMinAlignment());
-        return {&stream_buffer, offset};
+        return {&stream_buffer, static_cast<u32>(offset)};
     }
 
+    std::scoped_lock lk{mutex};
     const BufferId buffer_id = FindBuffer(device_addr, size);
     Buffer& buffer = slot_buffers[buffer_id];
     SynchronizeBuffer(buffer, device_addr, size);
+    buffer.tick = scheduler.CurrentTick();
     if (is_written) {
         memory_tracker.MarkRegionAsGpuModified(device_addr, size);
     }
     return {&buffer, buffer.Offset(device_addr)};
 }
 
-std::pair<const Buffer*, u32> BufferCache::ObtainTempBuffer(VAddr gpu_addr, u32 size) {
+std::pair<Buffer*, u32> BufferCache::ObtainTempBuffer(VAddr gpu_addr, u32 size) {
     const u64 page = gpu_addr >> CACHING_PAGEBITS;
     const BufferId buffer_id = page_table[page];
     if (buffer_id) {
-        const Buffer& buffer = slot_buffers[buffer_id];
+        Buffer& buffer = slot_buffers[buffer_id];
         if (buffer.IsInBounds(gpu_addr, size)) {
             return {&buffer, buffer.Offset(gpu_addr)};
         }
@@ -261,6 +502,108 @@ std::pair<const Buffer*, u32> BufferCache::ObtainTempBuffer(VAddr gpu_addr, u32
     return {&staging_buffer, offset};
 }
 
+void BufferCache::InlineData(VAddr address, const void* value, u32 num_bytes, bool is_gds) {
+    std::unique_lock lk{mutex};
+    if (IsCpuTransfer(address, num_bytes, is_gds)) {
+        // The write may fault on protected pages, the fault handler takes the lock.
+        lk.unlock();
+        std::memcpy(std::bit_cast<void*>(address), value, num_bytes);
+        return;
+    }
+    ASSERT_MSG(num_bytes % 4 == 0 && num_bytes <= 64_KB, "Unsupported inline data size {}",
+               num_bytes);
+    const bool is_label = IsLabelWrite(address, num_bytes, is_gds);
+    if (is_label) {
+        lk.unlock();
+        std::memcpy(std::bit_cast<void*>(address), value, num_bytes);
+        lk.lock();
+    }
+    const auto [buffer, offset] = ObtainTransferBuffer(address, num_bytes, is_gds, !is_label);
+    RecordTransfer(scheduler, [&](vk::CommandBuffer cmdbuf) {
+        cmdbuf.updateBuffer(buffer->Handle(), offset, num_bytes, value);
+    });
+}
+
+void BufferCache::FillBuffer(VAddr address, u32 num_bytes, u32 value, bool is_gds) {
+    std::unique_lock lk{mutex};
+    if (IsCpuTransfer(address, num_bytes, is_gds)) {
+        lk.unlock();
+        u32* dst = std::bit_cast<u32*>(address);
+        std::fill_n(dst, num_bytes / sizeof(u32), value);
+        return;
+    }
+    ASSERT_MSG(num_bytes % 4 == 0, "Unsupported fill size {}", num_bytes);
+    const bool is_label = IsLabelWrite(address, num_bytes, is_gds);
+    if (is_label) {
+        lk.unlock();
+        std::fill_n(std::bit_cast<u32*>(address), num_bytes / sizeof(u32), value);
+        lk.lock();
+    }
+    const auto [buffer, offset] = ObtainTransferBuffer(address, num_bytes, is_gds, !is_label);
+    RecordTransfer(scheduler, [&](vk::CommandBuffer cmdbuf) {
+        cmdbuf.fillBuffer(buffer->Handle(), offset, num_bytes, value);
+    });
+}
+
+void BufferCache::CopyBuffer(VAddr dst, VAddr src, u32 num_bytes, bool dst_gds, bool src_gds) {
+    std::unique_lock lk{mutex};
+    if (IsCpuTransfer(dst, num_bytes, dst_gds) && IsCpuTransfer(src, num_bytes, src_gds)) {
+        lk.unlock();
+        std::memmove(std::bit_cast<void*>(dst), std::bit_cast<const void*>(src), num_bytes);
+        return;
+    }
+    // Looking up one range may join the buffer holding the other into a new one, so the source
+    // is looked up again once the destination is resolved. By then both are cached and the
+    // second lookup cannot create buffers.
+    void(ObtainTransferBuffer(src, num_bytes, src_gds, false));
+    const auto [dst_buffer, dst_offset] = ObtainTransferBuffer(dst, num_bytes, dst_gds, true);
+    const auto [src_buffer, src_offset] = ObtainTransferBuffer(src, num_bytes, src_gds, false);
+    const vk::BufferCopy copy = {
+        .srcOffset = src_offset,
+        .dstOffset = dst_offset,
+        .size = num_bytes,
+    };
+    RecordTransfer(scheduler, [&](vk::CommandBuffer cmdbuf) {
+        cmdbuf.copyBuffer(src_buffer->Handle(), dst_buffer->Handle(), copy);
+    });
+}
+
+std::pair<Buffer*, u32> BufferCache::ObtainTransferBuffer(VAddr address, u32 size, bool is_gds,
+                                                          bool is_written) {
+    if (is_gds) {
+        ASSERT_MSG(address + size <= GDS_SIZE, "GDS range {:#x}:{:#x} out of bounds", address,
+                   size);
+        return {&gds_buffer, static_cast<u32>(address)};
+    }
+    // Transfers must land in the buffer the memory is cached in, never in a stream copy.
+    const BufferId buffer_id = FindBuffer(address, size);
+    Buffer& buffer = slot_buffers[buffer_id];
+    SynchronizeBuffer(buffer, address, size);
+    buffer.tick = scheduler.CurrentTick();
+    if (is_written) {
+        memory_tracker.MarkRegionAsGpuModified(address, size);
+    }
+    return {&buffer, buffer.Offset(address)};
+}
+
+bool BufferCache::IsLabelWrite(VAddr address, u32 size, bool is_gds) {
+    // Small writes are labels the CPU and WaitRegMem poll on. They are written to guest memory
+    // right away, as waiting for the next fence readback would stall the pollers, and the GPU
+    // copy is patched to match so neither side needs a readback. The CPU write hands its page
+    // to the CPU, so this is only done while the GPU holds no unread data in it.
+    static constexpr u32 MaxLabelSize = sizeof(u64);
+    if (is_gds || size > MaxLabelSize) {
+        return false;
+    }
+    const VAddr page_addr = Common::AlignDown(address, DEVICE_PAGESIZE);
+    return !memory_tracker.IsRegionGpuModified(page_addr, address + size - page_addr);
+}
+
+bool BufferCache::IsCpuTransfer(VAddr address, u32 size, bool is_gds) {
+    // Memory without a cached copy on the GPU is only read from guest memory, access it directly.
+    return !is_gds && !IsRegionRegistered(address, size);
+}
+
 bool BufferCache::IsRegionRegistered(VAddr addr, size_t size) {
     const VAddr end_addr = addr + size;
     const u64 page_end = Common::DivCeil(end_addr, CACHING_PAGESIZE);
@@ -394,8 +737,15 @@ void BufferCache::JoinOverlap(BufferId new_buffer_id, BufferId overlap_id,
         .dstOffset = dst_base_offset,
         .size = overlap.SizeBytes(),
     };
-    scheduler.EndRendering();
-    const auto cmdbuf = scheduler.CommandBuffer();
+    const u64 tick = scheduler.CurrentTick();
+    vk::CommandBuffer cmdbuf;
+    if (overlap.tick != tick && new_buffer.tick != tick) {
+        cmdbuf = scheduler.UploadCommandBuffer();
+    } else {
+        scheduler.EndRendering(Vulkan::RenderBreak::Transfer);
+        cmdbuf = scheduler.CommandBuffer();
+        new_buffer.tick = tick;
+    }
     static constexpr vk::MemoryBarrier READ_BARRIER{
         .srcAccessMask = vk::AccessFlagBits::eMemoryWrite,
         .dstAccessMask = vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite,
@@ -424,9 +774,8 @@ BufferId BufferCache::CreateBuffer(VAddr device_addr, u32 wanted_size) {
         slot_buffers.insert(instance, MemoryUsage::DeviceLocal, overlap.begin, size);
     auto& new_buffer = slot_buffers[new_buffer_id];
     const size_t size_bytes = new_buffer.SizeBytes();
-    const auto cmdbuf = scheduler.CommandBuffer();
-    scheduler.EndRendering();
-    cmdbuf.fillBuffer(new_buffer.buffer, 0, size_bytes, 0);
+    // Nothing can reference the new buffer yet, clear it ahead of the current command buffer.
+    scheduler.UploadCommandBuffer().fillBuffer(new_buffer.buffer, 0, size_bytes, 0);
     for (const BufferId overlap_id : overlap.ids) {
         JoinOverlap(new_buffer_id, overlap_id, !overlap.has_stream_leap);
     }
@@ -505,8 +854,15 @@ bool BufferCache::SynchronizeBuffer(Buffer& buffer, VAddr device_addr, u32 size)
         }
         scheduler.DeferOperation([buffer = std::move(temp_buffer)]() mutable {});
     }
-    scheduler.EndRendering();
-    const auto cmdbuf = scheduler.CommandBuffer();
+    // Uploads to a buffer the current command buffer has not accessed yet can be hoisted ahead
+    // of it without ending the render pass.
+    vk::CommandBuffer cmdbuf;
+    if (buffer.tick != scheduler.CurrentTick()) {
+        cmdbuf = scheduler.UploadCommandBuffer();
+    } else {
+        scheduler.EndRendering(Vulkan::RenderBreak::Upload);
+        cmdbuf = scheduler.CommandBuffer();
+    }
     static constexpr vk::MemoryBarrier READ_BARRIER{
         .srcAccessMask = vk::AccessFlagBits::eMemoryWrite,
         .dstAccessMask = vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite,
@@ -525,6 +881,212 @@ bool BufferCache::SynchronizeBuffer(Buffer& buffer, VAddr device_addr, u32 size)
     return false;
 }
 
+void BufferCache::ReserveQuadIndices(u32 num_quads) {
+    if (num_quads <= num_cached_quads) {
+        return;
+    }
+    if (quad_index_buffer) {
+        // The previous buffer may still be bound by recorded draws.
+        scheduler.DeferOperation([buffer = std::move(*quad_index_buffer)]() mutable {});
+    }
+    num_cached_quads = std::max(std::bit_ceil(num_quads), MinCachedQuads);
+    const u64 size_bytes = u64{num_cached_quads} * 6 * sizeof(u32);
+    ASSERT_MSG(size_bytes < StagingBufferSize, "Quad list of {} quads is too large", num_quads);
+    quad_index_buffer.emplace(instance, MemoryUsage::DeviceLocal, 0, size_bytes);
+
+    const auto [data, offset] = staging_buffer.Map(size_bytes);
+    Vulkan::LiverpoolToVK::EmitQuadToTriangleListIndices(data, num_cached_quads * 4);
+    staging_buffer.Commit();
+
+    // The new buffer is not referenced by any command yet, fill it ahead of the current ones.
+    const auto cmdbuf = scheduler.UploadCommandBuffer();
+    cmdbuf.copyBuffer(staging_buffer.Handle(), quad_index_buffer->Handle(),
+                      vk::BufferCopy{
+                          .srcOffset = offset,
+                          .dstOffset = 0,
+                          .size = size_bytes,
+                      });
+    static constexpr vk::MemoryBarrier WRITE_BARRIER{
+        .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .dstAccessMask = vk::AccessFlagBits::eIndexRead,
+    };
+    cmdbuf.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                           vk::PipelineStageFlagBits::eVertexInput, {}, WRITE_BARRIER, {}, {});
+}
+
+u32 BufferCache::ConvertIndices(bool& is_indexed, u32 index_offset) {
+    using PrimitiveType = AmdGpu::Liverpool::PrimitiveType;
+    const auto& regs = liverpool->regs;
+    const u32 num_indices = regs.num_indices;
+    ConvertIndicesParams params{
+        .num_indices = num_indices,
+    };
+    u32 num_prims{};
+    u32 num_out_indices{};
+    switch (regs.primitive_type) {
+    case PrimitiveType::QuadList:
+        params.prim_type = 0;
+        num_prims = num_indices / 4;
+        num_out_indices = num_prims * 6;
+        break;
+    case PrimitiveType::Polygon:
+        params.prim_type = 1;
+        num_prims = num_indices > 2 ? num_indices - 2 : 0;
+        num_out_indices = num_prims * 3;
+        break;
+    case PrimitiveType::LineLoop:
+        params.prim_type = 2;
+        num_prims = num_indices;
+        num_out_indices = num_indices > 1 ? num_indices + 1 : 0;
+        break;
+    default:
+        UNREACHABLE();
+    }
+    if (num_out_indices == 0) {
+        is_indexed = false;
+        return 0;
+    }
+
+    const u32 out_size = num_out_indices * sizeof(u32);
+    const auto [out_data, out_offset] =
+        converted_index_buffer.Map(out_size, instance.StorageMinAlignment());
+    converted_index_buffer.Commit();
+
+    // Bind the guest index buffer, when there is one, as the shader input. Reading it ahead of the
+    // current command buffer is only valid if none of the recorded commands accesses it.
+    const u64 tick = scheduler.CurrentTick();
+    bool can_hoist = true;
+    vk::Buffer in_buffer = converted_index_buffer.Handle();
+    u64 in_offset = out_offset;
+    u64 in_size = out_size;
+    if (is_indexed) {
+        const bool is_index16 =
+            regs.index_buffer_type.index_type == AmdGpu::Liverpool::IndexType::Index16;
+        params.index_size = is_index16 ? sizeof(u16) : sizeof(u32);
+        const VAddr index_address =
+            regs.index_base_address.Address<VAddr>() + index_offset * params.index_size;
+        const u32 index_buffer_size = num_indices * params.index_size;
+        ForEachBufferInRange(index_address, index_buffer_size,
+                             [&](BufferId, const Buffer& buffer) {
+                                 can_hoist &= buffer.tick != tick;
+                             });
+        const auto [vk_buffer, offset] = ObtainBuffer(index_address, index_buffer_size, false);
+        in_buffer = vk_buffer->Handle();
+        in_offset = Common::AlignDown(offset, instance.StorageMinAlignment());
+        in_size = Common::AlignUp(offset + index_buffer_size, 4) - in_offset;
+        params.in_offset = static_cast<u32>((offset - in_offset) / params.index_size);
+    }
+
+    vk::CommandBuffer cmdbuf;
+    if (can_hoist) {
+        cmdbuf = scheduler.UploadCommandBuffer();
+    } else {
+        scheduler.EndRendering(Vulkan::RenderBreak::Dispatch);
+        cmdbuf = scheduler.CommandBuffer();
+    }
+    static constexpr vk::MemoryBarrier READ_BARRIER{
+        .srcAccessMask = vk::AccessFlagBits::eMemoryWrite,
+        .dstAccessMask = vk::AccessFlagBits::eShaderRead,
+    };
+    static constexpr vk::MemoryBarrier WRITE_BARRIER{
+        .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+        .dstAccessMask = vk::AccessFlagBits::eIndexRead,
+    };
+    cmdbuf.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
+                           vk::PipelineStageFlagBits::eComputeShader, {}, READ_BARRIER, {}, {});
+    cmdbuf.bindPipeline(vk::PipelineBindPoint::eCompute, *convert_pipeline);
+    const vk::DescriptorBufferInfo input_info{
+        .buffer = in_buffer,
+        .offset = in_offset,
+        .range = in_size,
+    };
+    const vk::DescriptorBufferInfo output_info{
+        .buffer = converted_index_buffer.Handle(),
+        .offset = out_offset,
+        .range = out_size,
+    };
+    const std::array<vk::WriteDescriptorSet, 2> set_writes{{
+        {
+            .dstBinding = 0,
+            .descriptorCount = 1,
+            .descriptorType = vk::DescriptorType::eStorageBuffer,
+            .pBufferInfo = &input_info,
+        },
+        {
+            .dstBinding = 1,
+            .descriptorCount = 1,
+            .descriptorType = vk::DescriptorType::eStorageBuffer,
+            .pBufferInfo = &output_info,
+        },
+    }};
+    cmdbuf.pushDescriptorSetKHR(vk::PipelineBindPoint::eCompute, *convert_pl_layout, 0,
+                                set_writes);
+    cmdbuf.pushConstants(*convert_pl_layout, vk::ShaderStageFlagBits::eCompute, 0u,
+                         sizeof(params), &params);
+    cmdbuf.dispatch(Common::DivCeil(num_prims, 64u), 1, 1);
+    cmdbuf.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                           vk::PipelineStageFlagBits::eVertexInput, {}, WRITE_BARRIER, {}, {});
+
+    is_indexed = true;
+    scheduler.CommandBuffer().bindIndexBuffer(converted_index_buffer.Handle(), out_offset,
+                                              vk::IndexType::eUint32);
+    return num_out_indices;
+}
+
+void BufferCache::CreateIndexConverter() {
+    const auto device = instance.GetDevice();
+    const auto module = Vulkan::Compile(HostShaders::CONVERT_INDICES_COMP,
+                                        vk::ShaderStageFlagBits::eCompute, device);
+    Vulkan::SetObjectName(device, module, "ConvertIndices");
+
+    const std::array<vk::DescriptorSetLayoutBinding, 2> bindings{{
+        {
+            .binding = 0,
+            .descriptorType = vk::DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eCompute,
+        },
+        {
+            .binding = 1,
+            .descriptorType = vk::DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eCompute,
+        },
+    }};
+    convert_desc_layout = device.createDescriptorSetLayoutUnique({
+        .flags = vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR,
+        .bindingCount = static_cast<u32>(bindings.size()),
+        .pBindings = bindings.data(),
+    });
+
+    const vk::PushConstantRange push_constants = {
+        .stageFlags = vk::ShaderStageFlagBits::eCompute,
+        .offset = 0,
+        .size = sizeof(ConvertIndicesParams),
+    };
+    const vk::DescriptorSetLayout set_layout = *convert_desc_layout;
+    convert_pl_layout = device.createPipelineLayoutUnique({
+        .setLayoutCount = 1U,
+        .pSetLayouts = &set_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constants,
+    });
+
+    const vk::ComputePipelineCreateInfo compute_pipeline_ci = {
+        .stage =
+            {
+                .stage = vk::ShaderStageFlagBits::eCompute,
+                .module = module,
+                .pName = "main",
+            },
+        .layout = *convert_pl_layout,
+    };
+    auto result = device.createComputePipelineUnique({}, compute_pipeline_ci);
+    ASSERT_MSG(result.result == vk::Result::eSuccess, "Index conversion pipeline creation failed");
+    convert_pipeline = std::move(result.value);
+    device.destroyShaderModule(module);
+}
+
 void BufferCache::DeleteBuffer(BufferId buffer_id, bool do_not_mark) {
     // Mark the whole buffer as CPU written to stop tracking CPU writes
     if (!do_not_mark) {
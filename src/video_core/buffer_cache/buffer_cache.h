@@ -3,11 +3,16 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <deque>
 #include <mutex>
+#include <optional>
+#include <vector>
 #include <boost/container/small_vector.hpp>
 #include <boost/icl/interval_map.hpp>
 #include <tsl/robin_map.h>
 #include "common/div_ceil.h"
+#include "common/perf_stats.h"
 #include "common/slot_vector.h"
 #include "common/types.h"
 #include "video_core/buffer_cache/buffer.h"
@@ -35,6 +40,7 @@ public:
     static constexpr u32 CACHING_PAGEBITS = 12;
     static constexpr u64 CACHING_PAGESIZE = u64{1} << CACHING_PAGEBITS;
     static constexpr u64 DEVICE_PAGESIZE = 4_KB;
+    static constexpr u64 GDS_SIZE = 64_KB;
 
     struct Traits {
         using Entry = BufferId;
@@ -51,25 +57,53 @@ public:
         bool has_stream_leap = false;
     };
 
+    enum class ReadbackCounter : u32 {
+        Batches,
+        Ranges,
+        Bytes,
+        Stalls,
+        StallUs,
+    };
+
 public:
     explicit BufferCache(const Vulkan::Instance& instance, Vulkan::Scheduler& scheduler,
-                         const AmdGpu::Liverpool* liverpool, PageManager& tracker);
+                         AmdGpu::Liverpool* liverpool, PageManager& tracker);
     ~BufferCache();
 
-    /// Invalidates any buffer in the logical page range.
-    void InvalidateMemory(VAddr device_addr, u64 size);
+    /// Invalidates any buffer in the logical page range. Unless the range is being unmapped, GPU
+    /// written data in its pages is read back first, as the CPU takes them over.
+    void InvalidateMemory(VAddr device_addr, u64 size, bool unmap = false);
+
+    /// Reads back the label a parked WaitRegMem polls when the GPU wrote it. Must be called from
+    /// the GPU thread, the queue is woken once the value has landed in guest memory.
+    void ReadLabel(VAddr address, u64 size);
+
+    /// Writes inline data to memory in command order, on the GPU when the memory is cached.
+    void InlineData(VAddr address, const void* value, u32 num_bytes, bool is_gds);
+
+    /// Fills memory with a dword value in command order, on the GPU when the memory is cached.
+    void FillBuffer(VAddr address, u32 num_bytes, u32 value, bool is_gds);
+
+    /// Copies memory in command order, on the GPU when either range is cached.
+    void CopyBuffer(VAddr dst, VAddr src, u32 num_bytes, bool dst_gds, bool src_gds);
 
     /// Binds host vertex buffers for the current draw.
     bool BindVertexBuffers(const Shader::Info& vs_info);
 
-    /// Bind host index buffer for the current draw.
+    /// Bind host index buffer for the current draw. Primitive types without a Vulkan
+    /// equivalent are drawn with converted indices, in which case is_indexed is set.
     u32 BindIndexBuffer(bool& is_indexed, u32 index_offset);
 
     /// Obtains a buffer for the specified region.
     [[nodiscard]] std::pair<Buffer*, u32> ObtainBuffer(VAddr gpu_addr, u32 size, bool is_written);
 
+    /// Ends the frame of streamed uniform data, called when the guest finishes a frame.
+    void NextFrame() {
+        stream_buffer.NextFrame();
+    }
+
     /// Obtains a temporary buffer for usage in texture cache.
-    [[nodiscard]] std::pair<const Buffer*, u32> ObtainTempBuffer(VAddr gpu_addr, u32 size);
+    [[nodiscard]] std::pair<Buffer*, u32> ObtainTempBuffer(VAddr gpu_addr, u32 size);
 
     /// Return true when a region is registered on the cache
     [[nodiscard]] bool IsRegionRegistered(VAddr addr, size_t size);
@@ -98,7 +132,41 @@ private:
         }
     }
 
-    void DownloadBufferMemory(Buffer& buffer, VAddr device_addr, u64 size);
+    struct Readback {
+        VAddr device_addr;
+        u64 size;
+        u64 staging_offset;
+    };
+
+    struct ReadbackBatch {
+        std::vector<Readback> ranges;
+    };
+
+    /// Reads back the GPU modified memory in the pages of the region and blocks until it has
+    /// landed in guest memory.
+    void ReadMemory(VAddr device_addr, u64 size);
+
+    /// Records copies of the GPU modified memory in the pages of the region into the download
+    /// buffer and submits them, they are written to guest memory once the GPU gets there. Must
+    /// be called from the GPU thread.
+    void QueueReadback(VAddr device_addr, u64 size);
+
+    /// Blocks until queued readbacks overlapping the region have landed in guest memory.
+    void WaitReadbacks(VAddr device_addr, u64 size);
+
+    /// Writes the oldest queued batch to guest memory, runs as a scheduler completion.
+    void CommitReadbacks();
+
+    [[nodiscard]] bool IsReadbackPending(VAddr device_addr, u64 size) const;
+
+    /// Returns the buffer and offset a transfer command operates on.
+    [[nodiscard]] std::pair<Buffer*, u32> ObtainTransferBuffer(VAddr address, u32 size,
+                                                               bool is_gds, bool is_written);
+
+    /// Returns true when a transfer can bypass the GPU and run on guest memory directly.
+    [[nodiscard]] bool IsCpuTransfer(VAddr address, u32 size, bool is_gds);
+
+    [[nodiscard]] bool IsLabelWrite(VAddr address, u32 size, bool is_gds);
 
     [[nodiscard]] BufferId FindBuffer(VAddr device_addr, u32 size);
 
@@ -117,18 +185,40 @@ private:
 
     bool SynchronizeBuffer(Buffer& buffer, VAddr device_addr, u32 size);
 
+    /// Grows the cached quad list index buffer to cover at least num_quads quads.
+    void ReserveQuadIndices(u32 num_quads);
+
+    /// Expands the indices of the current draw into a host primitive type on the GPU.
+    /// Returns the number of indices to draw.
+    u32 ConvertIndices(bool& is_indexed, u32 index_offset);
+
+    void CreateIndexConverter();
+
     void DeleteBuffer(BufferId buffer_id, bool do_not_mark = false);
 
     const Vulkan::Instance& instance;
     Vulkan::Scheduler& scheduler;
-    const AmdGpu::Liverpool* liverpool;
+    AmdGpu::Liverpool* liverpool;
     PageManager& tracker;
     StreamBuffer staging_buffer;
-    StreamBuffer stream_buffer;
+    FrameStreamBuffer stream_buffer;
+    StreamBuffer download_buffer;
+    StreamBuffer converted_index_buffer;
+    Buffer gds_buffer;
+    std::optional<Buffer> quad_index_buffer;
+    u32 num_cached_quads{};
+    vk::UniqueDescriptorSetLayout convert_desc_layout;
+    vk::UniquePipelineLayout convert_pl_layout;
+    vk::UniquePipeline convert_pipeline;
     std::recursive_mutex mutex;
     Common::SlotVector<Buffer> slot_buffers;
     MemoryTracker memory_tracker;
     PageTable page_table;
+    mutable std::mutex readback_mutex;
+    std::condition_variable_any readback_cv;
+    std::deque<ReadbackBatch> readback_batches;
+    Common::PerfStats<ReadbackCounter> readback_stats{Common::Log::Class::Render_Vulkan,
+                                                      "Readbacks"};
 };
 
 } // namespace VideoCore
@@ -4,6 +4,8 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <deque>
 #include <type_traits>
 #include <vector>
@@ -43,6 +45,22 @@ public:
             });
     }
 
+    /**
+     * Returns true if a region may have been modified from the GPU. Unlike the other queries it
+     * does not need the caller to hold the cache lock. Pages only become GPU modified on the
+     * thread that records GPU work, so that thread never misses one. Pages cleared by other
+     * threads at worst still read as modified for a while.
+     */
+    [[nodiscard]] bool MayBeGpuModified(VAddr query_cpu_addr, u64 query_size) const noexcept {
+        bool result = false;
+        IterateSummaryWords(query_cpu_addr, query_size, [&](size_t high, size_t word, u64 mask) {
+            const GpuSummary* summary = gpu_summary[high].load(std::memory_order_acquire);
+            result = summary && (summary->words[word].load(std::memory_order_relaxed) & mask);
+            return result;
+        });
+        return result;
+    }
+
     /// Mark region as CPU modified, notifying the device_tracker about this change
     void MarkRegionAsCpuModified(VAddr dirty_cpu_addr, u64 query_size) {
         IteratePages<true>(dirty_cpu_addr, query_size,
@@ -68,6 +86,15 @@ public:
                                manager->template ChangeRegionState<Type::GPU, true>(
                                    manager->GetCpuAddr() + offset, size);
                            });
+        IterateSummaryWords(dirty_cpu_addr, query_size, [&](size_t high, size_t word, u64 mask) {
+            GpuSummary* summary = gpu_summary[high].load(std::memory_order_relaxed);
+            if (!summary) {
+                summary = &summary_pool.emplace_back();
+                gpu_summary[high].store(summary, std::memory_order_release);
+            }
+            summary->words[word].fetch_or(mask, std::memory_order_relaxed);
+            return false;
+        });
     }
 
     /// Unmark region as modified from the host GPU
@@ -77,6 +104,7 @@ public:
                                manager->template ChangeRegionState<Type::GPU, false>(
                                    manager->GetCpuAddr() + offset, size);
                            });
+        ClearSummary(dirty_cpu_addr, query_size);
     }
 
     /// Call 'func' for each CPU modified range and unmark those pages as CPU modified
@@ -92,11 +120,15 @@ public:
     /// Call 'func' for each GPU modified range and unmark those pages as GPU modified
     template <bool clear, typename Func>
     void ForEachDownloadRange(VAddr query_cpu_range, u64 query_size, Func&& func) {
+        const auto clear_func = [this, &func](VAddr range_addr, u64 range_size) {
+            ClearSummary(range_addr, range_size);
+            func(range_addr, range_size);
+        };
         IteratePages<false>(query_cpu_range, query_size,
-                            [&func](Manager* manager, u64 offset, size_t size) {
+                            [&](Manager* manager, u64 offset, size_t size) {
                                 if constexpr (clear) {
                                     manager->template ForEachModifiedRange<Type::GPU, true>(
-                                        manager->GetCpuAddr() + offset, size, func);
+                                        manager->GetCpuAddr() + offset, size, clear_func);
                                 } else {
                                     manager->template ForEachModifiedRange<Type::GPU, false>(
                                         manager->GetCpuAddr() + offset, size, func);
@@ -105,6 +137,38 @@ public:
     }
 
 private:
+    /// Lock free copy of the GPU modified bits of a 4_MB region, see MayBeGpuModified.
+    struct GpuSummary {
+        std::array<std::atomic<u64>, WORDS_STACK_NEEDED> words{};
+    };
+
+    /// Calls func with the region, word and page mask of each summary word covering a range.
+    template <typename Func>
+    static void IterateSummaryWords(VAddr cpu_addr, u64 size, Func&& func) {
+        u64 page = cpu_addr / BYTES_PER_PAGE;
+        const u64 page_end = Common::DivCeil(cpu_addr + size, BYTES_PER_PAGE);
+        while (page < page_end) {
+            const u64 word = page / PAGES_PER_WORD;
+            const u64 word_end = std::min((word + 1) * PAGES_PER_WORD, page_end);
+            const u64 num_pages = word_end - page;
+            const u64 bits = num_pages == PAGES_PER_WORD ? ~0ULL : (1ULL << num_pages) - 1;
+            if (func(word / WORDS_STACK_NEEDED, word % WORDS_STACK_NEEDED,
+                     bits << (page % PAGES_PER_WORD))) {
+                return;
+            }
+            page = word_end;
+        }
+    }
+
+    void ClearSummary(VAddr cpu_addr, u64 size) noexcept {
+        IterateSummaryWords(cpu_addr, size, [&](size_t high, size_t word, u64 mask) {
+            if (GpuSummary* summary = gpu_summary[high].load(std::memory_order_acquire)) {
+                summary->words[word].fetch_and(~mask, std::memory_order_relaxed);
+            }
+            return false;
+        });
+    }
+
     /**
      * @brief IteratePages Iterates L2 word manager page table.
      * @param cpu_address Start byte cpu address
@@ -170,6 +234,8 @@ private:
     std::deque<std::array<Manager, MANAGER_POOL_SIZE>> manager_pool;
     std::vector<Manager*> free_managers;
     std::array<Manager*, NUM_HIGH_PAGES> top_tier{};
+    std::deque<GpuSummary> summary_pool;
+    std::array<std::atomic<GpuSummary*>, NUM_HIGH_PAGES> gpu_summary{};
 };
 
 } // namespace VideoCore
@@ -4,6 +4,7 @@
 #include <thread>
 #include "common/alignment.h"
 #include "common/assert.h"
+#include "common/div_ceil.h"
 #include "common/error.h"
 #include "video_core/page_manager.h"
 #include "video_core/renderer_vulkan/vk_rasterizer.h"
@@ -220,6 +221,14 @@ void PageManager::OnGpuMap(VAddr address, size_t size) {
 }
 
 void PageManager::OnGpuUnmap(VAddr address, size_t size) {
+    {
+        std::scoped_lock lk{watch_mutex};
+        const auto pages = boost::icl::interval_set<VAddr>{
+            decltype(watched_pages)::interval_type::right_open(address >> PAGEBITS,
+                                                               (address + size) >> PAGEBITS)};
+        UnwatchWrites(watched_pages & pages);
+        written_pages -= pages;
+    }
     impl->OnUnmap(address, size);
 }
 
@@ -257,4 +266,49 @@ void PageManager::UpdatePagesCachedCount(VAddr addr, u64 size, s32 delta) {
     }
 }
 
+void PageManager::WatchWrites(VAddr addr, u64 size) {
+    std::scoped_lock lk{watch_mutex};
+    const u64 page_end = Common::DivCeil(addr + size, PAGESIZE);
+    auto pages = boost::icl::interval_set<VAddr>{
+        decltype(watched_pages)::interval_type::right_open(addr >> PAGEBITS, page_end)};
+    pages -= watched_pages;
+    for (const auto& interval : pages) {
+        const VAddr start = boost::icl::first(interval) << PAGEBITS;
+        UpdatePagesCachedCount(start, boost::icl::length(interval) << PAGEBITS, 1);
+    }
+    watched_pages += pages;
+}
+
+void PageManager::OnCpuWrite(VAddr addr, u64 size) {
+    std::scoped_lock lk{watch_mutex};
+    if (watched_pages.empty()) {
+        return;
+    }
+    const u64 page_end = Common::DivCeil(addr + size, PAGESIZE);
+    const auto pages =
+        watched_pages & decltype(watched_pages)::interval_type::right_open(addr >> PAGEBITS,
+                                                                           page_end);
+    written_pages += pages;
+    UnwatchWrites(pages);
+}
+
+boost::icl::interval_set<VAddr> PageManager::TakeWrittenRanges() {
+    std::scoped_lock lk{watch_mutex};
+    boost::icl::interval_set<VAddr> ranges;
+    for (const auto& interval : written_pages) {
+        ranges += decltype(ranges)::interval_type::right_open(
+            boost::icl::first(interval) << PAGEBITS, boost::icl::last_next(interval) << PAGEBITS);
+    }
+    written_pages.clear();
+    return ranges;
+}
+
+void PageManager::UnwatchWrites(const boost::icl::interval_set<VAddr>& pages) {
+    for (const auto& interval : pages) {
+        const VAddr start = boost::icl::first(interval) << PAGEBITS;
+        UpdatePagesCachedCount(start, boost::icl::length(interval) << PAGEBITS, -1);
+    }
+    watched_pages -= pages;
+}
+
 } // namespace VideoCore
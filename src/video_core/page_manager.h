@@ -6,6 +6,7 @@
 #include <memory>
 #include <mutex>
 #include <boost/icl/interval_map.hpp>
+#include <boost/icl/interval_set.hpp>
 #include "common/types.h"
 
 namespace Vulkan {
@@ -28,12 +29,26 @@ public:
     /// Increase/decrease the number of surface in pages touching the specified region
     void UpdatePagesCachedCount(VAddr addr, u64 size, s32 delta);
 
+    /// Write protects the pages of a region until they are next written to.
+    void WatchWrites(VAddr addr, u64 size);
+
+    /// Records a write to the specified region and stops watching its pages.
+    void OnCpuWrite(VAddr addr, u64 size);
+
+    /// Returns the watched address ranges that were written to since the last call.
+    boost::icl::interval_set<VAddr> TakeWrittenRanges();
+
 private:
+    void UnwatchWrites(const boost::icl::interval_set<VAddr>& pages);
+
     struct Impl;
     std::unique_ptr<Impl> impl;
     Vulkan::Rasterizer* rasterizer;
     std::mutex mutex;
     boost::icl::interval_map<VAddr, s32> cached_pages;
+    std::mutex watch_mutex;
+    boost::icl::interval_set<VAddr> watched_pages;
+    boost::icl::interval_set<VAddr> written_pages;
 };
 
 } // namespace VideoCore
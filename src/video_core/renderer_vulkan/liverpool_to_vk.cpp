@@ -86,8 +86,12 @@ vk::PrimitiveTopology PrimitiveType(Liverpool::PrimitiveType type) {
     case Liverpool::PrimitiveType::PatchPrimitive:
         return vk::PrimitiveTopology::ePatchList;
     case Liverpool::PrimitiveType::QuadList:
-        // Needs to generate index buffer on the fly.
+    case Liverpool::PrimitiveType::Polygon:
+        // Drawn with indices converted to a triangle list.
         return vk::PrimitiveTopology::eTriangleList;
+    case Liverpool::PrimitiveType::LineLoop:
+        // Drawn with indices converted to a closed line strip.
+        return vk::PrimitiveTopology::eLineStrip;
     case Liverpool::PrimitiveType::RectList:
         return vk::PrimitiveTopology::eTriangleStrip;
     default:
@@ -631,9 +635,9 @@ vk::Format DepthFormat(DepthBuffer::ZFormat z_format, DepthBuffer::StencilFormat
 }
 
 void EmitQuadToTriangleListIndices(u8* out_ptr, u32 num_vertices) {
-    static constexpr u16 NumVerticesPerQuad = 4;
-    u16* out_data = reinterpret_cast<u16*>(out_ptr);
-    for (u16 i = 0; i < num_vertices; i += NumVerticesPerQuad) {
+    static constexpr u32 NumVerticesPerQuad = 4;
+    u32* out_data = reinterpret_cast<u32*>(out_ptr);
+    for (u32 i = 0; i < num_vertices; i += NumVerticesPerQuad) {
         *out_data++ = i;
         *out_data++ = i + 1;
         *out_data++ = i + 2;
@@ -4,6 +4,7 @@
 #include "common/config.h"
 #include "common/debug.h"
 #include "common/singleton.h"
+#include "common/thread.h"
 #include "core/file_format/splash.h"
 #include "core/libraries/system/systemservice.h"
 #include "sdl_window.h"
@@ -69,25 +70,39 @@ RendererVulkan::RendererVulkan(Frontend::WindowSDL& window_, AmdGpu::Liverpool*
       present_scheduler{instance}, flip_scheduler{instance}, swapchain{instance, window},
       rasterizer{std::make_unique<Rasterizer>(instance, draw_scheduler, liverpool)},
       texture_cache{rasterizer->GetTextureCache()} {
-    const u32 num_images = swapchain.GetImageCount();
+    const u32 num_frames = std::max(Config::getFramesInFlight(), 1U);
     const vk::Device device = instance.GetDevice();
+    if (Config::isFsrEnabled()) {
+        upscaler = std::make_unique<Upscaler>(instance);
+    }
+    low_latency = Config::isLowLatencyMode();
+    LOG_INFO(Render_Vulkan, "Presenting with {} frames in flight, {}{}", num_frames,
+             vk::to_string(swapchain.GetPresentMode()), low_latency ? ", low latency" : "");
 
     // Create presentation frames.
-    present_frames.resize(num_images);
-    for (u32 i = 0; i < num_images; i++) {
+    present_frames.resize(num_frames);
+    for (u32 i = 0; i < num_frames; i++) {
         Frame& frame = present_frames[i];
         frame.present_done = device.createFence({.flags = vk::FenceCreateFlagBits::eSignaled});
         free_queue.push(&frame);
     }
+
+    present_thread = std::jthread([this](std::stop_token token) { PresentThread(token); });
 }
 
 RendererVulkan::~RendererVulkan() {
+    present_thread.request_stop();
+    present_thread.join();
     draw_scheduler.Finish();
     const vk::Device device = instance.GetDevice();
     for (auto& frame : present_frames) {
         vmaDestroyImage(instance.GetAllocator(), frame.image, frame.allocation);
         device.destroyImageView(frame.image_view);
         device.destroyFence(frame.present_done);
+        if (upscaler) {
+            upscaler->Destroy(frame.upscale_input);
+            upscaler->Destroy(frame.upscale_easu);
+        }
     }
 }
 
@@ -100,7 +115,14 @@ void RendererVulkan::RecreateFrame(Frame* frame, u32 width, u32 height) {
         vmaDestroyImage(instance.GetAllocator(), frame->image, frame->allocation);
     }
 
-    const vk::Format format = swapchain.GetSurfaceFormat().format;
+    // The upscaler writes frames from a compute shader, which sRGB formats do not support.
+    const vk::Format format = upscaler ? Upscaler::Format : swapchain.GetSurfaceFormat().format;
+    vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eColorAttachment |
+                                vk::ImageUsageFlagBits::eTransferDst |
+                                vk::ImageUsageFlagBits::eTransferSrc;
+    if (upscaler) {
+        usage |= vk::ImageUsageFlagBits::eStorage;
+    }
     const vk::ImageCreateInfo image_info = {
         .imageType = vk::ImageType::e2D,
         .format = format,
@@ -108,8 +130,7 @@ void RendererVulkan::RecreateFrame(Frame* frame, u32 width, u32 height) {
         .mipLevels = 1,
         .arrayLayers = 1,
         .samples = vk::SampleCountFlagBits::e1,
-        .usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferDst |
-                 vk::ImageUsageFlagBits::eTransferSrc,
+        .usage = usage,
     };
 
     const VmaAllocationCreateInfo alloc_info = {
@@ -150,6 +171,10 @@ void RendererVulkan::RecreateFrame(Frame* frame, u32 width, u32 height) {
     frame->height = height;
 }
 
+VideoCore::PageManager& RendererVulkan::GetPageManager() {
+    return rasterizer->GetPageManager();
+}
+
 bool RendererVulkan::ShowSplash(Frame* frame /*= nullptr*/) {
     const auto* splash = Common::Singleton<Splash>::Instance();
     if (splash->GetImageData().empty()) {
@@ -187,11 +212,29 @@ Frame* RendererVulkan::PrepareFrameInternal(VideoCore::Image& image, bool is_eop
     // commands. Otherwise we are dealing with a CPU flip which could have arrived
     // from any guest thread. Use a separate scheduler for that.
     auto& scheduler = is_eop ? draw_scheduler : flip_scheduler;
-    scheduler.EndRendering();
+    scheduler.EndRendering(RenderBreak::Present);
     const auto cmdbuf = scheduler.CommandBuffer();
 
-    image.Transit(vk::ImageLayout::eTransferSrcOptimal, vk::AccessFlagBits::eTransferRead, cmdbuf);
+    image.Transit(vk::ImageLayout::eTransferSrcOptimal, vk::AccessFlagBits::eTransferRead, {},
+                  cmdbuf);
+
+    // Frames rendered below the window size go through the upscaler, others are blitted.
+    const auto extent = image.info.ScaledSize();
+    if (upscaler && (extent.width < frame->width || extent.height < frame->height)) {
+        UpscaleFrame(cmdbuf, image, frame);
+    } else {
+        BlitFrame(cmdbuf, image, frame);
+    }
+
+    // Flush frame creation commands.
+    frame->ready_semaphore = scheduler.GetMasterSemaphore()->Handle();
+    frame->ready_tick = scheduler.CurrentTick();
+    SubmitInfo info{};
+    scheduler.Flush(info);
+    return frame;
+}
 
+void RendererVulkan::BlitFrame(vk::CommandBuffer cmdbuf, VideoCore::Image& image, Frame* frame) {
     const std::array pre_barrier{
         vk::ImageMemoryBarrier{
             .srcAccessMask = vk::AccessFlagBits::eTransferRead,
@@ -214,11 +257,10 @@ Frame* RendererVulkan::PrepareFrameInternal(VideoCore::Image& image, bool is_eop
                            vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlagBits::eByRegion,
                            {}, {}, pre_barrier);
 
-    // Post-processing (Anti-aliasing, FSR etc) goes here. For now just blit to the frame image.
-    cmdbuf.blitImage(
-        image.image, image.layout, frame->image, vk::ImageLayout::eTransferDstOptimal,
-        MakeImageBlit(image.info.size.width, image.info.size.height, frame->width, frame->height),
-        vk::Filter::eLinear);
+    const auto extent = image.info.ScaledSize();
+    cmdbuf.blitImage(image.image, image.layout, frame->image, vk::ImageLayout::eTransferDstOptimal,
+                     MakeImageBlit(extent.width, extent.height, frame->width, frame->height),
+                     vk::Filter::eLinear);
 
     const vk::ImageMemoryBarrier post_barrier{
         .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
@@ -239,16 +281,120 @@ Frame* RendererVulkan::PrepareFrameInternal(VideoCore::Image& image, bool is_eop
     cmdbuf.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
                            vk::PipelineStageFlagBits::eAllCommands,
                            vk::DependencyFlagBits::eByRegion, {}, {}, post_barrier);
+}
 
-    // Flush frame creation commands.
-    frame->ready_semaphore = scheduler.GetMasterSemaphore()->Handle();
-    frame->ready_tick = scheduler.CurrentTick();
-    SubmitInfo info{};
-    scheduler.Flush(info);
-    return frame;
+void RendererVulkan::UpscaleFrame(vk::CommandBuffer cmdbuf, VideoCore::Image& image, Frame* frame) {
+    const auto extent = image.info.ScaledSize();
+    upscaler->Resize(frame->upscale_input, {extent.width, extent.height});
+    upscaler->Resize(frame->upscale_easu, {frame->width, frame->height});
+
+    // Copy the image into the upscaler format at its rendered size, converting from sRGB if
+    // needed, then upscale into the frame image.
+    const auto make_barrier = [&](vk::AccessFlags src_access, vk::AccessFlags dst_access,
+                                  vk::ImageLayout old_layout, vk::ImageLayout new_layout) {
+        return vk::ImageMemoryBarrier{
+            .srcAccessMask = src_access,
+            .dstAccessMask = dst_access,
+            .oldLayout = old_layout,
+            .newLayout = new_layout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = frame->upscale_input.image,
+            .subresourceRange{
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        };
+    };
+    cmdbuf.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                           vk::PipelineStageFlagBits::eTransfer, {}, {}, {},
+                           make_barrier(vk::AccessFlagBits::eShaderRead,
+                                        vk::AccessFlagBits::eTransferWrite,
+                                        vk::ImageLayout::eUndefined,
+                                        vk::ImageLayout::eTransferDstOptimal));
+    cmdbuf.blitImage(image.image, image.layout, frame->upscale_input.image,
+                     vk::ImageLayout::eTransferDstOptimal,
+                     MakeImageBlit(extent.width, extent.height, extent.width, extent.height),
+                     vk::Filter::eNearest);
+    cmdbuf.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                           vk::PipelineStageFlagBits::eComputeShader, {}, {}, {},
+                           make_barrier(vk::AccessFlagBits::eTransferWrite,
+                                        vk::AccessFlagBits::eShaderRead,
+                                        vk::ImageLayout::eTransferDstOptimal,
+                                        vk::ImageLayout::eGeneral));
+
+    upscaler->Render(cmdbuf, frame->upscale_input, frame->upscale_easu, frame->image,
+                     frame->image_view);
+
+    const vk::ImageMemoryBarrier post_barrier{
+        .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+        .dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite,
+        .oldLayout = vk::ImageLayout::eGeneral,
+        .newLayout = vk::ImageLayout::eGeneral,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = frame->image,
+        .subresourceRange{
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = VK_REMAINING_ARRAY_LAYERS,
+        },
+    };
+    cmdbuf.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
+                           vk::PipelineStageFlagBits::eAllCommands,
+                           vk::DependencyFlagBits::eByRegion, {}, {}, post_barrier);
 }
 
 void RendererVulkan::Present(Frame* frame) {
+    std::unique_lock lk{present_mutex};
+    if (low_latency) {
+        // Hold the flip until the previous frame is on screen, so input sampled by the guest
+        // after it returns lands in the very next frame instead of queueing behind others.
+        presented_cv.wait(lk, [this] { return present_queue.empty() && !presenting; });
+    }
+    frame->present_queued = std::chrono::steady_clock::now();
+    present_queue.push(frame);
+    present_cv.notify_one();
+}
+
+void RendererVulkan::PresentThread(std::stop_token token) {
+    Common::SetCurrentThreadName("shadPS4:Present");
+    while (true) {
+        Frame* frame;
+        {
+            std::unique_lock lk{present_mutex};
+            Common::CondvarWait(present_cv, lk, token, [this] { return !present_queue.empty(); });
+            if (token.stop_requested()) {
+                return;
+            }
+            frame = present_queue.front();
+            present_queue.pop();
+            presenting = true;
+        }
+
+        // The frame goes back to the free queue once presented, so read its timestamp first.
+        const auto queued = frame->present_queued;
+        PresentFrame(frame);
+        const u64 latency_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                                   std::chrono::steady_clock::now() - queued)
+                                   .count();
+        LOG_DEBUG(Render_Vulkan, "Frame presented {} us after flip", latency_us);
+        present_stats.Add(PresentCounter::Frames);
+        present_stats.Add(PresentCounter::TotalLatencyUs, latency_us);
+        present_stats.Max(PresentCounter::MaxLatencyUs, latency_us);
+
+        std::scoped_lock lk{present_mutex};
+        presenting = false;
+        presented_cv.notify_all();
+    }
+}
+
+void RendererVulkan::PresentFrame(Frame* frame) {
     swapchain.AcquireNextImage();
 
     const vk::Image swapchain_image = swapchain.Image();
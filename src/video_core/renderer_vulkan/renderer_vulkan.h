@@ -3,11 +3,15 @@
 
 #pragma once
 
+#include <chrono>
 #include <condition_variable>
+#include "common/perf_stats.h"
+#include "common/polyfill_thread.h"
 #include "video_core/amdgpu/liverpool.h"
 #include "video_core/renderer_vulkan/vk_instance.h"
 #include "video_core/renderer_vulkan/vk_scheduler.h"
 #include "video_core/renderer_vulkan/vk_swapchain.h"
+#include "video_core/renderer_vulkan/vk_upscaler.h"
 #include "video_core/texture_cache/texture_cache.h"
 
 namespace Frontend {
@@ -29,6 +33,9 @@ struct Frame {
     vk::Fence present_done;
     vk::Semaphore ready_semaphore;
     u64 ready_tick;
+    std::chrono::steady_clock::time_point present_queued;
+    UpscalerImage upscale_input;
+    UpscalerImage upscale_easu;
 };
 
 enum SchedulerType {
@@ -47,7 +54,7 @@ public:
     Frame* PrepareFrame(const Libraries::VideoOut::BufferAttributeGroup& attribute,
                         VAddr cpu_address, bool is_eop) {
         const auto info = VideoCore::ImageInfo{attribute, cpu_address};
-        const auto image_id = texture_cache.FindImage(info);
+        const auto image_id = texture_cache.FindImage(info, texture_cache.GetResolutionScale());
         texture_cache.UpdateImage(image_id, is_eop ? nullptr : &flip_scheduler);
         auto& image = texture_cache.GetImage(image_id);
         return PrepareFrameInternal(image, is_eop);
@@ -62,7 +69,7 @@ public:
         const Libraries::VideoOut::BufferAttributeGroup& attribute, VAddr cpu_address) {
         vo_buffers_addr.emplace_back(cpu_address);
         const auto info = VideoCore::ImageInfo{attribute, cpu_address};
-        const auto image_id = texture_cache.FindImage(info);
+        const auto image_id = texture_cache.FindImage(info, texture_cache.GetResolutionScale());
         return texture_cache.GetImage(image_id);
     }
 
@@ -73,7 +80,11 @@ public:
     }
 
     bool ShowSplash(Frame* frame = nullptr);
+
+    /// Queues a frame for presentation on the present thread. In low latency mode this waits
+    /// for the previously queued frame to be presented first.
     void Present(Frame* frame);
+
     void RecreateFrame(Frame* frame, u32 width, u32 height);
 
     void FlushDraw() {
@@ -81,11 +92,28 @@ public:
         draw_scheduler.Flush(info);
     }
 
+    /// Submits the recorded draws and waits for the GPU to execute them.
+    void FinishDraw() {
+        draw_scheduler.Finish();
+    }
+
+    VideoCore::PageManager& GetPageManager();
+
 private:
     Frame* PrepareFrameInternal(VideoCore::Image& image, bool is_eop = true);
     Frame* GetRenderFrame();
+    void BlitFrame(vk::CommandBuffer cmdbuf, VideoCore::Image& image, Frame* frame);
+    void UpscaleFrame(vk::CommandBuffer cmdbuf, VideoCore::Image& image, Frame* frame);
+    void PresentThread(std::stop_token token);
+    void PresentFrame(Frame* frame);
 
 private:
+    enum class PresentCounter : u32 {
+        Frames,
+        TotalLatencyUs,
+        MaxLatencyUs,
+    };
+
     Frontend::WindowSDL& window;
     AmdGpu::Liverpool* liverpool;
     Instance instance;
@@ -94,6 +122,7 @@ private:
     Scheduler flip_scheduler;
     Swapchain swapchain;
     std::unique_ptr<Rasterizer> rasterizer;
+    std::unique_ptr<Upscaler> upscaler;
     VideoCore::TextureCache& texture_cache;
     vk::UniqueCommandPool command_pool;
     std::vector<Frame> present_frames;
@@ -103,6 +132,15 @@ private:
     std::condition_variable_any frame_cv;
     std::optional<VideoCore::Image> splash_img;
     std::vector<VAddr> vo_buffers_addr;
+    std::queue<Frame*> present_queue;
+    std::mutex present_mutex;
+    std::condition_variable_any present_cv;
+    std::condition_variable presented_cv;
+    bool presenting{};
+    bool low_latency{};
+    Common::PerfStats<PresentCounter> present_stats{Common::Log::Class::Render_Vulkan,
+                                                    "Presents"};
+    std::jthread present_thread;
 };
 
 } // namespace Vulkan
@@ -97,7 +97,8 @@ bool ComputePipeline::BindResources(VideoCore::BufferCache& buffer_cache,
     Shader::PushData push_data{};
     u32 binding{};
 
-    for (const auto& buffer : info->buffers) {
+    for (u32 i = 0; i < info->buffers.size(); ++i) {
+        const auto& buffer = info->buffers[i];
         const auto vsharp = buffer.GetVsharp(*info);
         const VAddr address = vsharp.base_address;
         // Most of the time when a metadata is updated with a shader it gets cleared. It means we
@@ -126,7 +127,7 @@ bool ComputePipeline::BindResources(VideoCore::BufferCache& buffer_cache,
         const u32 adjust = offset - offset_aligned;
         if (adjust != 0) {
             ASSERT(adjust % 4 == 0);
-            push_data.AddOffset(binding, adjust);
+            push_data.AddOffset(Shader::PushData::BufOffsetSlot(Shader::Stage::Compute, i), adjust);
         }
         buffer_infos.emplace_back(vk_buffer->Handle(), offset_aligned, size + adjust);
         set_writes.push_back({
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <tsl/robin_map.h>
 #include "shader_recompiler/ir/program.h"
 #include "shader_recompiler/runtime_info.h"
 #include "video_core/renderer_vulkan/vk_common.h"
@@ -19,9 +20,10 @@ class Scheduler;
 
 struct Program {
     Shader::IR::Program pgm;
-    std::vector<u32> spv;
+    std::vector<u32> spv; ///< SPIR-V with resource bindings starting at zero.
     vk::ShaderModule module;
-    u32 end_binding;
+    u32 num_bindings;
+    tsl::robin_map<u32, vk::ShaderModule> rebased_modules; ///< Modules keyed by binding base.
 };
 
 class ComputePipeline {
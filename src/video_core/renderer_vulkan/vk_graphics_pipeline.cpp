@@ -19,7 +19,8 @@ namespace Vulkan {
 GraphicsPipeline::GraphicsPipeline(const Instance& instance_, Scheduler& scheduler_,
                                    const GraphicsPipelineKey& key_,
                                    vk::PipelineCache pipeline_cache,
-                                   std::span<const Program*, MaxShaderStages> programs)
+                                   std::span<const Program*, MaxShaderStages> programs,
+                                   std::span<const vk::ShaderModule, MaxShaderStages> modules)
     : instance{instance_}, scheduler{scheduler_}, key{key_} {
     const vk::Device device = instance.GetDevice();
     for (u32 i = 0; i < MaxShaderStages; i++) {
@@ -196,14 +197,14 @@ GraphicsPipeline::GraphicsPipeline(const Instance& instance_, Scheduler& schedul
         shader_stages;
     shader_stages.emplace_back(vk::PipelineShaderStageCreateInfo{
         .stage = vk::ShaderStageFlagBits::eVertex,
-        .module = programs[stage]->module,
+        .module = modules[stage],
         .pName = "main",
     });
     stage = u32(Shader::Stage::Fragment);
     if (programs[stage]) {
         shader_stages.emplace_back(vk::PipelineShaderStageCreateInfo{
             .stage = vk::ShaderStageFlagBits::eFragment,
-            .module = programs[stage]->module,
+            .module = modules[stage],
             .pName = "main",
         });
     }
@@ -361,7 +362,8 @@ void GraphicsPipeline::BindResources(const Liverpool::Regs& regs,
             push_data.step0 = regs.vgt_instance_step_rate_0;
             push_data.step1 = regs.vgt_instance_step_rate_1;
         }
-        for (const auto& buffer : stage->buffers) {
+        for (u32 i = 0; i < stage->buffers.size(); ++i) {
+            const auto& buffer = stage->buffers[i];
             const auto vsharp = buffer.GetVsharp(*stage);
             if (vsharp) {
                 const VAddr address = vsharp.base_address;
@@ -377,7 +379,8 @@ void GraphicsPipeline::BindResources(const Liverpool::Regs& regs,
                 const u32 adjust = offset - offset_aligned;
                 if (adjust != 0) {
                     ASSERT(adjust % 4 == 0);
-                    push_data.AddOffset(binding, adjust);
+                    push_data.AddOffset(Shader::PushData::BufOffsetSlot(stage->stage, i),
+                                        adjust);
                 }
                 buffer_infos.emplace_back(vk_buffer->Handle(), offset_aligned, size + adjust);
             } else {
@@ -59,7 +59,8 @@ class GraphicsPipeline {
 public:
     explicit GraphicsPipeline(const Instance& instance, Scheduler& scheduler,
                               const GraphicsPipelineKey& key, vk::PipelineCache pipeline_cache,
-                              std::span<const Program*, MaxShaderStages> programs);
+                              std::span<const Program*, MaxShaderStages> programs,
+                              std::span<const vk::ShaderModule, MaxShaderStages> modules);
     ~GraphicsPipeline();
 
     void BindResources(const Liverpool::Regs& regs, VideoCore::BufferCache& buffer_cache,
@@ -0,0 +1,67 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "common/debug.h"
+#include "video_core/amdgpu/liverpool.h"
+#include "video_core/renderer_vulkan/vk_null_rasterizer.h"
+#include "video_core/texture_cache/image_info.h"
+#include "video_core/texture_cache/image_view.h"
+
+namespace Vulkan {
+
+NullRasterizer::NullRasterizer(AmdGpu::Liverpool* liverpool_)
+    : liverpool{liverpool_}, pipeline_cache{liverpool_} {
+    liverpool->BindNullRasterizer(this);
+}
+
+void NullRasterizer::Draw() {
+    RENDERER_TRACE;
+
+    stats.Add(Counter::Draws);
+    // Tessellation draws are skipped before the pipeline key is refreshed.
+    if (liverpool->regs.primitive_type == AmdGpu::Liverpool::PrimitiveType::PatchPrimitive) {
+        return;
+    }
+    pipeline_cache.GetGraphicsPipeline();
+    for (const u64 hash : pipeline_cache.GetGraphicsKey().stage_hashes) {
+        if (!hash) {
+            continue;
+        }
+        if (const Program* program = pipeline_cache.FindProgram(hash)) {
+            ReadResources(program->pgm.info);
+        }
+    }
+}
+
+void NullRasterizer::DispatchDirect() {
+    RENDERER_TRACE;
+
+    stats.Add(Counter::Dispatches);
+    pipeline_cache.GetComputePipeline();
+    if (const Program* program = pipeline_cache.FindProgram(pipeline_cache.GetComputeKey())) {
+        ReadResources(program->pgm.info);
+    }
+}
+
+void NullRasterizer::ReadResources(const Shader::Info& info) {
+    // Descriptors are built from these sharps. Resolving them to host buffers and images needs
+    // the caches and a device, so they are only decoded here.
+    for (const auto& buffer : info.buffers) {
+        const auto vsharp = buffer.GetVsharp(info);
+        stats.Add(Counter::Buffers);
+        stats.Add(Counter::BufferBytes, vsharp.GetSize());
+    }
+    for (const auto& image_desc : info.images) {
+        const auto tsharp =
+            info.ReadUd<AmdGpu::Image>(image_desc.sgpr_base, image_desc.dword_offset);
+        const VideoCore::ImageInfo image_info{tsharp};
+        const VideoCore::ImageViewInfo view_info{tsharp, image_desc.is_storage};
+        stats.Add(Counter::Images);
+    }
+    for (const auto& sampler : info.samplers) {
+        [[maybe_unused]] const auto ssharp = sampler.GetSsharp(info);
+        stats.Add(Counter::Samplers);
+    }
+}
+
+} // namespace Vulkan
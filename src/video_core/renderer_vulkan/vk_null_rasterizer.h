@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "common/perf_stats.h"
+#include "video_core/renderer_vulkan/vk_pipeline_cache.h"
+
+namespace AmdGpu {
+struct Liverpool;
+}
+
+namespace Shader {
+struct Info;
+}
+
+namespace Vulkan {
+
+/**
+ * Command sink used in place of the rasterizer when running without a GPU. Draws and dispatches
+ * go through the pipeline key, shader translation and program cache lookups and read the
+ * resources their descriptors are built from, but nothing is recorded. Guest memory is not
+ * cached, the command processor handles transfers and labels on the CPU.
+ */
+class NullRasterizer {
+public:
+    explicit NullRasterizer(AmdGpu::Liverpool* liverpool);
+
+    void Draw();
+
+    void DispatchDirect();
+
+private:
+    void ReadResources(const Shader::Info& info);
+
+private:
+    enum class Counter : u32 {
+        Draws,
+        Dispatches,
+        Buffers,
+        BufferBytes,
+        Images,
+        Samplers,
+    };
+
+    AmdGpu::Liverpool* liverpool;
+    PipelineCache pipeline_cache;
+    Common::PerfStats<Counter> stats{Common::Log::Class::Render_Vulkan, "Null rasterizer"};
+};
+
+} // namespace Vulkan
@@ -14,8 +14,6 @@
 #include "video_core/renderer_vulkan/vk_scheduler.h"
 #include "video_core/renderer_vulkan/vk_shader_util.h"
 
-extern std::unique_ptr<Vulkan::RendererVulkan> renderer;
-
 namespace Vulkan {
 
 using Shader::VsOutput;
@@ -24,6 +22,24 @@ using Shader::VsOutput;
     return seed ^ (hash + 0x9e3779b9 + (seed << 6) + (seed >> 2));
 }
 
+/// Returns a copy of a SPIR-V module with every resource binding decoration offset by base.
+std::vector<u32> RebaseBindings(std::span<const u32> spv, u32 base) {
+    static constexpr u32 HeaderWords = 5;
+    static constexpr u32 OpDecorate = 71;
+    static constexpr u32 DecorationBinding = 33;
+    std::vector<u32> code(spv.begin(), spv.end());
+    for (size_t i = HeaderWords; i < code.size();) {
+        const u32 word_count = code[i] >> 16;
+        const u32 opcode = code[i] & 0xffff;
+        ASSERT_MSG(word_count != 0 && i + word_count <= code.size(), "Malformed SPIR-V");
+        if (opcode == OpDecorate && word_count == 4 && code[i + 2] == DecorationBinding) {
+            code[i + 3] += base;
+        }
+        i += word_count;
+    }
+    return code;
+}
+
 void BuildVsOutputs(Shader::Info& info, const AmdGpu::Liverpool::VsOutputControl& ctl) {
     const auto add_output = [&](VsOutput x, VsOutput y, VsOutput z, VsOutput w) {
         if (x != VsOutput::None || y != VsOutput::None || z != VsOutput::None ||
@@ -110,16 +126,29 @@ Shader::Info MakeShaderInfo(Shader::Stage stage, std::span<const u32, 16> user_d
 
 PipelineCache::PipelineCache(const Instance& instance_, Scheduler& scheduler_,
                              AmdGpu::Liverpool* liverpool_)
-    : instance{instance_}, scheduler{scheduler_}, liverpool{liverpool_}, inst_pool{8192},
-      block_pool{512} {
-    pipeline_cache = instance.GetDevice().createPipelineCacheUnique({});
+    : instance{&instance_}, scheduler{&scheduler_}, liverpool{liverpool_} {
+    pipeline_cache = instance->GetDevice().createPipelineCacheUnique({});
     profile = Shader::Profile{
         .supported_spirv = 0x00010600U,
-        .subgroup_size = instance.SubgroupSize(),
+        .subgroup_size = instance->SubgroupSize(),
         .support_explicit_workgroup_layout = true,
     };
 }
 
+PipelineCache::PipelineCache(AmdGpu::Liverpool* liverpool_) : liverpool{liverpool_} {
+    // Without a device translate for the wave size of the guest GPU.
+    profile = Shader::Profile{
+        .supported_spirv = 0x00010600U,
+        .subgroup_size = 64,
+        .support_explicit_workgroup_layout = true,
+    };
+}
+
+const Program* PipelineCache::FindProgram(u64 hash) const {
+    const auto it = program_cache.find(hash);
+    return it != program_cache.end() ? it->second.get() : nullptr;
+}
+
 const GraphicsPipeline* PipelineCache::GetGraphicsPipeline() {
     // Tessellation is unsupported so skip the draw to avoid locking up the driver.
     if (liverpool->regs.primitive_type == Liverpool::PrimitiveType::PatchPrimitive) {
@@ -217,7 +246,6 @@ void PipelineCache::RefreshGraphicsKey() {
         }
         const auto base_format =
             LiverpoolToVK::SurfaceFormat(col_buf.info.format, col_buf.NumFormat());
-        const auto is_vo_surface = renderer->IsVideoOutSurface(col_buf);
         key.color_formats[remapped_cb] = LiverpoolToVK::AdjustColorBufferFormat(
             base_format, col_buf.info.comp_swap.Value(), false /*is_vo_surface*/);
         key.blend_controls[remapped_cb] = regs.blend_control[cb];
@@ -280,59 +308,65 @@ std::unique_ptr<GraphicsPipeline> PipelineCache::CreateGraphicsPipeline() {
             DumpShader(code, hash, stage, "bin");
         }
 
-        block_pool.ReleaseContents();
-        inst_pool.ReleaseContents();
-
         if (stage != Shader::Stage::Fragment && stage != Shader::Stage::Vertex) {
             LOG_ERROR(Render_Vulkan, "Unsupported shader stage {}. PL creation skipped.", stage);
             return {};
         }
 
-        const u64 lookup_hash = HashCombine(hash, binding);
-        auto it = program_cache.find(lookup_hash);
+        // Programs are translated with bindings starting at zero and are shared between
+        // pipelines regardless of where their resources land in the pipeline layout.
+        auto it = program_cache.find(hash);
         if (it != program_cache.end()) {
-            const Program* program = it.value().get();
+            Program* program = it.value().get();
             ASSERT(program->pgm.info.stage == stage);
             programs[i] = program;
-            binding = program->end_binding;
+            modules[i] = GetModule(*program, binding);
+            binding += program->num_bindings;
+            stats.Add(Counter::ProgramsReused);
             continue;
         }
 
         // Recompile shader to IR.
         try {
             auto program = std::make_unique<Program>();
-            block_pool.ReleaseContents();
-            inst_pool.ReleaseContents();
-
             LOG_INFO(Render_Vulkan, "Compiling {} shader {:#x}", stage, hash);
             Shader::Info info = MakeShaderInfo(stage, pgm->user_data, regs);
             info.pgm_base = pgm->Address<uintptr_t>();
             info.pgm_hash = hash;
             program->pgm =
-                Shader::TranslateProgram(inst_pool, block_pool, code, std::move(info), profile);
+                Shader::TranslateProgram(pools, pass_times, code, std::move(info), profile);
 
             // Compile IR to SPIR-V
-            program->spv = Shader::Backend::SPIRV::EmitSPIRV(profile, program->pgm, binding);
+            u32 num_bindings{};
+            program->spv = Shader::Backend::SPIRV::EmitSPIRV(profile, program->pgm, num_bindings);
             if (Config::dumpShaders()) {
                 DumpShader(program->spv, hash, stage, "spv");
             }
 
             // Compile module and set name to hash in renderdoc
-            program->end_binding = binding;
-            program->module = CompileSPV(program->spv, instance.GetDevice());
-            const auto name = fmt::format("{}_{:#x}", stage, hash);
-            Vulkan::SetObjectName(instance.GetDevice(), program->module, name);
+            program->num_bindings = num_bindings;
+            if (instance) {
+                program->module = CompileSPV(program->spv, instance->GetDevice());
+                const auto name = fmt::format("{}_{:#x}", stage, hash);
+                Vulkan::SetObjectName(instance->GetDevice(), program->module, name);
+            }
+            stats.Add(Counter::ProgramsTranslated);
 
             // Cache program
-            const auto [it, _] = program_cache.emplace(lookup_hash, std::move(program));
+            const auto [it, _] = program_cache.emplace(hash, std::move(program));
             programs[i] = it.value().get();
+            modules[i] = GetModule(*it.value(), binding);
+            binding += num_bindings;
         } catch (const Shader::Exception& e) {
             UNREACHABLE_MSG("{}", e.what());
         }
     }
 
-    return std::make_unique<GraphicsPipeline>(instance, scheduler, graphics_key, *pipeline_cache,
-                                              programs);
+    if (!instance) {
+        return {};
+    }
+    return std::make_unique<GraphicsPipeline>(*instance, *scheduler, graphics_key, *pipeline_cache,
+                                              programs, modules);
 }
 
 std::unique_ptr<ComputePipeline> PipelineCache::CreateComputePipeline() {
@@ -344,9 +378,6 @@ std::unique_ptr<ComputePipeline> PipelineCache::CreateComputePipeline() {
         DumpShader(code, compute_key, Shader::Stage::Compute, "bin");
     }
 
-    block_pool.ReleaseContents();
-    inst_pool.ReleaseContents();
-
     // Recompile shader to IR.
     try {
         auto program = std::make_unique<Program>();
@@ -356,30 +387,53 @@ std::unique_ptr<ComputePipeline> PipelineCache::CreateComputePipeline() {
         info.pgm_base = cs_pgm.Address<uintptr_t>();
         info.pgm_hash = compute_key;
         program->pgm =
-            Shader::TranslateProgram(inst_pool, block_pool, code, std::move(info), profile);
+            Shader::TranslateProgram(pools, pass_times, code, std::move(info), profile);
 
         // Compile IR to SPIR-V
         u32 binding{};
         program->spv = Shader::Backend::SPIRV::EmitSPIRV(profile, program->pgm, binding);
+        program->num_bindings = binding;
         if (Config::dumpShaders()) {
             DumpShader(program->spv, compute_key, Shader::Stage::Compute, "spv");
         }
 
         // Compile module and set name to hash in renderdoc
-        program->module = CompileSPV(program->spv, instance.GetDevice());
-        const auto name = fmt::format("cs_{:#x}", compute_key);
-        Vulkan::SetObjectName(instance.GetDevice(), program->module, name);
+        if (instance) {
+            program->module = CompileSPV(program->spv, instance->GetDevice());
+            const auto name = fmt::format("cs_{:#x}", compute_key);
+            Vulkan::SetObjectName(instance->GetDevice(), program->module, name);
+        }
+        stats.Add(Counter::ProgramsTranslated);
 
         // Cache program
         const auto [it, _] = program_cache.emplace(compute_key, std::move(program));
-        return std::make_unique<ComputePipeline>(instance, scheduler, *pipeline_cache, compute_key,
-                                                 it.value().get());
+        if (!instance) {
+            return nullptr;
+        }
+        return std::make_unique<ComputePipeline>(*instance, *scheduler, *pipeline_cache,
+                                                 compute_key, it.value().get());
     } catch (const Shader::Exception& e) {
         UNREACHABLE_MSG("{}", e.what());
         return nullptr;
     }
 }
 
+vk::ShaderModule PipelineCache::GetModule(Program& program, u32 binding_base) {
+    if (binding_base == 0 || !instance) {
+        return program.module;
+    }
+    auto [it, is_new] = program.rebased_modules.try_emplace(binding_base);
+    if (is_new) {
+        const auto code = RebaseBindings(program.spv, binding_base);
+        it.value() = CompileSPV(code, instance->GetDevice());
+        const auto& info = program.pgm.info;
+        const auto name = fmt::format("{}_{:#x}_b{}", info.stage, info.pgm_hash, binding_base);
+        Vulkan::SetObjectName(instance->GetDevice(), it.value(), name);
+        stats.Add(Counter::ModulesRebased);
+    }
+    return it.value();
+}
+
 void PipelineCache::DumpShader(std::span<const u32> code, u64 hash, Shader::Stage stage,
                                std::string_view ext) {
     using namespace Common::FS;
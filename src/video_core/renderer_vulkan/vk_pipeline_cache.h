@@ -4,9 +4,11 @@
 #pragma once
 
 #include <tsl/robin_map.h>
+#include "common/perf_stats.h"
 #include "shader_recompiler/ir/basic_block.h"
 #include "shader_recompiler/ir/program.h"
 #include "shader_recompiler/profile.h"
+#include "shader_recompiler/recompiler.h"
 #include "video_core/renderer_vulkan/vk_compute_pipeline.h"
 #include "video_core/renderer_vulkan/vk_graphics_pipeline.h"
 
@@ -25,22 +27,43 @@ class PipelineCache {
 public:
     explicit PipelineCache(const Instance& instance, Scheduler& scheduler,
                            AmdGpu::Liverpool* liverpool);
+    /// Creates a cache without a device. Programs are translated to SPIR-V and cached as usual,
+    /// but no modules or pipelines are created and the pipeline getters return null.
+    explicit PipelineCache(AmdGpu::Liverpool* liverpool);
     ~PipelineCache() = default;
 
     const GraphicsPipeline* GetGraphicsPipeline();
 
     const ComputePipeline* GetComputePipeline();
 
+    /// Returns the translated program with the given hash, or null if it was never translated.
+    [[nodiscard]] const Program* FindProgram(u64 hash) const;
+
+    [[nodiscard]] const GraphicsPipelineKey& GetGraphicsKey() const noexcept {
+        return graphics_key;
+    }
+
+    [[nodiscard]] u64 GetComputeKey() const noexcept {
+        return compute_key;
+    }
+
 private:
     void RefreshGraphicsKey();
     void DumpShader(std::span<const u32> code, u64 hash, Shader::Stage stage, std::string_view ext);
+    vk::ShaderModule GetModule(Program& program, u32 binding_base);
 
     std::unique_ptr<GraphicsPipeline> CreateGraphicsPipeline();
     std::unique_ptr<ComputePipeline> CreateComputePipeline();
 
 private:
-    const Instance& instance;
-    Scheduler& scheduler;
+    enum class Counter : u32 {
+        ProgramsTranslated,
+        ProgramsReused,
+        ModulesRebased,
+    };
+
+    const Instance* instance{};
+    Scheduler* scheduler{};
     AmdGpu::Liverpool* liverpool;
     vk::UniquePipelineCache pipeline_cache;
     vk::UniquePipelineLayout pipeline_layout;
@@ -48,11 +71,13 @@ private:
     tsl::robin_map<size_t, std::unique_ptr<ComputePipeline>> compute_pipelines;
     tsl::robin_map<GraphicsPipelineKey, std::unique_ptr<GraphicsPipeline>> graphics_pipelines;
     std::array<const Program*, MaxShaderStages> programs{};
+    std::array<vk::ShaderModule, MaxShaderStages> modules{};
     Shader::Profile profile{};
     GraphicsPipelineKey graphics_key{};
     u64 compute_key{};
-    Common::ObjectPool<Shader::IR::Inst> inst_pool;
-    Common::ObjectPool<Shader::IR::Block> block_pool;
+    Shader::Pools pools;
+    Shader::PassTimes pass_times{Common::Log::Class::Render_Vulkan, "Shader pass times (ns)"};
+    Common::PerfStats<Counter> stats{Common::Log::Class::Render_Vulkan, "Shader programs"};
 };
 
 } // namespace Vulkan
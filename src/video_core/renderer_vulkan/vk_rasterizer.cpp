@@ -20,9 +20,7 @@ Rasterizer::Rasterizer(const Instance& instance_, Scheduler& scheduler_,
       buffer_cache{instance, scheduler, liverpool_, page_manager},
       texture_cache{instance, scheduler, buffer_cache, page_manager}, liverpool{liverpool_},
       memory{Core::Memory::Instance()}, pipeline_cache{instance, scheduler, liverpool} {
-    if (!Config::nullGpu()) {
-        liverpool->BindRasterizer(this);
-    }
+    liverpool->BindRasterizer(this);
     memory->SetRasterizer(this);
     wfi_event = instance.GetDevice().createEventUnique({});
 }
@@ -39,16 +37,18 @@ void Rasterizer::Draw(bool is_indexed, u32 index_offset) {
         return;
     }
 
+    // Index conversion may record a compute dispatch with its own push constants and push
+    // descriptors, so it has to happen before the graphics ones are pushed.
+    const auto& vs_info = pipeline->GetStage(Shader::Stage::Vertex);
+    buffer_cache.BindVertexBuffers(vs_info);
+    const u32 num_indices = buffer_cache.BindIndexBuffer(is_indexed, index_offset);
+
     try {
         pipeline->BindResources(regs, buffer_cache, texture_cache);
     } catch (...) {
         UNREACHABLE();
     }
 
-    const auto& vs_info = pipeline->GetStage(Shader::Stage::Vertex);
-    buffer_cache.BindVertexBuffers(vs_info);
-    const u32 num_indices = buffer_cache.BindIndexBuffer(is_indexed, index_offset);
-
     BeginRendering();
     UpdateDynamicState(*pipeline);
 
@@ -81,22 +81,38 @@ void Rasterizer::DispatchDirect() {
         UNREACHABLE();
     }
 
-    scheduler.EndRendering();
+    scheduler.EndRendering(RenderBreak::Dispatch);
+    scheduler.FlushBarriers();
     cmdbuf.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline->Handle());
     cmdbuf.dispatch(cs_program.dim_x, cs_program.dim_y, cs_program.dim_z);
 }
 
 u64 Rasterizer::Flush() {
+    if (!pending_fences.empty()) {
+        for (auto& signal : pending_fences) {
+            scheduler.DeferCompletion(std::move(signal));
+        }
+        pending_fences.clear();
+    }
     const u64 current_tick = scheduler.CurrentTick();
     SubmitInfo info{};
     scheduler.Flush(info);
     return current_tick;
 }
 
+void Rasterizer::EndFrame() {
+    buffer_cache.NextFrame();
+    Flush();
+}
+
 void Rasterizer::BeginRendering() {
     const auto& regs = liverpool->regs;
     RenderState state;
 
+    // Attachments of a pass are expected to share a scale, use the smallest one if they don't
+    // so the scaled viewport stays inside the render area.
+    render_scale = std::numeric_limits<float>::max();
+
     for (auto col_buf_id = 0u; col_buf_id < Liverpool::NumColorBuffers; ++col_buf_id) {
         const auto& col_buf = regs.color_buffers[col_buf_id];
         if (!col_buf) {
@@ -114,11 +130,15 @@ void Rasterizer::BeginRendering() {
         VideoCore::ImageViewInfo view_info{col_buf, false /*!!image.info.usage.vo_buffer*/};
         const auto& image_view = texture_cache.FindRenderTarget(image_info, view_info);
         const auto& image = texture_cache.GetImage(image_view.image_id);
-        state.width = std::min<u32>(state.width, image.info.size.width);
-        state.height = std::min<u32>(state.height, image.info.size.height);
+        const auto extent = image.info.ScaledSize();
+        state.width = std::min<u32>(state.width, extent.width);
+        state.height = std::min<u32>(state.height, extent.height);
+        render_scale = std::min(render_scale, image.info.resolution_scale);
 
         const bool is_clear = texture_cache.IsMetaCleared(col_buf.CmaskAddress());
         state.color_images[state.num_color_attachments] = image.image;
+        state.color_ranges[state.num_color_attachments] =
+            image.GetSubresourceRange(image_view.info.range);
         state.color_attachments[state.num_color_attachments++] = {
             .imageView = *image_view.image_view,
             .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
@@ -145,9 +165,12 @@ void Rasterizer::BeginRendering() {
         VideoCore::ImageViewInfo view_info{regs.depth_buffer, regs.depth_view, regs.depth_control};
         const auto& image_view = texture_cache.FindDepthTarget(image_info, view_info);
         const auto& image = texture_cache.GetImage(image_view.image_id);
-        state.width = std::min<u32>(state.width, image.info.size.width);
-        state.height = std::min<u32>(state.height, image.info.size.height);
+        const auto extent = image.info.ScaledSize();
+        state.width = std::min<u32>(state.width, extent.width);
+        state.height = std::min<u32>(state.height, extent.height);
+        render_scale = std::min(render_scale, image.info.resolution_scale);
         state.depth_image = image.image;
+        state.depth_range = image.GetSubresourceRange(image_view.info.range);
         state.depth_attachment = {
             .imageView = *image_view.image_view,
             .imageLayout = image.layout,
@@ -162,12 +185,20 @@ void Rasterizer::BeginRendering() {
         state.has_stencil = regs.depth_buffer.stencil_info.format !=
                             AmdGpu::Liverpool::DepthBuffer::StencilFormat::Invalid;
     }
+    if (render_scale == std::numeric_limits<float>::max()) {
+        render_scale = 1.0f;
+    }
     scheduler.BeginRendering(state);
 }
 
 void Rasterizer::InvalidateMemory(VAddr addr, u64 size) {
     buffer_cache.InvalidateMemory(addr, size);
     texture_cache.InvalidateMemory(addr, size);
+    page_manager.OnCpuWrite(addr, size);
+}
+
+void Rasterizer::ReadLabel(VAddr addr, u64 size) {
+    buffer_cache.ReadLabel(addr, size);
 }
 
 void Rasterizer::MapMemory(VAddr addr, u64 size) {
@@ -175,11 +206,34 @@ void Rasterizer::MapMemory(VAddr addr, u64 size) {
 }
 
 void Rasterizer::UnmapMemory(VAddr addr, u64 size) {
-    buffer_cache.InvalidateMemory(addr, size);
+    buffer_cache.InvalidateMemory(addr, size, true);
     texture_cache.UnmapMemory(addr, size);
     page_manager.OnGpuUnmap(addr, size);
 }
 
+void Rasterizer::SignalFence(Common::UniqueFunction<void>&& signal) {
+    // Signalled with the next submission, so the fences of a command buffer share one submit.
+    pending_fences.emplace_back(std::move(signal));
+}
+
+void Rasterizer::FlushFences() {
+    if (!pending_fences.empty()) {
+        Flush();
+    }
+}
+
+void Rasterizer::InlineData(VAddr address, const void* value, u32 num_bytes, bool is_gds) {
+    buffer_cache.InlineData(address, value, num_bytes, is_gds);
+}
+
+void Rasterizer::FillBuffer(VAddr address, u32 num_bytes, u32 value, bool is_gds) {
+    buffer_cache.FillBuffer(address, num_bytes, value, is_gds);
+}
+
+void Rasterizer::CopyBuffer(VAddr dst, VAddr src, u32 num_bytes, bool dst_gds, bool src_gds) {
+    buffer_cache.CopyBuffer(dst, src, num_bytes, dst_gds, src_gds);
+}
+
 void Rasterizer::UpdateDynamicState(const GraphicsPipeline& pipeline) {
     UpdateViewportScissorState();
 
@@ -213,18 +267,20 @@ void Rasterizer::UpdateViewportScissorState() {
             continue;
         }
         viewports.push_back({
-            .x = vp.xoffset - vp.xscale,
-            .y = vp.yoffset - vp.yscale,
-            .width = vp.xscale * 2.0f,
-            .height = vp.yscale * 2.0f,
+            .x = (vp.xoffset - vp.xscale) * render_scale,
+            .y = (vp.yoffset - vp.yscale) * render_scale,
+            .width = vp.xscale * 2.0f * render_scale,
+            .height = vp.yscale * 2.0f * render_scale,
             .minDepth = vp.zoffset - vp.zscale * reduce_z,
             .maxDepth = vp.zscale + vp.zoffset,
         });
     }
     const auto& sc = regs.screen_scissor;
     scissors.push_back({
-        .offset = {sc.top_left_x, sc.top_left_y},
-        .extent = {sc.GetWidth(), sc.GetHeight()},
+        .offset = {static_cast<s32>(sc.top_left_x * render_scale),
+                   static_cast<s32>(sc.top_left_y * render_scale)},
+        .extent = {static_cast<u32>(sc.GetWidth() * render_scale),
+                   static_cast<u32>(sc.GetHeight() * render_scale)},
     });
     const auto cmdbuf = scheduler.CommandBuffer();
     cmdbuf.setViewport(0, viewports);
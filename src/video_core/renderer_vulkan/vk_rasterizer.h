@@ -31,6 +31,10 @@ public:
         return texture_cache;
     }
 
+    [[nodiscard]] VideoCore::PageManager& GetPageManager() noexcept {
+        return page_manager;
+    }
+
     void Draw(bool is_indexed, u32 index_offset = 0);
 
     void DispatchDirect();
@@ -41,11 +45,23 @@ public:
     void Breadcrumb(u64 id);
 
     void InvalidateMemory(VAddr addr, u64 size);
+    void ReadLabel(VAddr addr, u64 size);
     void MapMemory(VAddr addr, u64 size);
     void UnmapMemory(VAddr addr, u64 size);
+    void SignalFence(Common::UniqueFunction<void>&& signal);
+
+    /// Submits the recorded work if a fence is waiting on it.
+    void FlushFences();
+
+    void InlineData(VAddr address, const void* value, u32 num_bytes, bool is_gds);
+    void FillBuffer(VAddr address, u32 num_bytes, u32 value, bool is_gds);
+    void CopyBuffer(VAddr dst, VAddr src, u32 num_bytes, bool dst_gds, bool src_gds);
 
     u64 Flush();
 
+    /// Called once the guest submitted a whole frame, recycles the per-frame upload space.
+    void EndFrame();
+
 private:
     void BeginRendering();
 
@@ -63,6 +79,8 @@ private:
     Core::MemoryManager* memory;
     PipelineCache pipeline_cache;
     vk::UniqueEvent wfi_event;
+    float render_scale{1.0f}; ///< Resolution scale of the current render targets.
+    std::vector<Common::UniqueFunction<void>> pending_fences;
 };
 
 } // namespace Vulkan
@@ -4,6 +4,8 @@
 #include <mutex>
 #include "common/assert.h"
 #include "common/debug.h"
+#include "common/logging/log.h"
+#include "common/thread.h"
 #include "video_core/renderer_vulkan/vk_instance.h"
 #include "video_core/renderer_vulkan/vk_scheduler.h"
 
@@ -15,17 +17,22 @@ Scheduler::Scheduler(const Instance& instance)
     : instance{instance}, master_semaphore{instance}, command_pool{instance, &master_semaphore} {
     profiler_scope = reinterpret_cast<tracy::VkCtxScope*>(std::malloc(sizeof(tracy::VkCtxScope)));
     AllocateWorkerCommandBuffers();
+    completion_thread =
+        std::jthread([this](std::stop_token stop_token) { CompletionThread(stop_token); });
 }
 
 Scheduler::~Scheduler() {
+    WaitCompletions();
     std::free(profiler_scope);
 }
 
 void Scheduler::BeginRendering(const RenderState& new_state) {
-    if (is_rendering && render_state == new_state) {
+    if (is_rendering && render_state == new_state && pending_barriers.empty()) {
+        pass_stats.Add(PassCounter::Merged);
         return;
     }
-    EndRendering();
+    FlushBarriers();
+    EndRendering(RenderBreak::NewPass);
     is_rendering = true;
     render_state = new_state;
 
@@ -50,13 +57,15 @@ void Scheduler::BeginRendering(const RenderState& new_state) {
     };
 
     current_cmdbuf.beginRendering(rendering_info);
+    pass_stats.Add(PassCounter::Passes);
 }
 
-void Scheduler::EndRendering() {
+void Scheduler::EndRendering(RenderBreak cause) {
     if (!is_rendering) {
         return;
     }
     is_rendering = false;
+    break_stats.Add(cause);
     current_cmdbuf.endRendering();
 
     boost::container::static_vector<vk::ImageMemoryBarrier, 9> barriers;
@@ -69,14 +78,7 @@ void Scheduler::EndRendering() {
             .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
             .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
             .image = render_state.color_images[i],
-            .subresourceRange =
-                {
-                    .aspectMask = vk::ImageAspectFlagBits::eColor,
-                    .baseMipLevel = 0,
-                    .levelCount = VK_REMAINING_MIP_LEVELS,
-                    .baseArrayLayer = 0,
-                    .layerCount = VK_REMAINING_ARRAY_LAYERS,
-                },
+            .subresourceRange = render_state.color_ranges[i],
         });
     }
     if (render_state.has_depth || render_state.has_stencil) {
@@ -88,16 +90,7 @@ void Scheduler::EndRendering() {
             .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
             .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
             .image = render_state.depth_image,
-            .subresourceRange =
-                {
-                    .aspectMask = vk::ImageAspectFlagBits::eDepth |
-                                  (render_state.has_stencil ? vk::ImageAspectFlagBits::eStencil
-                                                            : vk::ImageAspectFlagBits::eNone),
-                    .baseMipLevel = 0,
-                    .levelCount = VK_REMAINING_MIP_LEVELS,
-                    .baseArrayLayer = 0,
-                    .layerCount = VK_REMAINING_ARRAY_LAYERS,
-                },
+            .subresourceRange = render_state.depth_range,
         });
     }
 
@@ -112,6 +105,58 @@ void Scheduler::EndRendering() {
     }
 }
 
+void Scheduler::PushImageBarrier(const vk::ImageMemoryBarrier2& barrier) {
+    const auto overlaps = [](const vk::ImageSubresourceRange& a,
+                             const vk::ImageSubresourceRange& b) {
+        return (a.aspectMask & b.aspectMask) && a.baseMipLevel < b.baseMipLevel + b.levelCount &&
+               b.baseMipLevel < a.baseMipLevel + a.levelCount &&
+               a.baseArrayLayer < b.baseArrayLayer + b.layerCount &&
+               b.baseArrayLayer < a.baseArrayLayer + a.layerCount;
+    };
+    barrier_stats.Add(BarrierCounter::Transitions);
+    for (auto& pending : pending_barriers) {
+        if (pending.image != barrier.image ||
+            !overlaps(pending.subresourceRange, barrier.subresourceRange)) {
+            continue;
+        }
+        if (pending.subresourceRange == barrier.subresourceRange) {
+            // Barriers in one batch are unordered, fold consecutive transitions into one.
+            pending.dstStageMask = barrier.dstStageMask;
+            pending.dstAccessMask = barrier.dstAccessMask;
+            pending.newLayout = barrier.newLayout;
+            return;
+        }
+        FlushBarriers();
+        break;
+    }
+    pending_barriers.push_back(barrier);
+}
+
+void Scheduler::FlushBarriers() {
+    if (pending_barriers.empty()) {
+        return;
+    }
+    EndRendering(RenderBreak::Barrier);
+    current_cmdbuf.pipelineBarrier2(vk::DependencyInfo{
+        .dependencyFlags = vk::DependencyFlagBits::eByRegion,
+        .imageMemoryBarrierCount = static_cast<u32>(pending_barriers.size()),
+        .pImageMemoryBarriers = pending_barriers.data(),
+    });
+    barrier_stats.Add(BarrierCounter::PipelineBarriers);
+    pending_barriers.clear();
+}
+
+vk::CommandBuffer Scheduler::UploadCommandBuffer() {
+    if (!upload_cmdbuf) {
+        upload_cmdbuf = command_pool.Commit();
+        upload_cmdbuf.begin(vk::CommandBufferBeginInfo{
+            .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+        });
+    }
+    pass_stats.Add(PassCounter::HoistedUploads);
+    return upload_cmdbuf;
+}
+
 void Scheduler::Flush(SubmitInfo& info) {
     // When flushing, we only send data to the driver; no waiting is necessary.
     SubmitExecution(info);
@@ -134,6 +179,51 @@ void Scheduler::Wait(u64 tick) {
     master_semaphore.Wait(tick);
 }
 
+void Scheduler::DeferCompletion(Common::UniqueFunction<void>&& func) {
+    std::scoped_lock lk{completion_mutex};
+    completion_ops.emplace(std::move(func), CurrentTick());
+    completion_cv.notify_all();
+}
+
+void Scheduler::WaitCompletions() {
+    ASSERT_MSG(!IsCompletionThread(), "Waiting for completions from a completion");
+    std::unique_lock lk{completion_mutex};
+    if (completion_ops.empty()) {
+        return;
+    }
+    if (completion_ops.back().gpu_tick >= CurrentTick()) {
+        lk.unlock();
+        SubmitInfo info{};
+        Flush(info);
+        lk.lock();
+    }
+    completion_cv.wait(lk, [this] { return completion_ops.empty(); });
+}
+
+void Scheduler::CompletionThread(std::stop_token stop_token) {
+    Common::SetCurrentThreadName("shadPS4:GpuCompletion");
+    while (true) {
+        PendingOp* op{};
+        {
+            std::unique_lock lk{completion_mutex};
+            Common::CondvarWait(completion_cv, lk, stop_token,
+                                [this] { return !completion_ops.empty(); });
+            if (completion_ops.empty()) {
+                return;
+            }
+            // Only this thread pops operations, so the reference stays valid after unlocking.
+            op = &completion_ops.front();
+        }
+
+        master_semaphore.Wait(op->gpu_tick);
+        op->callback();
+
+        std::scoped_lock lk{completion_mutex};
+        completion_ops.pop();
+        completion_cv.notify_all();
+    }
+}
+
 void Scheduler::AllocateWorkerCommandBuffers() {
     const vk::CommandBufferBeginInfo begin_info = {
         .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
@@ -160,8 +250,18 @@ void Scheduler::SubmitExecution(SubmitInfo& info) {
         TracyVkCollect(profiler_ctx, current_cmdbuf);
     }
 
-    EndRendering();
+    FlushBarriers();
+    EndRendering(RenderBreak::Submit);
     current_cmdbuf.end();
+    barrier_stats.Add(BarrierCounter::Submits);
+
+    boost::container::static_vector<vk::CommandBuffer, 2> cmdbufs;
+    if (upload_cmdbuf) {
+        upload_cmdbuf.end();
+        cmdbufs.push_back(upload_cmdbuf);
+        upload_cmdbuf = vk::CommandBuffer{};
+    }
+    cmdbufs.push_back(current_cmdbuf);
 
     const vk::Semaphore timeline = master_semaphore.Handle();
     info.AddSignal(timeline, signal_value);
@@ -183,8 +283,8 @@ void Scheduler::SubmitExecution(SubmitInfo& info) {
         .waitSemaphoreCount = static_cast<u32>(info.wait_semas.size()),
         .pWaitSemaphores = info.wait_semas.data(),
         .pWaitDstStageMask = wait_stage_masks.data(),
-        .commandBufferCount = 1U,
-        .pCommandBuffers = &current_cmdbuf,
+        .commandBufferCount = static_cast<u32>(cmdbufs.size()),
+        .pCommandBuffers = cmdbufs.data(),
         .signalSemaphoreCount = static_cast<u32>(info.signal_semas.size()),
         .pSignalSemaphores = info.signal_semas.data(),
     };
@@ -4,7 +4,12 @@
 #pragma once
 
 #include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <boost/container/small_vector.hpp>
 #include <boost/container/static_vector.hpp>
+#include "common/perf_stats.h"
+#include "common/polyfill_thread.h"
 #include "common/types.h"
 #include "common/unique_function.h"
 #include "video_core/renderer_vulkan/vk_master_semaphore.h"
@@ -14,11 +19,25 @@ namespace Vulkan {
 
 class Instance;
 
+/// Reasons for ending a rendering scope, counted to find what splits render passes.
+enum class RenderBreak : u32 {
+    NewPass,  ///< A rendering scope with different attachments was started.
+    Barrier,  ///< Queued image barriers were recorded.
+    Dispatch, ///< A compute dispatch was recorded.
+    Upload,   ///< Guest memory was uploaded to a resource used by the current command buffer.
+    Transfer, ///< A buffer copy, fill or inline update was recorded.
+    Download, ///< GPU modified memory was copied back for readback.
+    Present,  ///< A frame was copied to the swapchain.
+    Submit,   ///< The command buffer was submitted.
+};
+
 struct RenderState {
     std::array<vk::RenderingAttachmentInfo, 8> color_attachments{};
     std::array<vk::Image, 8> color_images{};
+    std::array<vk::ImageSubresourceRange, 8> color_ranges{};
     vk::RenderingAttachmentInfo depth_attachment{};
     vk::Image depth_image{};
+    vk::ImageSubresourceRange depth_range{};
     u32 num_color_attachments{};
     bool has_depth{};
     bool has_stencil{};
@@ -70,8 +89,15 @@ public:
     /// Starts a new rendering scope with provided state.
     void BeginRendering(const RenderState& new_state);
 
-    /// Ends current rendering scope.
-    void EndRendering();
+    /// Ends current rendering scope, if any, accounting it to the given cause.
+    void EndRendering(RenderBreak cause);
+
+    /// Queues an image barrier. Queued barriers are merged into a single pipeline barrier,
+    /// recorded outside of rendering before the next render pass, dispatch or submission.
+    void PushImageBarrier(const vk::ImageMemoryBarrier2& barrier);
+
+    /// Records all queued barriers, ending the current rendering scope if there are any.
+    void FlushBarriers();
 
     /// Returns the current render state.
     const RenderState& GetRenderState() const {
@@ -83,6 +109,12 @@ public:
         return current_cmdbuf;
     }
 
+    /// Returns a command buffer that executes right before the current one in the same
+    /// submission. Recording into it does not interrupt the active rendering scope, but the
+    /// work is hoisted ahead of everything already recorded in the current command buffer,
+    /// so it must only access resources that none of those commands touch.
+    vk::CommandBuffer UploadCommandBuffer();
+
     /// Returns the current command buffer tick.
     [[nodiscard]] u64 CurrentTick() const noexcept {
         return master_semaphore.CurrentTick();
@@ -103,6 +135,18 @@ public:
         pending_ops.emplace(std::move(func), CurrentTick());
     }
 
+    /// Runs an operation on the completion thread once the gpu has reached the current cpu tick.
+    /// Operations complete in the order they were deferred, the caller must flush the tick.
+    void DeferCompletion(Common::UniqueFunction<void>&& func);
+
+    /// Flushes any deferred completion and blocks until all of them have run.
+    void WaitCompletions();
+
+    /// Returns true when called from inside a deferred completion.
+    [[nodiscard]] bool IsCompletionThread() const noexcept {
+        return std::this_thread::get_id() == completion_thread.get_id();
+    }
+
     static std::mutex submit_mutex;
 
 private:
@@ -110,20 +154,43 @@ private:
 
     void SubmitExecution(SubmitInfo& info);
 
+    void CompletionThread(std::stop_token stop_token);
+
 private:
     const Instance& instance;
     MasterSemaphore master_semaphore;
     CommandPool command_pool;
     vk::CommandBuffer current_cmdbuf;
+    vk::CommandBuffer upload_cmdbuf;
     std::condition_variable_any event_cv;
     struct PendingOp {
         Common::UniqueFunction<void> callback;
         u64 gpu_tick;
     };
     std::queue<PendingOp> pending_ops;
+    std::mutex completion_mutex;
+    std::condition_variable_any completion_cv;
+    std::queue<PendingOp> completion_ops;
     RenderState render_state;
     bool is_rendering = false;
+    boost::container::small_vector<vk::ImageMemoryBarrier2, 16> pending_barriers;
+    enum class BarrierCounter : u32 {
+        Transitions,
+        PipelineBarriers,
+        Submits,
+    };
+    Common::PerfStats<BarrierCounter> barrier_stats{Common::Log::Class::Render_Vulkan,
+                                                    "Image barriers"};
+    enum class PassCounter : u32 {
+        Passes,
+        Merged,
+        HoistedUploads,
+    };
+    Common::PerfStats<PassCounter> pass_stats{Common::Log::Class::Render_Vulkan, "Render passes"};
+    Common::PerfStats<RenderBreak> break_stats{Common::Log::Class::Render_Vulkan,
+                                               "Render pass breaks"};
     tracy::VkCtxScope* profiler_scope{};
+    std::jthread completion_thread;
 };
 
 } // namespace Vulkan
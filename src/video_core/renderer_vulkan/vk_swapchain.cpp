@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <limits>
 #include "common/assert.h"
+#include "common/config.h"
 #include "common/logging/log.h"
 #include "sdl_window.h"
 #include "video_core/renderer_vulkan/vk_instance.h"
@@ -11,6 +12,22 @@
 
 namespace Vulkan {
 
+static vk::PresentModeKHR ParsePresentMode(std::string_view mode) {
+    if (mode == "Fifo") {
+        return vk::PresentModeKHR::eFifo;
+    }
+    if (mode == "FifoRelaxed") {
+        return vk::PresentModeKHR::eFifoRelaxed;
+    }
+    if (mode == "Immediate") {
+        return vk::PresentModeKHR::eImmediate;
+    }
+    if (mode != "Mailbox") {
+        LOG_WARNING(Render_Vulkan, "Unknown present mode {}, using Mailbox", mode);
+    }
+    return vk::PresentModeKHR::eMailbox;
+}
+
 Swapchain::Swapchain(const Instance& instance_, const Frontend::WindowSDL& window)
     : instance{instance_}, surface{CreateSurface(instance.GetInstance(), window)} {
     FindPresentFormat();
@@ -37,15 +54,7 @@ void Swapchain::Create(u32 width_, u32 height_, vk::SurfaceKHR surface_) {
         instance.GetPresentQueueFamilyIndex(),
     };
 
-    const auto modes = instance.GetPhysicalDevice().getSurfacePresentModesKHR(surface);
-    const auto find_mode = [&modes](vk::PresentModeKHR requested) {
-        const auto it =
-            std::find_if(modes.begin(), modes.end(),
-                         [&requested](vk::PresentModeKHR mode) { return mode == requested; });
-
-        return it != modes.end();
-    };
-    const bool has_mailbox = find_mode(vk::PresentModeKHR::eMailbox);
+    SelectPresentMode();
 
     const bool exclusive = queue_family_indices[0] == queue_family_indices[1];
     const u32 queue_family_indices_count = exclusive ? 1u : 2u;
@@ -65,7 +74,7 @@ void Swapchain::Create(u32 width_, u32 height_, vk::SurfaceKHR surface_) {
         .pQueueFamilyIndices = queue_family_indices.data(),
         .preTransform = transform,
         .compositeAlpha = composite_alpha,
-        .presentMode = has_mailbox ? vk::PresentModeKHR::eMailbox : vk::PresentModeKHR::eImmediate,
+        .presentMode = present_mode,
         .clipped = true,
         .oldSwapchain = nullptr,
     };
@@ -157,6 +166,35 @@ void Swapchain::FindPresentFormat() {
     UNREACHABLE_MSG("Unable to find required swapchain format!");
 }
 
+void Swapchain::SelectPresentMode() {
+    const auto modes = instance.GetPhysicalDevice().getSurfacePresentModesKHR(surface);
+    const auto has_mode = [&modes](vk::PresentModeKHR mode) {
+        return std::ranges::find(modes, mode) != modes.end();
+    };
+
+    // Fall back to the closest mode in latency, FIFO is the only one guaranteed to exist.
+    const vk::PresentModeKHR requested = ParsePresentMode(Config::getPresentMode());
+    std::array<vk::PresentModeKHR, 3> candidates{};
+    switch (requested) {
+    case vk::PresentModeKHR::eImmediate:
+    case vk::PresentModeKHR::eMailbox:
+        candidates = {requested,
+                      requested == vk::PresentModeKHR::eMailbox ? vk::PresentModeKHR::eImmediate
+                                                                : vk::PresentModeKHR::eMailbox,
+                      vk::PresentModeKHR::eFifoRelaxed};
+        break;
+    default:
+        candidates = {requested, vk::PresentModeKHR::eFifo, vk::PresentModeKHR::eFifo};
+        break;
+    }
+    const auto it = std::ranges::find_if(candidates, has_mode);
+    present_mode = it != candidates.end() ? *it : vk::PresentModeKHR::eFifo;
+    if (present_mode != requested) {
+        LOG_WARNING(Render_Vulkan, "Present mode {} is not supported, using {}",
+                    vk::to_string(requested), vk::to_string(present_mode));
+    }
+}
+
 void Swapchain::SetSurfaceProperties() {
     const vk::SurfaceCapabilitiesKHR capabilities =
         instance.GetPhysicalDevice().getSurfaceCapabilitiesKHR(surface);
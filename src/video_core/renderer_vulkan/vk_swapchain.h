@@ -67,6 +67,10 @@ public:
         return extent;
     }
 
+    vk::PresentModeKHR GetPresentMode() const {
+        return present_mode;
+    }
+
     [[nodiscard]] vk::Semaphore GetImageAcquiredSemaphore() const {
         return image_acquired[frame_index];
     }
@@ -79,6 +83,9 @@ private:
     /// Selects the best available swapchain image format
     void FindPresentFormat();
 
+    /// Selects the configured present mode or the closest one the surface supports
+    void SelectPresentMode();
+
     /// Sets the surface properties according to device capabilities
     void SetSurfaceProperties();
 
@@ -99,6 +106,7 @@ private:
     vk::Extent2D extent;
     vk::SurfaceTransformFlagBitsKHR transform;
     vk::CompositeAlphaFlagBitsKHR composite_alpha;
+    vk::PresentModeKHR present_mode = vk::PresentModeKHR::eFifo;
     std::vector<vk::Image> images;
     std::vector<vk::Semaphore> image_acquired;
     std::vector<vk::Semaphore> present_ready;
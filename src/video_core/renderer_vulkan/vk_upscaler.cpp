@@ -0,0 +1,223 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <cmath>
+#include "common/assert.h"
+#include "common/div_ceil.h"
+#include "video_core/host_shaders/fsr_easu_comp.h"
+#include "video_core/host_shaders/fsr_rcas_comp.h"
+#include "video_core/renderer_vulkan/vk_instance.h"
+#include "video_core/renderer_vulkan/vk_shader_util.h"
+#include "video_core/renderer_vulkan/vk_upscaler.h"
+
+#include <vk_mem_alloc.h>
+
+namespace Vulkan {
+
+/// Sharpening strength in stops, where 0 is the strongest. Matches the FSR default.
+static constexpr float SharpnessStops = 0.2f;
+
+Upscaler::Upscaler(const Instance& instance_) : instance{instance_} {
+    const auto device = instance.GetDevice();
+    const std::array<vk::DescriptorSetLayoutBinding, 2> bindings{{
+        {
+            .binding = 0,
+            .descriptorType = vk::DescriptorType::eStorageImage,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eCompute,
+        },
+        {
+            .binding = 1,
+            .descriptorType = vk::DescriptorType::eStorageImage,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eCompute,
+        },
+    }};
+    desc_layout = device.createDescriptorSetLayoutUnique({
+        .flags = vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR,
+        .bindingCount = static_cast<u32>(bindings.size()),
+        .pBindings = bindings.data(),
+    });
+
+    const vk::PushConstantRange push_constants = {
+        .stageFlags = vk::ShaderStageFlagBits::eCompute,
+        .offset = 0,
+        .size = sizeof(PushConstants),
+    };
+    const vk::DescriptorSetLayout set_layout = *desc_layout;
+    pl_layout = device.createPipelineLayoutUnique({
+        .setLayoutCount = 1U,
+        .pSetLayouts = &set_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constants,
+    });
+
+    const auto create_pipeline = [&](std::string_view code, const char* name) {
+        const auto module = Compile(code, vk::ShaderStageFlagBits::eCompute, device);
+        SetObjectName(device, module, name);
+        const vk::ComputePipelineCreateInfo compute_pipeline_ci = {
+            .stage =
+                {
+                    .stage = vk::ShaderStageFlagBits::eCompute,
+                    .module = module,
+                    .pName = "main",
+                },
+            .layout = *pl_layout,
+        };
+        auto result = device.createComputePipelineUnique({}, compute_pipeline_ci);
+        ASSERT_MSG(result.result == vk::Result::eSuccess, "{} pipeline creation failed", name);
+        device.destroyShaderModule(module);
+        return std::move(result.value);
+    };
+    easu_pipeline = create_pipeline(HostShaders::FSR_EASU_COMP, "FsrEasu");
+    rcas_pipeline = create_pipeline(HostShaders::FSR_RCAS_COMP, "FsrRcas");
+}
+
+Upscaler::~Upscaler() = default;
+
+void Upscaler::Resize(UpscalerImage& image, vk::Extent2D extent) const {
+    if (image.image && image.extent == extent) {
+        return;
+    }
+    Destroy(image);
+
+    const vk::ImageCreateInfo image_info = {
+        .imageType = vk::ImageType::e2D,
+        .format = Format,
+        .extent = {extent.width, extent.height, 1},
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = vk::SampleCountFlagBits::e1,
+        .usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferDst,
+    };
+    const VmaAllocationCreateInfo alloc_info = {
+        .flags = VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT,
+        .usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+        .requiredFlags = 0,
+        .preferredFlags = 0,
+        .pool = VK_NULL_HANDLE,
+        .pUserData = nullptr,
+    };
+
+    VkImage unsafe_image{};
+    VkImageCreateInfo unsafe_image_info = static_cast<VkImageCreateInfo>(image_info);
+    VkResult result = vmaCreateImage(instance.GetAllocator(), &unsafe_image_info, &alloc_info,
+                                     &unsafe_image, &image.allocation, nullptr);
+    ASSERT_MSG(result == VK_SUCCESS, "Failed allocating upscaler image with error {}",
+               vk::to_string(vk::Result{result}));
+    image.image = vk::Image{unsafe_image};
+    image.extent = extent;
+
+    const vk::ImageViewCreateInfo view_info = {
+        .image = image.image,
+        .viewType = vk::ImageViewType::e2D,
+        .format = Format,
+        .subresourceRange{
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+    };
+    image.view = instance.GetDevice().createImageView(view_info);
+}
+
+void Upscaler::Destroy(UpscalerImage& image) const {
+    if (!image.image) {
+        return;
+    }
+    instance.GetDevice().destroyImageView(image.view);
+    vmaDestroyImage(instance.GetAllocator(), image.image, image.allocation);
+    image = {};
+}
+
+void Upscaler::Render(vk::CommandBuffer cmdbuf, const UpscalerImage& input,
+                      const UpscalerImage& intermediate, vk::Image output,
+                      vk::ImageView output_view) const {
+    const auto make_barrier = [](vk::Image image, vk::AccessFlags src_access,
+                                 vk::ImageLayout old_layout) {
+        return vk::ImageMemoryBarrier{
+            .srcAccessMask = src_access,
+            .dstAccessMask = vk::AccessFlagBits::eShaderWrite,
+            .oldLayout = old_layout,
+            .newLayout = vk::ImageLayout::eGeneral,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange{
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        };
+    };
+
+    // Both outputs are fully overwritten, their previous contents can be discarded.
+    const std::array pre_barriers{
+        make_barrier(intermediate.image, vk::AccessFlagBits::eNone, vk::ImageLayout::eUndefined),
+        make_barrier(output, vk::AccessFlagBits::eNone, vk::ImageLayout::eUndefined),
+    };
+    cmdbuf.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
+                           vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, pre_barriers);
+
+    Dispatch(cmdbuf, *easu_pipeline, input.view, input.extent, intermediate.view,
+             intermediate.extent);
+
+    auto easu_barrier = make_barrier(intermediate.image, vk::AccessFlagBits::eShaderWrite,
+                                     vk::ImageLayout::eGeneral);
+    easu_barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+    cmdbuf.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                           vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, easu_barrier);
+
+    Dispatch(cmdbuf, *rcas_pipeline, intermediate.view, intermediate.extent, output_view,
+             intermediate.extent);
+}
+
+void Upscaler::Dispatch(vk::CommandBuffer cmdbuf, vk::Pipeline pipeline, vk::ImageView input,
+                        vk::Extent2D input_extent, vk::ImageView output,
+                        vk::Extent2D output_extent) const {
+    const vk::DescriptorImageInfo input_info = {
+        .imageView = input,
+        .imageLayout = vk::ImageLayout::eGeneral,
+    };
+    const vk::DescriptorImageInfo output_info = {
+        .imageView = output,
+        .imageLayout = vk::ImageLayout::eGeneral,
+    };
+    const std::array<vk::WriteDescriptorSet, 2> set_writes{{
+        {
+            .dstSet = VK_NULL_HANDLE,
+            .dstBinding = 0,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = vk::DescriptorType::eStorageImage,
+            .pImageInfo = &input_info,
+        },
+        {
+            .dstSet = VK_NULL_HANDLE,
+            .dstBinding = 1,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = vk::DescriptorType::eStorageImage,
+            .pImageInfo = &output_info,
+        },
+    }};
+    const PushConstants params = {
+        .input_width = static_cast<s32>(input_extent.width),
+        .input_height = static_cast<s32>(input_extent.height),
+        .output_width = static_cast<s32>(output_extent.width),
+        .output_height = static_cast<s32>(output_extent.height),
+        .sharpness = std::exp2(-SharpnessStops),
+    };
+    cmdbuf.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+    cmdbuf.pushDescriptorSetKHR(vk::PipelineBindPoint::eCompute, *pl_layout, 0, set_writes);
+    cmdbuf.pushConstants(*pl_layout, vk::ShaderStageFlagBits::eCompute, 0u, sizeof(params),
+                         &params);
+    cmdbuf.dispatch(Common::DivCeil(output_extent.width, 8u),
+                    Common::DivCeil(output_extent.height, 8u), 1);
+}
+
+} // namespace Vulkan
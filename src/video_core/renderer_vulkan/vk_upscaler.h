@@ -0,0 +1,68 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "common/types.h"
+#include "video_core/renderer_vulkan/vk_common.h"
+
+VK_DEFINE_HANDLE(VmaAllocation)
+
+namespace Vulkan {
+
+class Instance;
+
+/// Storage image the upscaler passes read from or write to.
+struct UpscalerImage {
+    VmaAllocation allocation{};
+    vk::Image image{};
+    vk::ImageView view{};
+    vk::Extent2D extent{};
+};
+
+/**
+ * Spatial upscaler modelled after AMD FSR 1.0. An edge adaptive upsampling pass (EASU) produces
+ * the output resolution image, which is then sharpened by a contrast adaptive pass (RCAS).
+ * Both passes run as compute shaders over RGBA16F storage images.
+ */
+class Upscaler {
+public:
+    static constexpr vk::Format Format = vk::Format::eR16G16B16A16Sfloat;
+
+    explicit Upscaler(const Instance& instance);
+    ~Upscaler();
+
+    /// Creates the image or recreates it when its size differs from extent.
+    void Resize(UpscalerImage& image, vk::Extent2D extent) const;
+
+    /// Destroys the image, if it was created.
+    void Destroy(UpscalerImage& image) const;
+
+    /// Records the upscale of input into output, with the EASU result kept in intermediate.
+    /// Input must be in general layout and visible to compute shaders. Output is written in
+    /// general layout and has the extent of intermediate.
+    void Render(vk::CommandBuffer cmdbuf, const UpscalerImage& input,
+                const UpscalerImage& intermediate, vk::Image output,
+                vk::ImageView output_view) const;
+
+private:
+    struct PushConstants {
+        s32 input_width;
+        s32 input_height;
+        s32 output_width;
+        s32 output_height;
+        float sharpness;
+    };
+
+    void Dispatch(vk::CommandBuffer cmdbuf, vk::Pipeline pipeline, vk::ImageView input,
+                  vk::Extent2D input_extent, vk::ImageView output,
+                  vk::Extent2D output_extent) const;
+
+    const Instance& instance;
+    vk::UniqueDescriptorSetLayout desc_layout;
+    vk::UniquePipelineLayout pl_layout;
+    vk::UniquePipeline easu_pipeline;
+    vk::UniquePipeline rcas_pipeline;
+};
+
+} // namespace Vulkan
@@ -115,7 +115,8 @@ void UniqueImage::Create(const vk::ImageCreateInfo& image_ci) {
 Image::Image(const Vulkan::Instance& instance_, Vulkan::Scheduler& scheduler_,
              const ImageInfo& info_)
     : instance{&instance_}, scheduler{&scheduler_}, info{info_},
-      image{instance->GetDevice(), instance->GetAllocator()}, cpu_addr{info.guest_address},
+      image{instance->GetDevice(), instance->GetAllocator()},
+      native_image{instance->GetDevice(), instance->GetAllocator()}, cpu_addr{info.guest_address},
       cpu_addr_end{cpu_addr + info.guest_size_bytes} {
     mip_hashes.resize(info.resources.levels);
     ASSERT(info.pixel_format != vk::Format::eUndefined);
@@ -146,14 +147,15 @@ Image::Image(const Vulkan::Instance& instance_, Vulkan::Scheduler& scheduler_,
         break;
     }
 
+    const Extent3D extent = info.ScaledSize();
     const vk::ImageCreateInfo image_ci = {
         .flags = flags,
         .imageType = info.type,
         .format = instance->GetSupportedFormat(info.pixel_format),
         .extent{
-            .width = info.size.width,
-            .height = info.size.height,
-            .depth = info.size.depth,
+            .width = extent.width,
+            .height = extent.height,
+            .depth = extent.depth,
         },
         .mipLevels = static_cast<u32>(info.resources.levels),
         .arrayLayers = static_cast<u32>(info.resources.layers),
@@ -169,52 +171,158 @@ Image::Image(const Vulkan::Instance& instance_, Vulkan::Scheduler& scheduler_,
                           info.guest_address, info.guest_size_bytes);
 }
 
-void Image::Transit(vk::ImageLayout dst_layout, vk::Flags<vk::AccessFlagBits> dst_mask,
-                    vk::CommandBuffer cmdbuf) {
-    if (dst_layout == layout && dst_mask == access_mask) {
-        return;
+static vk::PipelineStageFlags2 PipelineStages(vk::Flags<vk::AccessFlagBits> access) {
+    using Access = vk::AccessFlagBits;
+    using Stage = vk::PipelineStageFlagBits2;
+    vk::PipelineStageFlags2 stages{};
+    if (access & (Access::eTransferRead | Access::eTransferWrite)) {
+        stages |= Stage::eTransfer;
+    }
+    if (access & (Access::eColorAttachmentRead | Access::eColorAttachmentWrite)) {
+        stages |= Stage::eColorAttachmentOutput;
     }
+    if (access & (Access::eDepthStencilAttachmentRead | Access::eDepthStencilAttachmentWrite)) {
+        stages |= Stage::eEarlyFragmentTests | Stage::eLateFragmentTests;
+    }
+    if (access & (Access::eShaderRead | Access::eShaderWrite)) {
+        stages |= Stage::ePreRasterizationShaders | Stage::eFragmentShader | Stage::eComputeShader;
+    }
+    return stages ? stages : Stage::eAllCommands;
+}
 
-    const vk::ImageMemoryBarrier barrier = {
-        .srcAccessMask = access_mask,
-        .dstAccessMask = dst_mask,
-        .oldLayout = layout,
-        .newLayout = dst_layout,
-        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image = image,
-        .subresourceRange{
-            .aspectMask = aspect_mask,
-            .baseMipLevel = 0,
-            .levelCount = VK_REMAINING_MIP_LEVELS,
-            .baseArrayLayer = 0,
-            .layerCount = VK_REMAINING_ARRAY_LAYERS,
-        },
+static vk::AccessFlags2 ToAccessFlags2(vk::Flags<vk::AccessFlagBits> access) {
+    // The legacy access bits share their values with the synchronization2 ones.
+    return vk::AccessFlags2{static_cast<VkAccessFlags2>(static_cast<VkAccessFlags>(access))};
+}
+
+vk::ImageSubresourceRange Image::GetSubresourceRange(const SubresourceRange& range) const {
+    // Matches the interpretation of view ranges, where the extent is the end of the range.
+    const u32 levels = info.resources.levels;
+    const u32 layers = info.resources.layers;
+    const u32 base_level = std::min(range.base.level, levels - 1);
+    const u32 base_layer = std::min(range.base.layer, layers - 1);
+    const u32 end_level = std::clamp(range.extent.levels, base_level + 1, levels);
+    const u32 end_layer = std::clamp(range.extent.layers, base_layer + 1, layers);
+    return vk::ImageSubresourceRange{
+        .aspectMask = aspect_mask,
+        .baseMipLevel = base_level,
+        .levelCount = end_level - base_level,
+        .baseArrayLayer = base_layer,
+        .layerCount = end_layer - base_layer,
     };
+}
 
-    // Adjust pipieline stage
-    const vk::PipelineStageFlags dst_pl_stage =
-        (dst_mask == vk::AccessFlagBits::eTransferRead ||
-         dst_mask == vk::AccessFlagBits::eTransferWrite)
-            ? vk::PipelineStageFlagBits::eTransfer
-            : vk::PipelineStageFlagBits::eAllGraphics | vk::PipelineStageFlagBits::eComputeShader;
+void Image::Transit(vk::ImageLayout dst_layout, vk::Flags<vk::AccessFlagBits> dst_mask,
+                    std::optional<SubresourceRange> range, vk::CommandBuffer cmdbuf) {
+    if (!cmdbuf || cmdbuf == scheduler->CommandBuffer()) {
+        tick = scheduler->CurrentTick();
+    }
+    const u32 levels = info.resources.levels;
+    const u32 layers = info.resources.layers;
+    const auto subresources = range ? GetSubresourceRange(*range)
+                                    : vk::ImageSubresourceRange{
+                                          .aspectMask = aspect_mask,
+                                          .baseMipLevel = 0,
+                                          .levelCount = levels,
+                                          .baseArrayLayer = 0,
+                                          .layerCount = layers,
+                                      };
+    const bool is_full = subresources.levelCount == levels && subresources.layerCount == layers;
+    const State dst_state{dst_layout, dst_mask, PipelineStages(dst_mask)};
 
-    if (!cmdbuf) {
-        // When using external cmdbuf you are responsible for ending rp.
-        scheduler->EndRendering();
-        cmdbuf = scheduler->CommandBuffer();
+    const auto make_barrier = [&](const State& src_state, u32 level, u32 level_count, u32 layer,
+                                  u32 layer_count) {
+        return vk::ImageMemoryBarrier2{
+            .srcStageMask = src_state.pl_stage,
+            .srcAccessMask = ToAccessFlags2(src_state.access_mask),
+            .dstStageMask = dst_state.pl_stage,
+            .dstAccessMask = ToAccessFlags2(dst_mask),
+            .oldLayout = src_state.layout,
+            .newLayout = dst_layout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange{
+                .aspectMask = aspect_mask,
+                .baseMipLevel = level,
+                .levelCount = level_count,
+                .baseArrayLayer = layer,
+                .layerCount = layer_count,
+            },
+        };
+    };
+
+    boost::container::small_vector<vk::ImageMemoryBarrier2, 4> barriers;
+    if (subresource_states.empty()) {
+        if (dst_layout == layout && dst_mask == access_mask) {
+            return;
+        }
+        if (is_full) {
+            barriers.push_back(make_barrier({layout, access_mask, pl_stage}, 0, levels, 0, layers));
+        } else {
+            // Part of the image changes state, track every subresource from now on.
+            subresource_states.assign(levels * layers, {layout, access_mask, pl_stage});
+        }
+    }
+    if (!subresource_states.empty()) {
+        const auto matches = [](const State& lhs, const State& rhs) {
+            return lhs.layout == rhs.layout && lhs.access_mask == rhs.access_mask;
+        };
+        const u32 end_layer = subresources.baseArrayLayer + subresources.layerCount;
+        for (u32 level = subresources.baseMipLevel;
+             level < subresources.baseMipLevel + subresources.levelCount; ++level) {
+            State* const level_states = &subresource_states[level * layers];
+            for (u32 layer = subresources.baseArrayLayer; layer < end_layer;) {
+                const State src_state = level_states[layer];
+                if (matches(src_state, dst_state)) {
+                    ++layer;
+                    continue;
+                }
+                // Cover each run of layers that share a state with a single barrier.
+                u32 run_end = layer + 1;
+                while (run_end < end_layer && matches(level_states[run_end], src_state)) {
+                    ++run_end;
+                }
+                barriers.push_back(make_barrier(src_state, level, 1, layer, run_end - layer));
+                std::fill(level_states + layer, level_states + run_end, dst_state);
+                layer = run_end;
+            }
+        }
+        if (std::ranges::all_of(subresource_states,
+                                [&](const State& state) { return matches(state, dst_state); })) {
+            subresource_states.clear();
+        }
     }
-    cmdbuf.pipelineBarrier(pl_stage, dst_pl_stage, vk::DependencyFlagBits::eByRegion, {}, {},
-                           barrier);
 
     layout = dst_layout;
     access_mask = dst_mask;
-    pl_stage = dst_pl_stage;
+    pl_stage = dst_state.pl_stage;
+    if (barriers.empty()) {
+        return;
+    }
+
+    if (!cmdbuf) {
+        for (const auto& barrier : barriers) {
+            scheduler->PushImageBarrier(barrier);
+        }
+        return;
+    }
+    // When using external cmdbuf you are responsible for ending rp.
+    if (cmdbuf == scheduler->CommandBuffer()) {
+        // Keep queued transitions of this scheduler ordered before this one.
+        scheduler->FlushBarriers();
+    }
+    cmdbuf.pipelineBarrier2(vk::DependencyInfo{
+        .dependencyFlags = vk::DependencyFlagBits::eByRegion,
+        .imageMemoryBarrierCount = static_cast<u32>(barriers.size()),
+        .pImageMemoryBarriers = barriers.data(),
+    });
 }
 
 void Image::Upload(vk::Buffer buffer, u64 offset) {
-    scheduler->EndRendering();
-    Transit(vk::ImageLayout::eTransferDstOptimal, vk::AccessFlagBits::eTransferWrite);
+    scheduler->EndRendering(Vulkan::RenderBreak::Upload);
+    const auto cmdbuf = scheduler->CommandBuffer();
+    Transit(vk::ImageLayout::eTransferDstOptimal, vk::AccessFlagBits::eTransferWrite, {}, cmdbuf);
 
     // Copy to the image.
     const auto aspect = aspect_mask & vk::ImageAspectFlagBits::eStencil
@@ -234,13 +342,101 @@ void Image::Upload(vk::Buffer buffer, u64 offset) {
         .imageExtent = {info.size.width, info.size.height, 1},
     };
 
-    const auto cmdbuf = scheduler->CommandBuffer();
     cmdbuf.copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal, image_copy);
 
     Transit(vk::ImageLayout::eGeneral,
             vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferRead);
 }
 
+void Image::UploadScaled(vk::CommandBuffer cmdbuf, vk::Buffer buffer,
+                         std::span<const vk::BufferImageCopy> copies) {
+    if (info.num_samples > 1 || info.IsDepthStencil()) {
+        // Neither can be the target of a blit.
+        LOG_WARNING(Render_Vulkan, "Skipping upload to rescaled image {:#x}", info.guest_address);
+        return;
+    }
+    if (!static_cast<vk::Image>(native_image)) {
+        native_image.Create(vk::ImageCreateInfo{
+            .imageType = info.type,
+            .format = instance->GetSupportedFormat(info.pixel_format),
+            .extent{
+                .width = info.size.width,
+                .height = info.size.height,
+                .depth = info.size.depth,
+            },
+            .mipLevels = static_cast<u32>(info.resources.levels),
+            .arrayLayers = static_cast<u32>(info.resources.layers),
+            .samples = vk::SampleCountFlagBits::e1,
+            .tiling = vk::ImageTiling::eOptimal,
+            .usage = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst,
+            .initialLayout = vk::ImageLayout::eUndefined,
+        });
+    }
+
+    const vk::ImageSubresourceRange range = {
+        .aspectMask = vk::ImageAspectFlagBits::eColor,
+        .baseMipLevel = 0,
+        .levelCount = VK_REMAINING_MIP_LEVELS,
+        .baseArrayLayer = 0,
+        .layerCount = VK_REMAINING_ARRAY_LAYERS,
+    };
+    // Only the uploaded levels are blitted, so the staging contents can be discarded.
+    const vk::ImageMemoryBarrier2 pre_barrier = {
+        .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+        .srcAccessMask = vk::AccessFlagBits2::eTransferRead,
+        .dstStageMask = vk::PipelineStageFlagBits2::eTransfer,
+        .dstAccessMask = vk::AccessFlagBits2::eTransferWrite,
+        .oldLayout = vk::ImageLayout::eUndefined,
+        .newLayout = vk::ImageLayout::eTransferDstOptimal,
+        .image = native_image,
+        .subresourceRange = range,
+    };
+    cmdbuf.pipelineBarrier2(vk::DependencyInfo{
+        .imageMemoryBarrierCount = 1,
+        .pImageMemoryBarriers = &pre_barrier,
+    });
+    cmdbuf.copyBufferToImage(buffer, native_image, vk::ImageLayout::eTransferDstOptimal, copies);
+
+    const vk::ImageMemoryBarrier2 post_barrier = {
+        .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+        .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+        .dstStageMask = vk::PipelineStageFlagBits2::eTransfer,
+        .dstAccessMask = vk::AccessFlagBits2::eTransferRead,
+        .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+        .newLayout = vk::ImageLayout::eTransferSrcOptimal,
+        .image = native_image,
+        .subresourceRange = range,
+    };
+    cmdbuf.pipelineBarrier2(vk::DependencyInfo{
+        .imageMemoryBarrierCount = 1,
+        .pImageMemoryBarriers = &post_barrier,
+    });
+
+    boost::container::small_vector<vk::ImageBlit, 14> blits;
+    for (const auto& copy : copies) {
+        const u32 level = copy.imageSubresource.mipLevel;
+        const Extent3D dst_extent = info.ScaledSize(level);
+        blits.push_back({
+            .srcSubresource = copy.imageSubresource,
+            .srcOffsets = std::array{
+                vk::Offset3D{0, 0, 0},
+                vk::Offset3D{static_cast<s32>(copy.imageExtent.width),
+                             static_cast<s32>(copy.imageExtent.height),
+                             static_cast<s32>(copy.imageExtent.depth)},
+            },
+            .dstSubresource = copy.imageSubresource,
+            .dstOffsets = std::array{
+                vk::Offset3D{0, 0, 0},
+                vk::Offset3D{static_cast<s32>(dst_extent.width),
+                             static_cast<s32>(dst_extent.height),
+                             static_cast<s32>(copy.imageExtent.depth)},
+            },
+        });
+    }
+    cmdbuf.blitImage(native_image, vk::ImageLayout::eTransferSrcOptimal, image,
+                     vk::ImageLayout::eTransferDstOptimal, blits, vk::Filter::eNearest);
+}
+
 Image::~Image() = default;
 
 } // namespace VideoCore
@@ -14,6 +14,7 @@
 #include "video_core/texture_cache/types.h"
 
 #include <optional>
+#include <span>
 
 namespace Vulkan {
 class Instance;
@@ -91,14 +92,27 @@ struct Image {
         return image_view_ids[std::distance(image_view_infos.begin(), it)];
     }
 
+    /// Returns the subresources covered by a view range, clamped to the image.
+    vk::ImageSubresourceRange GetSubresourceRange(const SubresourceRange& range) const;
+
+    /// Transitions the given subresources, or the whole image when no range is given.
+    /// Without a command buffer the barrier is queued on the scheduler and merged with other
+    /// pending transitions, otherwise it is recorded immediately.
     void Transit(vk::ImageLayout dst_layout, vk::Flags<vk::AccessFlagBits> dst_mask,
-                 vk::CommandBuffer cmdbuf = {});
+                 std::optional<SubresourceRange> range = {}, vk::CommandBuffer cmdbuf = {});
     void Upload(vk::Buffer buffer, u64 offset);
 
+    /// Records the upload of guest sized copies into a rescaled image. The data is copied into
+    /// a guest sized image first and then stretched over. The image must be in transfer
+    /// destination layout.
+    void UploadScaled(vk::CommandBuffer cmdbuf, vk::Buffer buffer,
+                      std::span<const vk::BufferImageCopy> copies);
+
     const Vulkan::Instance* instance;
     Vulkan::Scheduler* scheduler;
     ImageInfo info;
     UniqueImage image;
+    UniqueImage native_image; ///< Guest sized staging copy of a rescaled image.
     vk::ImageAspectFlags aspect_mask = vk::ImageAspectFlagBits::eColor;
     ImageFlagBits flags = ImageFlagBits::CpuModified;
     VAddr cpu_addr = 0;
@@ -107,10 +121,19 @@ struct Image {
     std::vector<ImageViewId> image_view_ids;
 
     // Resource state tracking
+    struct State {
+        vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+        vk::Flags<vk::AccessFlagBits> access_mask = vk::AccessFlagBits::eNone;
+        vk::PipelineStageFlags2 pl_stage = vk::PipelineStageFlagBits2::eAllCommands;
+    };
     vk::ImageUsageFlags usage;
-    vk::Flags<vk::PipelineStageFlagBits> pl_stage = vk::PipelineStageFlagBits::eAllCommands;
+    // State of the last transition, which is the state of every subresource unless
+    // subresource_states is populated (indexed by level * layers + layer).
+    vk::PipelineStageFlags2 pl_stage = vk::PipelineStageFlagBits2::eAllCommands;
     vk::Flags<vk::AccessFlagBits> access_mask = vk::AccessFlagBits::eNone;
     vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+    std::vector<State> subresource_states;
+    u64 tick{}; ///< Scheduler tick of the last command buffer that used the image.
     boost::container::small_vector<u64, 14> mip_hashes;
 };
 
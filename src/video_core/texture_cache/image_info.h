@@ -9,6 +9,7 @@
 #include "video_core/amdgpu/liverpool.h"
 #include "video_core/texture_cache/types.h"
 
+#include <algorithm>
 #include <boost/container/small_vector.hpp>
 
 namespace VideoCore {
@@ -29,6 +30,15 @@ struct ImageInfo {
     bool IsPacked() const;
     bool IsDepthStencil() const;
 
+    /// Returns the size of the host image at a mip level. It differs from the guest size for
+    /// render targets created with a resolution scale.
+    Extent3D ScaledSize(u32 level = 0) const {
+        const auto scale = [&](u32 value) {
+            return std::max(static_cast<u32>(value * resolution_scale + 0.5f) >> level, 1U);
+        };
+        return {scale(size.width), scale(size.height), std::max(size.depth >> level, 1U)};
+    }
+
     struct {
         VAddr cmask_addr;
         VAddr fmask_addr;
@@ -69,6 +79,7 @@ struct ImageInfo {
     boost::container::small_vector<MipInfo, 14> mips_layout;
     VAddr guest_address{0};
     u32 guest_size_bytes{0};
+    float resolution_scale{1.0f};
 };
 
 } // namespace VideoCore
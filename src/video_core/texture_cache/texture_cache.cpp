@@ -3,6 +3,7 @@
 
 #include <xxhash.h>
 #include "common/assert.h"
+#include "common/config.h"
 #include "video_core/buffer_cache/buffer_cache.h"
 #include "video_core/page_manager.h"
 #include "video_core/renderer_vulkan/vk_instance.h"
@@ -18,6 +19,11 @@ TextureCache::TextureCache(const Vulkan::Instance& instance_, Vulkan::Scheduler&
                            BufferCache& buffer_cache_, PageManager& tracker_)
     : instance{instance_}, scheduler{scheduler_}, buffer_cache{buffer_cache_}, tracker{tracker_},
       tile_manager{instance, scheduler} {
+    resolution_scale = std::clamp(Config::getResolutionScale(), 0.5f, 2.0f);
+    if (resolution_scale != 1.0f) {
+        LOG_INFO(Render_Vulkan, "Render targets are scaled by {}", resolution_scale);
+    }
+
     ImageInfo info;
     info.pixel_format = vk::Format::eR8G8B8A8Unorm;
     info.type = vk::ImageType::e2D;
@@ -59,7 +65,7 @@ void TextureCache::UnmapMemory(VAddr cpu_addr, size_t size) {
     }
 }
 
-ImageId TextureCache::FindImage(const ImageInfo& info) {
+ImageId TextureCache::FindImage(const ImageInfo& info, float resolution_scale) {
     if (info.guest_address == 0) [[unlikely]] {
         return NULL_IMAGE_VIEW_ID;
     }
@@ -83,7 +89,13 @@ ImageId TextureCache::FindImage(const ImageInfo& info) {
 
     ImageId image_id{};
     if (image_ids.empty()) {
-        image_id = slot_images.insert(instance, scheduler, info);
+        if (resolution_scale != 1.0f) {
+            ImageInfo scaled_info = info;
+            scaled_info.resolution_scale = resolution_scale;
+            image_id = slot_images.insert(instance, scheduler, scaled_info);
+        } else {
+            image_id = slot_images.insert(instance, scheduler, info);
+        }
         RegisterImage(image_id);
     } else {
         image_id = image_ids[image_ids.size() > 1 ? 1 : 0];
@@ -119,18 +131,6 @@ ImageView& TextureCache::FindTexture(const ImageInfo& info, const ImageViewInfo&
     Image& image = slot_images[image_id];
     auto& usage = image.info.usage;
 
-    if (view_info.is_storage) {
-        image.Transit(vk::ImageLayout::eGeneral,
-                      vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
-        usage.storage = true;
-    } else {
-        const auto new_layout = image.info.IsDepthStencil()
-                                    ? vk::ImageLayout::eDepthStencilReadOnlyOptimal
-                                    : vk::ImageLayout::eShaderReadOnlyOptimal;
-        image.Transit(new_layout, vk::AccessFlagBits::eShaderRead);
-        usage.texture = true;
-    }
-
     // These changes are temporary and should be removed once texture cache will handle subresources
     // merging
     auto view_info_tmp = view_info;
@@ -155,19 +155,34 @@ ImageView& TextureCache::FindTexture(const ImageInfo& info, const ImageViewInfo&
             std::min(view_info_tmp.range.extent.layers, image.info.resources.layers);
     }
 
+    // Only the subresources seen by the view change layout.
+    if (view_info.is_storage) {
+        image.Transit(vk::ImageLayout::eGeneral,
+                      vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                      view_info_tmp.range);
+        usage.storage = true;
+    } else {
+        const auto new_layout = image.info.IsDepthStencil()
+                                    ? vk::ImageLayout::eDepthStencilReadOnlyOptimal
+                                    : vk::ImageLayout::eShaderReadOnlyOptimal;
+        image.Transit(new_layout, vk::AccessFlagBits::eShaderRead, view_info_tmp.range);
+        usage.texture = true;
+    }
+
     return RegisterImageView(image_id, view_info_tmp);
 }
 
 ImageView& TextureCache::FindRenderTarget(const ImageInfo& image_info,
                                           const ImageViewInfo& view_info) {
-    const ImageId image_id = FindImage(image_info);
+    const ImageId image_id = FindImage(image_info, resolution_scale);
     Image& image = slot_images[image_id];
     image.flags |= ImageFlagBits::GpuModified;
     UpdateImage(image_id);
 
     image.Transit(vk::ImageLayout::eColorAttachmentOptimal,
                   vk::AccessFlagBits::eColorAttachmentWrite |
-                      vk::AccessFlagBits::eColorAttachmentRead);
+                      vk::AccessFlagBits::eColorAttachmentRead,
+                  view_info.range);
 
     // Register meta data for this color buffer
     if (!(image.flags & ImageFlagBits::MetaRegistered)) {
@@ -196,15 +211,17 @@ ImageView& TextureCache::FindRenderTarget(const ImageInfo& image_info,
 
 ImageView& TextureCache::FindDepthTarget(const ImageInfo& image_info,
                                          const ImageViewInfo& view_info) {
-    const ImageId image_id = FindImage(image_info);
+    const ImageId image_id = FindImage(image_info, resolution_scale);
     Image& image = slot_images[image_id];
     image.flags |= ImageFlagBits::GpuModified;
     image.flags &= ~ImageFlagBits::CpuModified;
 
     const auto new_layout = view_info.is_storage ? vk::ImageLayout::eDepthStencilAttachmentOptimal
                                                  : vk::ImageLayout::eDepthStencilReadOnlyOptimal;
-    image.Transit(new_layout, vk::AccessFlagBits::eDepthStencilAttachmentWrite |
-                                  vk::AccessFlagBits::eDepthStencilAttachmentRead);
+    image.Transit(new_layout,
+                  vk::AccessFlagBits::eDepthStencilAttachmentWrite |
+                      vk::AccessFlagBits::eDepthStencilAttachmentRead,
+                  view_info.range);
 
     // Register meta data for this depth buffer
     if (!(image.flags & ImageFlagBits::MetaRegistered)) {
@@ -269,28 +286,48 @@ void TextureCache::RefreshImage(Image& image, Vulkan::Scheduler* custom_schedule
         return;
     }
 
+    // Record the upload ahead of the current command buffer when it has not used the image yet,
+    // so that textures streamed in mid-frame do not interrupt the active render pass.
     auto* sched_ptr = custom_scheduler ? custom_scheduler : &scheduler;
-    sched_ptr->EndRendering();
-
-    const auto cmdbuf = sched_ptr->CommandBuffer();
-    image.Transit(vk::ImageLayout::eTransferDstOptimal, vk::AccessFlagBits::eTransferWrite, cmdbuf);
+    const u64 tick = scheduler.CurrentTick();
+    vk::CommandBuffer cmdbuf;
+    if (!custom_scheduler && image.tick != tick) {
+        cmdbuf = scheduler.UploadCommandBuffer();
+    } else {
+        sched_ptr->EndRendering(Vulkan::RenderBreak::Upload);
+        cmdbuf = sched_ptr->CommandBuffer();
+    }
+    image.Transit(vk::ImageLayout::eTransferDstOptimal, vk::AccessFlagBits::eTransferWrite, {},
+                  cmdbuf);
 
     const VAddr image_addr = image.info.guest_address;
     const size_t image_size = image.info.guest_size_bytes;
     vk::Buffer buffer{};
     u32 offset{};
-    if (auto upload_buffer = tile_manager.TryDetile(image); upload_buffer) {
+    if (auto upload_buffer = tile_manager.TryDetile(image, cmdbuf); upload_buffer) {
         buffer = *upload_buffer;
     } else {
         const auto [vk_buffer, buf_offset] = buffer_cache.ObtainTempBuffer(image_addr, image_size);
         buffer = vk_buffer->Handle();
         offset = buf_offset;
+        if (vk_buffer->tick == tick && cmdbuf != sched_ptr->CommandBuffer()) {
+            // The source buffer is accessed by the current command buffer, copy after it.
+            scheduler.EndRendering(Vulkan::RenderBreak::Upload);
+            cmdbuf = scheduler.CommandBuffer();
+        }
+        if (cmdbuf == scheduler.CommandBuffer()) {
+            vk_buffer->tick = tick;
+        }
     }
 
     for (auto& copy : image_copy) {
         copy.bufferOffset += offset;
     }
 
+    if (image.info.resolution_scale != 1.0f) {
+        image.UploadScaled(cmdbuf, buffer, image_copy);
+        return;
+    }
     cmdbuf.copyBufferToImage(buffer, image.image, vk::ImageLayout::eTransferDstOptimal, image_copy);
 }
 
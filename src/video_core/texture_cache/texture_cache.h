@@ -43,8 +43,9 @@ public:
     /// Evicts any images that overlap the unmapped range.
     void UnmapMemory(VAddr cpu_addr, size_t size);
 
-    /// Retrieves the image handle of the image with the provided attributes.
-    [[nodiscard]] ImageId FindImage(const ImageInfo& info);
+    /// Retrieves the image handle of the image with the provided attributes. A new image is
+    /// created with its size multiplied by resolution_scale.
+    [[nodiscard]] ImageId FindImage(const ImageInfo& info, float resolution_scale = 1.0f);
 
     /// Retrieves an image view with the properties of the specified image descriptor.
     [[nodiscard]] ImageView& FindTexture(const ImageInfo& image_info,
@@ -74,6 +75,11 @@ public:
     /// Retrieves the sampler that matches the provided S# descriptor.
     [[nodiscard]] vk::Sampler GetSampler(const AmdGpu::Sampler& sampler);
 
+    /// Returns the size factor applied to newly created render targets.
+    [[nodiscard]] float GetResolutionScale() const noexcept {
+        return resolution_scale;
+    }
+
     /// Retrieves the image with the specified id.
     [[nodiscard]] Image& GetImage(ImageId id) {
         return slot_images[id];
@@ -186,6 +192,7 @@ private:
     tsl::robin_map<u64, Sampler> samplers;
     PageTable page_table;
     std::mutex mutex;
+    float resolution_scale{1.0f};
 
     struct MetaDataInfo {
         enum class Type {
@@ -381,7 +381,7 @@ void TileManager::FreeBuffer(ScratchBuffer buffer) {
     vmaDestroyBuffer(instance.GetAllocator(), buffer.first, buffer.second);
 }
 
-std::optional<vk::Buffer> TileManager::TryDetile(Image& image) {
+std::optional<vk::Buffer> TileManager::TryDetile(Image& image, vk::CommandBuffer cmdbuf) {
     if (!image.info.props.is_tiled) {
         return std::nullopt;
     }
@@ -415,7 +415,6 @@ std::optional<vk::Buffer> TileManager::TryDetile(Image& image) {
     auto out_buffer = AllocBuffer(image_size, true);
     scheduler.DeferOperation([=, this]() { FreeBuffer(out_buffer); });
 
-    auto cmdbuf = scheduler.CommandBuffer();
     cmdbuf.bindPipeline(vk::PipelineBindPoint::eCompute, *detiler->pl);
 
     const vk::DescriptorBufferInfo input_buffer_info{
@@ -39,7 +39,7 @@ public:
     TileManager(const Vulkan::Instance& instance, Vulkan::Scheduler& scheduler);
     ~TileManager();
 
-    std::optional<vk::Buffer> TryDetile(Image& image);
+    std::optional<vk::Buffer> TryDetile(Image& image, vk::CommandBuffer cmdbuf);
 
     ScratchBuffer AllocBuffer(u32 size, bool is_storage = false);
     void Upload(ScratchBuffer buffer, const void* data, size_t size);